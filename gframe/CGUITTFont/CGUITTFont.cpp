@@ -41,6 +41,7 @@
 #include <unordered_set>
 #include <climits>
 #include "../fmt.h"
+#include "../image_data.h"
 #ifdef YGOPRO_USE_BUNDLED_FONT
 extern const char* bundled_font_name;
 extern const size_t bundled_font_len;
@@ -66,15 +67,6 @@ struct SGUITTFace final : public virtual irr::IReferenceCounted {
 FT_Library CGUITTFont::c_library = nullptr;
 core::map<io::path, SGUITTFace*> CGUITTFont::c_faces;
 
-//
-#if IRRLICHT_VERSION_MAJOR==1 && IRRLICHT_VERSION_MINOR==9
-#define GetData(image) image->getData()
-#define Unlock(image)(void)0
-#else
-#define GetData(image) image->lock()
-#define Unlock(image) image->unlock()
-#endif
-
 video::IImage* SGUITTGlyph::createGlyphImage(const FT_Bitmap& bits, video::IVideoDriver* driver) const {
 	// Determine what our texture size should be.
 	// Add 1 because textures are inclusive-exclusive.
@@ -289,13 +281,28 @@ static SGUITTFace* OpenFileStreamFont(FT_Library library, io::IReadFile* file) {
 
 #ifdef YGOPRO_USE_BUNDLED_FONT
 static SGUITTFace* OpenMemoryStreamFont(FT_Library library, const void* data, size_t size) {
-	FT_Face freetype_face = nullptr;
-	if(FT_New_Memory_Face(library, static_cast<const FT_Byte*>(data), static_cast<FT_Long>(size), 0, &freetype_face) != FT_Err_Ok)
+	FT_Face freetype_face = CGUITTFont::openMemoryFace(library, data, size);
+	if(freetype_face == nullptr)
 		return nullptr;
 	return new SGUITTFace{ freetype_face };
 }
 #endif
 
+FT_Library CGUITTFont::createFreeTypeLibrary() {
+	FT_Library library = nullptr;
+	if(FT_Init_FreeType(&library))
+		return nullptr;
+	forceHinting(library);
+	return library;
+}
+
+FT_Face CGUITTFont::openMemoryFace(FT_Library library, const void* data, size_t size) {
+	FT_Face freetype_face = nullptr;
+	if(FT_New_Memory_Face(library, static_cast<const FT_Byte*>(data), static_cast<FT_Long>(size), 0, &freetype_face) != FT_Err_Ok)
+		return nullptr;
+	return freetype_face;
+}
+
 bool CGUITTFont::load(const io::path& font_filename, const u32 font_size, const bool antialias, const bool transparency) {
 	// Some sanity checks.
 	if(Environment == nullptr || Driver == nullptr) return false;
@@ -530,6 +537,17 @@ void CGUITTFont::draw(const core::stringw& text, const core::rect<s32>& position
 void CGUITTFont::drawustring(const core::ustring& utext, const core::rect<s32>& position, video::SColor color, bool hcenter, bool vcenter, const core::rect<s32>* clip) {
 	if(!Driver)
 		return;
+	drawScaledustring(utext, position, color, 1.0f, hcenter, vcenter, clip);
+}
+
+void CGUITTFont::drawScaled(const core::stringw& text, const core::rect<s32>& position, video::SColor color, f32 scaleX, bool hcenter, bool vcenter, const core::rect<s32>* clip) {
+	if(!Driver)
+		return;
+	drawScaledustring(text, position, color, scaleX, hcenter, vcenter, clip);
+}
+
+void CGUITTFont::drawScaledustring(const core::ustring& utext, const core::rect<s32>& position, video::SColor color, f32 scaleX, bool hcenter, bool vcenter, const core::rect<s32>* clip) {
+	const bool scaled = !core::equals(scaleX, 1.0f);
 
 	// Clear the glyph pages of their render information.
 	clearGlyphPages();
@@ -541,6 +559,8 @@ void CGUITTFont::drawustring(const core::ustring& utext, const core::rect<s32>&
 	// Determine offset positions.
 	if(hcenter || vcenter) {
 		textDimension = getDimensionustring(utext);
+		if(scaled)
+			textDimension.Width = core::round32(textDimension.Width * scaleX);
 
 		if(hcenter)
 			offset.X = ((position.getWidth() - textDimension.Width) >> 1) + offset.X;
@@ -552,7 +572,9 @@ void CGUITTFont::drawustring(const core::ustring& utext, const core::rect<s32>&
 	// Set up our render map.
 	std::unordered_set<CGUITTGlyphPage*> Render_Map;
 
-	// Start parsing characters.
+	// Start parsing characters. When scaled, the pen advances unscaled from
+	// the start of the line and every glyph is placed at its scaled position.
+	s32 lineStartX = offset.X;
 	u32 n;
 	uchar32_t previousChar = 0;
 	auto iter = utext.begin();
@@ -582,6 +604,7 @@ void CGUITTFont::drawustring(const core::ustring& utext, const core::rect<s32>&
 
 				if(hcenter)
 					offset.X += (position.getWidth() - textDimension.Width) >> 1;
+				lineStartX = offset.X;
 				++iter;
 				continue;
 			}
@@ -598,7 +621,10 @@ void CGUITTFont::drawustring(const core::ustring& utext, const core::rect<s32>&
 			// Determine rendering information.
 			SGUITTGlyph& glyph = glyphs->operator[](n - 1);
 			CGUITTGlyphPage* const page = glyphpages->operator[](glyph.glyph_page);
-			page->render_positions.push_back(core::vector2di(offset.X + offx, offset.Y + offy));
+			s32 x = offset.X + offx;
+			if(scaled)
+				x = lineStartX + core::round32((x - lineStartX) * scaleX);
+			page->render_positions.push_back(core::vector2di(x, offset.Y + offy));
 			page->render_source_rects.push_back(glyph.source_rect);
 			Render_Map.insert(page);
 		}
@@ -610,9 +636,19 @@ void CGUITTFont::drawustring(const core::ustring& utext, const core::rect<s32>&
 
 	// Draw now.
 	update_glyph_pages();
+	if(!use_transparency) color.color |= 0xff000000;
 	for(auto& page : Render_Map) {
-		if(!use_transparency) color.color |= 0xff000000;
-		Driver->draw2DImageBatch(page->texture, page->render_positions, page->render_source_rects, clip, color, true);
+		if(!scaled) {
+			Driver->draw2DImageBatch(page->texture, page->render_positions, page->render_source_rects, clip, color, true);
+			continue;
+		}
+		const video::SColor colors[4]{ color, color, color, color };
+		for(u32 i = 0; i < page->render_positions.size(); ++i) {
+			const core::vector2di& pos = page->render_positions[i];
+			const core::recti& src = page->render_source_rects[i];
+			const core::recti dest(pos.X, pos.Y, pos.X + core::round32(src.getWidth() * scaleX), pos.Y + src.getHeight());
+			Driver->draw2DImage(page->texture, dest, src, clip, colors, true);
+		}
 	}
 }
 
@@ -181,6 +181,15 @@ public:
 	}
 	static CGUITTFont* createTTFont(IrrlichtDevice* device, IGUIEnvironment* env, const FontInfo& font_info, FallbackFonts::const_iterator fallback_begin, FallbackFonts::const_iterator fallback_end, const bool antialias = true, const bool transparency = true);
 
+	//! Creates a FreeType library configured like the one shared by all the fonts.
+	//! Meant for code that rasterizes glyphs on its own thread, as neither the
+	//! shared library nor its faces may be used concurrently.  Release it with FT_Done_FreeType.
+	static FT_Library createFreeTypeLibrary();
+
+	//! Opens a face from font data in memory.  The data must outlive the face.
+	//! \return Returns the face, to be released with FT_Done_Face, or 0 on failure.
+	static FT_Face openMemoryFace(FT_Library library, const void* data, size_t size);
+
 	//! Destructor
 	~CGUITTFont() override;
 
@@ -246,6 +255,13 @@ public:
 					  video::SColor color, bool hcenter = false, bool vcenter = false,
 					  const core::rect<s32>* clip = 0);
 
+	//! Draws text scaled horizontally by scaleX, like a css scaleX transform anchored
+	//! at the left edge (or the center if hcenter). Each glyph quad is scaled as it's
+	//! drawn, so squeezing a long line doesn't need an intermediate render target.
+	void drawScaled(const core::stringw& text, const core::rect<s32>& position,
+					video::SColor color, f32 scaleX, bool hcenter = false, bool vcenter = false,
+					const core::rect<s32>* clip = 0);
+
 	//! Returns the dimension of a character produced by this font.
 	core::dimension2d<u32> getCharDimension(const wchar_t ch) const;
 
@@ -301,6 +317,9 @@ public:
 	u32 getGlyphIndexByChar(uchar32_t c, core::array<SGUITTGlyph>** glyphs, core::array<CGUITTGlyphPage*>** glyphpages, bool called_as_fallback = false) const;
 
 	void clearGlyphPages();
+	void drawScaledustring(const core::ustring& text, const core::rect<s32>& position,
+						   video::SColor color, f32 scaleX, bool hcenter, bool vcenter,
+						   const core::rect<s32>* clip);
 
 protected:
 	bool use_monochrome;
@@ -14,6 +14,10 @@ enum LAUNCH_PARAM {
 	REPOS_READ_ONLY,
 	ONLY_CLONE_REPOS,
 	USER_STORAGE_DIRECTORY,
+	RENDER_MODULAR_CARDS,
+	BENCHMARK_MODULAR_CARDS,
+	PACK_MODULAR_ART,
+	BENCHMARK_IMAGE_SCALER,
 	COUNT,
 };
 
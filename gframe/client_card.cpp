@@ -3,6 +3,7 @@
 #include "common.h"
 #include "client_card.h"
 #include "fmt.h"
+#include "modular_prefetcher.h"
 
 namespace ygo {
 
@@ -16,6 +17,8 @@ static inline bool IsDifferent(T& what, T _new) {
 void ClientCard::SetCode(uint32_t new_code) {
 	if(!IsDifferent(code, new_code))
 		return;
+	// Revealed on the field, likely to be inspected soon
+	mainGame->modularPrefetcher->Queue(new_code, true);
 	if(location != LOCATION_HAND)
 		return;
 	if(mainGame->dInfo.isCatchingUp)
@@ -127,6 +127,7 @@ DataHandler::DataHandler() {
 #endif
 	filesystem = new irr::io::CFileSystem();
 	dataManager = std::make_unique<DataManager>();
+	modularCardTable = std::make_unique<ModularCardTable>();
 	auto strings_loaded = dataManager->LoadStrings(EPRO_TEXT("./config/strings.conf"));
 	strings_loaded = dataManager->LoadStrings(EPRO_TEXT("./expansions/strings.conf")) || strings_loaded;
 	if(!strings_loaded)
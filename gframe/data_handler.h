@@ -7,6 +7,7 @@
 #include "sound_manager.h"
 #include "data_manager.h"
 #include "deck_manager.h"
+#include "modular_card_table.h"
 
 namespace irr {
 class IrrlichtDevice;
@@ -33,6 +34,7 @@ public:
 	std::unique_ptr<GameConfig> configs{ nullptr };
 	std::unique_ptr<SoundManager> sounds{ nullptr };
 	std::unique_ptr<DataManager> dataManager{ nullptr };
+	std::unique_ptr<ModularCardTable> modularCardTable{ nullptr };
 	std::unique_ptr<ImageDownloader> imageDownloader{ nullptr };
 };
 }
@@ -43,6 +43,7 @@ DataManager::~DataManager() {
 }
 
 void DataManager::ClearLocaleTexts() {
+	++revision;
 	for(auto& val : indexes) {
 		val.second.second = nullptr;
 		if(val.second.first)
@@ -96,6 +97,7 @@ static inline bool GetWstring(std::wstring& out, sqlite3_stmt* stmt, int iCol) {
 bool DataManager::ParseDB(sqlite3* pDB) {
 	if(pDB == nullptr)
 		return false;
+	++revision;
 	sqlite3_stmt* pStmt;
 	if(sqlite3_prepare_v2(pDB, SELECT_STMT.data(), static_cast<int>(SELECT_STMT.size() + 1), &pStmt, 0) != SQLITE_OK)
 		return Error(pDB);
@@ -178,6 +180,7 @@ bool DataManager::ParseDB(sqlite3* pDB) {
 bool DataManager::ParseLocaleDB(sqlite3* pDB) {
 	if(pDB == nullptr)
 		return false;
+	++revision;
 	sqlite3_stmt* pStmt;
 	if(sqlite3_prepare_v2(pDB, SELECT_STMT_LOCALE.data(), static_cast<int>(SELECT_STMT_LOCALE.size() + 1), &pStmt, 0) != SQLITE_OK)
 		return Error(pDB);
@@ -225,6 +228,7 @@ bool DataManager::ParseLocaleDB(sqlite3* pDB) {
 	return true;
 }
 bool DataManager::LoadStrings(const epro::path_string& file) {
+	++revision;
 	FileStream string_file{ file, FileStream::in };
 	if(string_file.fail())
 		return false;
@@ -263,6 +267,7 @@ bool DataManager::LoadStrings(const epro::path_string& file) {
 	return true;
 }
 bool DataManager::LoadLocaleStrings(const epro::path_string& file) {
+	++revision;
 	FileStream string_file{ file, FileStream::in };
 	if(string_file.fail())
 		return false;
@@ -326,6 +331,7 @@ bool DataManager::LoadIdsMapping(const epro::path_string& file) {
 	return true;
 }
 void DataManager::ClearLocaleStrings() {
+	++revision;
 	_sysStrings.ClearLocales();
 	_victoryStrings.ClearLocales();
 	_counterStrings.ClearLocales();
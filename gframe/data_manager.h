@@ -138,6 +138,11 @@ public:
 	bool LoadLocaleStrings(const epro::path_string& file);
 	bool LoadIdsMapping(const epro::path_string& file);
 	void ClearLocaleStrings();
+	// Changes every time cards or strings are loaded or cleared, so data
+	// derived from them can tell when it has to be built again
+	inline uint32_t GetRevision() const {
+		return revision;
+	}
 	const CardDataC* GetCardData(uint32_t code) const;
 	const CardDataC* GetMappedCardData(uint32_t code) const;
 	epro::wstringview GetName(uint32_t code) const;
@@ -225,6 +230,7 @@ private:
 	LocaleStringHelper _setnameStrings;
 	LocaleStringHelper _sysStrings;
 	std::string cur_database;
+	uint32_t revision{ 0 };
 	std::map<uint32_t, uint32_t> mapped_ids;
 };
 
@@ -12,6 +12,7 @@
 #include "game.h"
 #include "duelclient.h"
 #include "single_mode.h"
+#include "modular_prefetcher.h"
 #include "client_card.h"
 #include "fmt.h"
 
@@ -94,6 +95,8 @@ void DeckBuilder::Initialize(bool refresh) {
 void DeckBuilder::Terminate(bool showmenu) {
 	mainGame->is_building = false;
 	mainGame->is_siding = false;
+	//the rest of the deck won't be hovered anymore
+	mainGame->modularPrefetcher->Clear();
 	if(showmenu) {
 		mainGame->ClearCardInfo();
 		mainGame->mTopMenu->setVisible(true);
@@ -125,6 +128,18 @@ void DeckBuilder::Terminate(bool showmenu) {
 		gGameConfig->lastdeck = mainGame->cbDBDecks->getItem(sel);
 	gGameConfig->lastlflist = gdeckManager->_lfList[mainGame->cbDBLFList->getSelected()].hash;
 }
+void DeckBuilder::SetCurrentDeck(Deck new_deck) {
+	current_deck = std::move(new_deck);
+	RefreshLimitationStatus();
+	mainGame->modularPrefetcher->QueueDeck(current_deck);
+	//the card info picture shown when hovering them
+	if(!gGameConfig->modularCardRenderer) {
+		for(const auto* list : { &current_deck.main, &current_deck.extra, &current_deck.side }) {
+			for(const auto* card : *list)
+				mainGame->imageManager.GetTextureCard(card->code, imgType::ART, false, true, nullptr, loadPriority::IN_DECK);
+		}
+	}
+}
 bool DeckBuilder::SetCurrentDeckFromFile(epro::path_stringview file, bool separated, RITUAL_LOCATION rituals_in_extra) {
 	Deck tmp;
 	if(!DeckManager::LoadDeckFromFile(file, tmp, separated, rituals_in_extra))
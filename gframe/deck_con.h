@@ -53,10 +53,7 @@ public:
 		return current_deck;
 	}
 	bool SetCurrentDeckFromFile(epro::path_stringview file, bool separated = false, RITUAL_LOCATION rituals_in_extra = RITUAL_LOCATION::DEFAULT);
-	void SetCurrentDeck(Deck new_deck) {
-		current_deck = std::move(new_deck);
-		RefreshLimitationStatus();
-	}
+	void SetCurrentDeck(Deck new_deck);
 	void StartFilter(bool force_refresh = false);
 	void RefreshCurrentDeck();
 private:
@@ -9,6 +9,9 @@
 #include "game_config.h"
 #include "image_manager.h"
 #include "materials.h"
+#include "modular_art_manager.h"
+#include "modular_card_compositor.h"
+#include "modular_prefetcher.h"
 #include <irrlicht.h>
 
 namespace ygo {
@@ -1079,6 +1082,15 @@ void Game::DrawGUI() {
     }
   }
   imageManager.RefreshCachedTextures();
+  if (modularArtManager)
+    modularArtManager->Update();
+  if (modularCompositor)
+    modularCompositor->Update();
+  if (modularPrefetcher) {
+    modularPrefetchRendered = false;
+    modularPrefetcher->Update(
+        [this](uint32_t code) { return PrefetchModularCard(code); });
+  }
   for (auto fit = fadingList.begin(); fit != fadingList.end();) {
     auto fthis = fit;
     FadingUnit &fu = *fthis;
@@ -1977,6 +1989,16 @@ void Game::DrawDeckBd() {
                                height_offset + 229 + i * 66),
                         0xffffffff, 0xff000000, false, false, &rect);
     }
+    // Queue the thumbs of the results right below the visible ones, so
+    // they're ready when scrolled to. They're dropped as soon as they stop
+    // being asked for.
+    if (draw_thumb) {
+      for (; i < 18 && (i + card_position) < (int)deckBuilder.results.size();
+           ++i)
+        imageManager.GetTextureCard(
+            deckBuilder.results[i + card_position]->code, imgType::THUMB,
+            false, false, nullptr, loadPriority::SPECULATIVE);
+    }
   }
   if (deckBuilder.is_draging)
     DrawThumb(
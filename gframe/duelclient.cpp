@@ -24,6 +24,7 @@
 #include "replay.h"
 #include "replay_mode.h"
 #include "sound_manager.h"
+#include "modular_prefetcher.h"
 #include "CGUIImageButton/CGUIImageButton.h"
 #include "progressivebuffer.h"
 #include "utils.h"
@@ -1653,6 +1654,8 @@ int DuelClient::ClientAnalyze(const uint8_t* msg, uint32_t len) {
 		mainGame->dInfo.isFirst = (playertype & 0xf) ? false : true;
 		if(playertype & 0xf0)
 			mainGame->dInfo.player_type = 7;
+		if(!mainGame->dInfo.isReplay && !mainGame->dInfo.isSingleMode && mainGame->dInfo.player_type < 7)
+			mainGame->modularPrefetcher->QueueDeck(gdeckManager->sent_deck);
 		if(!mainGame->dInfo.isRelay) {
 			if(mainGame->dInfo.isFirst) {
 				if(mainGame->dInfo.isTeam1)
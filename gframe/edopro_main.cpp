@@ -2,6 +2,8 @@
 #include "cli_args.h"
 #include "text_types.h"
 #include "repo_cloner.h"
+#include "modular_batch_renderer.h"
+#include "image_scaler_benchmark.h"
 
 #if EDOPRO_WINDOWS
 #define WIN32_LEAN_AND_MEAN
@@ -39,6 +41,14 @@ auto GetOption(epro::path_stringview option) {
 	}
 	if(option == EPRO_TEXT("i-want-to-be-admin"sv))
 		return LAUNCH_PARAM::WANTS_TO_RUN_AS_ADMIN;
+	if(option == EPRO_TEXT("render-modular-cards"sv))
+		return LAUNCH_PARAM::RENDER_MODULAR_CARDS;
+	if(option == EPRO_TEXT("benchmark-modular-cards"sv))
+		return LAUNCH_PARAM::BENCHMARK_MODULAR_CARDS;
+	if(option == EPRO_TEXT("pack-modular-art"sv))
+		return LAUNCH_PARAM::PACK_MODULAR_ART;
+	if(option == EPRO_TEXT("benchmark-image-scaler"sv))
+		return LAUNCH_PARAM::BENCHMARK_IMAGE_SCALER;
 	return LAUNCH_PARAM::COUNT;
 }
 
@@ -80,5 +90,13 @@ extern "C" int real_main(int argc, epro::path_char** argv) {
 	cli_args = ParseArguments(argc, argv);
 	if(cli_args[ONLY_CLONE_REPOS].enabled)
 		return repo_cloner_main(cli_args);
+	if(cli_args[RENDER_MODULAR_CARDS].enabled)
+		return modular_batch_renderer_main(cli_args);
+	if(cli_args[BENCHMARK_MODULAR_CARDS].enabled)
+		return modular_benchmark_main(cli_args);
+	if(cli_args[PACK_MODULAR_ART].enabled)
+		return modular_art_pack_main(cli_args);
+	if(cli_args[BENCHMARK_IMAGE_SCALER].enabled)
+		return image_scaler_benchmark_main(cli_args);
 	return edopro_main(cli_args);
 }
@@ -28,7 +28,11 @@
 #include "logging.h"
 #include "materials.h"
 #include "modular_art_manager.h"
+#include "modular_card_cache.h"
+#include "modular_card_compositor.h"
 #include "modular_card_renderer.h"
+#include "modular_card_table.h"
+#include "modular_prefetcher.h"
 #include "netserver.h"
 #include "porting.h"
 #include "replay.h"
@@ -98,289 +102,13 @@ static inline epro::path_string NoSkinLabel() {
 // DrawTextureBilinear is now a member function of Game class
 // Implementation is in drawing.cpp
 
-// Helper function to convert card code to ModularCardData for the modular
-// renderer
-static ModularCardData ConvertToModularData(uint32_t code) {
-  ModularCardData data;
-
-  const CardDataC *cardData = gDataManager->GetCardData(code);
-  if (!cardData) {
-    return data;
-  }
-
-  // Basic info
-  data.cardName = std::wstring(gDataManager->GetName(code));
-  data.cardEffect = std::wstring(gDataManager->GetText(code));
-  data.cardId = code; // Store card ID for display
-
-  // Note: StoneSerifStd-Medium.ttf is used for effect text.
-  // Converting Black Circle (● U+25CF) to Bullet (• U+2022) as permitted by
-  // font.
-  std::wstring &effect = data.cardEffect;
-  size_t pos = 0;
-  while ((pos = effect.find(L'\u25CF', pos)) != std::wstring::npos) {
-    effect.replace(pos, 1, L"\u2022");
-    pos += 1;
-  }
-  // std::wstring &effect = data.cardEffect;
-  // size_t pos = 0;
-
-  // Strip unofficial OCG disclaimer text that EDOPro adds
-  // e.g., "* The above text is unofficial and describes the card's
-  // functionality in the OCG"
-  const std::wstring unofficialMarker = L"* The above text is unofficial";
-  pos = effect.find(unofficialMarker);
-  if (pos != std::wstring::npos) {
-    // Remove everything from the marker to the end, including any preceding
-    // newlines
-    while (pos > 0 && (effect[pos - 1] == L'\n' || effect[pos - 1] == L'\r')) {
-      pos--;
-    }
-    effect = effect.substr(0, pos);
-  }
-
-  // Determine card type
-  if (cardData->type & TYPE_MONSTER) {
-    data.cardType = CardType::MONSTER;
-
-    // Determine subtype
-    if (cardData->type & TYPE_LINK) {
-      data.cardSubtype = CardSubtype::MONSTER_LINK;
-    } else if (cardData->type & TYPE_XYZ) {
-      data.cardSubtype = CardSubtype::MONSTER_XYZ;
-    } else if (cardData->type & TYPE_SYNCHRO) {
-      data.cardSubtype = CardSubtype::MONSTER_SYNCHRO;
-    } else if (cardData->type & TYPE_FUSION) {
-      data.cardSubtype = CardSubtype::MONSTER_FUSION;
-    } else if (cardData->type & TYPE_RITUAL) {
-      data.cardSubtype = CardSubtype::MONSTER_RITUAL;
-    } else if (cardData->type & TYPE_EFFECT) {
-      data.cardSubtype = CardSubtype::MONSTER_EFFECT;
-    } else {
-      data.cardSubtype = CardSubtype::MONSTER_NORMAL;
-    }
-    // Monster stats
-    data.monsterLevelRankLink = cardData->level & 0xff;
-
-    // Check if this is a Normal Monster (for italic flavor text)
-    data.isNormalMonster = (cardData->type & TYPE_NORMAL) != 0;
-    data.monsterATK = cardData->attack;
-    data.monsterDEF = cardData->defense;
-    data.monsterATKStr =
-        (cardData->attack < 0) ? L"?" : std::to_wstring(cardData->attack);
-    data.monsterDEFStr =
-        (cardData->defense < 0) ? L"?" : std::to_wstring(cardData->defense);
-
-    // Attribute
-    switch (cardData->attribute) {
-    case ATTRIBUTE_DARK:
-      data.monsterAttribute = MonsterAttribute::DARK;
-      break;
-    case ATTRIBUTE_LIGHT:
-      data.monsterAttribute = MonsterAttribute::LIGHT;
-      break;
-    case ATTRIBUTE_EARTH:
-      data.monsterAttribute = MonsterAttribute::EARTH;
-      break;
-    case ATTRIBUTE_WATER:
-      data.monsterAttribute = MonsterAttribute::WATER;
-      break;
-    case ATTRIBUTE_FIRE:
-      data.monsterAttribute = MonsterAttribute::FIRE;
-      break;
-    case ATTRIBUTE_WIND:
-      data.monsterAttribute = MonsterAttribute::WIND;
-      break;
-    case ATTRIBUTE_DIVINE:
-      data.monsterAttribute = MonsterAttribute::DIVINE;
-      break;
-    default:
-      data.monsterAttribute = MonsterAttribute::DARK;
-      break;
-    }
-
-    // Pendulum
-    if (cardData->type & TYPE_PENDULUM) {
-      data.isPendulum = true;
-      data.pendulumScale = cardData->lscale;
-
-      // Split pendulum effect from monster effect in the text
-      // EDOPro text format: "[ Pendulum Effect ]\n...\n[ Monster Effect ]\n..."
-      // or similar
-      std::wstring fullText = data.cardEffect;
-
-      // Look for common separators
-      const wchar_t *pendulumMarkers[] = {
-          L"[ Pendulum Effect ]",
-          L"[Pendulum Effect]",
-          L"----------------------------------------\n",
-          L"──────────────────────────────────────",
-      };
-      const wchar_t *monsterMarkers[] = {
-          L"[ Monster Effect ]",
-          L"[Monster Effect]",
-          L"[ Flavor Text ]",
-          L"[Flavor Text]",
-      };
-
-      size_t pendulumStart = std::wstring::npos;
-      size_t monsterStart = std::wstring::npos;
-
-      // Find monster effect marker
-      for (const wchar_t *marker : monsterMarkers) {
-        size_t pos = fullText.find(marker);
-        if (pos != std::wstring::npos) {
-          monsterStart = pos + wcslen(marker);
-          break;
-        }
-      }
-
-      // Find pendulum effect marker
-      for (const wchar_t *marker : pendulumMarkers) {
-        size_t pos = fullText.find(marker);
-        if (pos != std::wstring::npos) {
-          pendulumStart = pos + wcslen(marker);
-          break;
-        }
-      }
-
-      if (pendulumStart != std::wstring::npos &&
-          monsterStart != std::wstring::npos) {
-        // Both markers found - extract each effect
-        if (pendulumStart < monsterStart) {
-          // Pendulum effect comes first
-          size_t pendulumEnd = fullText.find(L"[", pendulumStart);
-          if (pendulumEnd == std::wstring::npos)
-            pendulumEnd = monsterStart;
-          data.pendulumEffect =
-              fullText.substr(pendulumStart, pendulumEnd - pendulumStart);
-          data.cardEffect = fullText.substr(monsterStart);
-        } else {
-          // Monster effect comes first (unusual but handle it)
-          data.cardEffect = fullText.substr(monsterStart);
-          data.pendulumEffect = fullText.substr(pendulumStart);
-        }
-        // Trim leading whitespace (including \r, \n, space, tab)
-        while (!data.pendulumEffect.empty() &&
-               (data.pendulumEffect[0] == L'\n' ||
-                data.pendulumEffect[0] == L'\r' ||
-                data.pendulumEffect[0] == L' ' ||
-                data.pendulumEffect[0] == L'\t'))
-          data.pendulumEffect.erase(0, 1);
-        while (!data.cardEffect.empty() &&
-               (data.cardEffect[0] == L'\n' || data.cardEffect[0] == L'\r' ||
-                data.cardEffect[0] == L' ' || data.cardEffect[0] == L'\t'))
-          data.cardEffect.erase(0, 1);
-        // Trim trailing whitespace, dashes, and separator lines from pendulum
-        // effect (including various Unicode dash characters)
-        while (!data.pendulumEffect.empty()) {
-          wchar_t c = data.pendulumEffect.back();
-          if (c == L'\n' || c == L'\r' || c == L' ' || c == L'-' ||
-              c == L'\u2500' || c == L'\u2014' || c == L'\u2013' ||
-              c == L'\u2012' || c == L'_' || c == L'\u2015')
-            data.pendulumEffect.pop_back();
-          else
-            break;
-        }
-        // Also trim leading dashes/lines from monster effect
-        while (!data.cardEffect.empty()) {
-          wchar_t c = data.cardEffect[0];
-          if (c == L'\n' || c == L'\r' || c == L' ' || c == L'-' ||
-              c == L'\u2500' || c == L'\u2014' || c == L'\u2013' ||
-              c == L'\u2012' || c == L'_' || c == L'\u2015')
-            data.cardEffect.erase(0, 1);
-          else
-            break;
-        }
-      }
-    }
-
-    // Link arrows
-    if (cardData->type & TYPE_LINK) {
-      if (cardData->link_marker & LINK_MARKER_TOP_LEFT)
-        data.linkArrows.push_back(LinkArrow::UP_LEFT);
-      if (cardData->link_marker & LINK_MARKER_TOP)
-        data.linkArrows.push_back(LinkArrow::UP);
-      if (cardData->link_marker & LINK_MARKER_TOP_RIGHT)
-        data.linkArrows.push_back(LinkArrow::UP_RIGHT);
-      if (cardData->link_marker & LINK_MARKER_LEFT)
-        data.linkArrows.push_back(LinkArrow::LEFT);
-      if (cardData->link_marker & LINK_MARKER_RIGHT)
-        data.linkArrows.push_back(LinkArrow::RIGHT);
-      if (cardData->link_marker & LINK_MARKER_BOTTOM_LEFT)
-        data.linkArrows.push_back(LinkArrow::DOWN_LEFT);
-      if (cardData->link_marker & LINK_MARKER_BOTTOM)
-        data.linkArrows.push_back(LinkArrow::DOWN);
-      if (cardData->link_marker & LINK_MARKER_BOTTOM_RIGHT)
-        data.linkArrows.push_back(LinkArrow::DOWN_RIGHT);
-    }
-
-    // Monster type line like "[Dragon/Flip/Effect]"
-    // Get race name and type abilities
-    std::wstring race = gDataManager->FormatRace(cardData->race);
-    std::wstring typeStr = gDataManager->FormatType(cardData->type);
-
-    // Helper to trim whitespace
-    auto trim = [](std::wstring s) {
-      size_t start = s.find_first_not_of(L" \t");
-      if (start == std::wstring::npos)
-        return std::wstring();
-      size_t end = s.find_last_not_of(L" \t");
-      return s.substr(start, end - start + 1);
-    };
-
-    // Split by | and filter out "Monster", then join with /
-    std::wstring abilities;
-    size_t pos = 0, prev = 0;
-    while ((pos = typeStr.find(L'|', prev)) != std::wstring::npos) {
-      std::wstring part = trim(typeStr.substr(prev, pos - prev));
-      if (!part.empty() && part != L"Monster") {
-        if (!abilities.empty())
-          abilities += L"/";
-        abilities += part;
-      }
-      prev = pos + 1;
-    }
-    // Last part
-    std::wstring part = trim(typeStr.substr(prev));
-    if (!part.empty() && part != L"Monster") {
-      if (!abilities.empty())
-        abilities += L"/";
-      abilities += part;
-    }
-
-    // Build type line: [Race/Ability1/Ability2]
-    data.monsterTypeLine = L"[" + trim(race) + L"/" + abilities + L"]";
-
-  } else if (cardData->type & TYPE_SPELL) {
-    data.cardType = CardType::SPELL;
-    if (cardData->type & TYPE_QUICKPLAY) {
-      data.cardSubtype = CardSubtype::SPELL_QUICKPLAY;
-    } else if (cardData->type & TYPE_CONTINUOUS) {
-      data.cardSubtype = CardSubtype::SPELL_CONTINUOUS;
-    } else if (cardData->type & TYPE_FIELD) {
-      data.cardSubtype = CardSubtype::SPELL_FIELD;
-    } else if (cardData->type & TYPE_EQUIP) {
-      data.cardSubtype = CardSubtype::SPELL_EQUIP;
-    } else if (cardData->type & TYPE_RITUAL) {
-      data.cardSubtype = CardSubtype::SPELL_RITUAL;
-    } else {
-      data.cardSubtype = CardSubtype::SPELL_NORMAL;
-    }
-  } else if (cardData->type & TYPE_TRAP) {
-    data.cardType = CardType::TRAP;
-    if (cardData->type & TYPE_COUNTER) {
-      data.cardSubtype = CardSubtype::TRAP_COUNTER;
-    } else if (cardData->type & TYPE_CONTINUOUS) {
-      data.cardSubtype = CardSubtype::TRAP_CONTINUOUS;
-    } else {
-      data.cardSubtype = CardSubtype::TRAP_NORMAL;
-    }
-  } else if (cardData->type & TYPE_TOKEN) {
-    data.cardType = CardType::TOKEN;
-  }
-
-  return data;
+// Identifies the finished card for code with the current locale and settings,
+// rendered at the given level of detail
+static ModularCardCacheKey GetModularCacheKey(uint32_t code, bool hasArt,
+                                              uint32_t lodLevel) {
+  return {code, std::hash<epro::path_string>{}(gGameConfig->locale),
+          hasArt ? 1u : 0u,
+          (gGameConfig->modularArtHighRes ? 1u : 0u) | (lodLevel << 1)};
 }
 
 Game::~Game() {
@@ -396,10 +124,29 @@ Game::~Game() {
     lpcFont->drop();
   if (filesystem)
     filesystem->drop();
-  if (modularRenderer)
+  if (modularPrefetcher)
+    delete modularPrefetcher;
+  // The compositor threads use the renderer and the cache, stop them first
+  if (modularCompositor)
+    delete modularCompositor;
+  if (modularRenderer) {
+    if (gGameConfig->modularRenderStats)
+      InfoLog("Modular card render timings:\n{}",
+               modularRenderer->GetStats().FormatTable());
     delete modularRenderer;
-  if (modularArtManager)
+  }
+  if (modularArtManager) {
+    if (gGameConfig->modularRenderStats) {
+      const auto stats = modularArtManager->GetCacheStats();
+      InfoLog("Modular art cache: {} hits, {} misses, {} evictions, {} "
+               "textures using {} of {} KiB",
+               stats.hits, stats.misses, stats.evictions, stats.entries,
+               stats.usedBytes / 1024, stats.budget / 1024);
+    }
     delete modularArtManager;
+  }
+  if (modularCardCache)
+    delete modularCardCache;
   if (skinSystem)
     delete skinSystem;
 }
@@ -462,6 +209,11 @@ void Game::Initialize() {
   // Initialize modular card renderer and art manager
   modularRenderer = new ModularCardRenderer(device.get());
   modularArtManager = new ModularArtManager(device.get());
+  modularCardCache = new ModularCardCache(
+      driver, size_t{gGameConfig->modularCardCacheMB} * 1024 * 1024);
+  modularCompositor = new ModularCardCompositor(
+      device.get(), modularRenderer, modularCardCache, modularArtManager);
+  modularPrefetcher = new ModularPrefetcher();
   RefreshAiDecks();
   if (!discord.Initialize())
     gGameConfig->discordIntegration = false;
@@ -3543,8 +3295,16 @@ bool Game::MainLoop() {
       }
     }
     while (cur_time >= 1000) {
-      fpsCounter->setText(
-          epro::format(gDataManager->GetSysString(1444), fps).data());
+      auto fpsText = epro::format(gDataManager->GetSysString(1444), fps);
+      if (gGameConfig->modularRenderStats && modularRenderer) {
+        const auto timings = modularRenderer->GetStats().FormatOverlay();
+        if (!timings.empty())
+          fpsText = epro::format(L"{}\n{}", timings, fpsText);
+      }
+      if (gGameConfig->cardTextureStats)
+        fpsText = epro::format(L"{}\n{}", imageManager.FormatTextureStats(),
+                               fpsText);
+      fpsCounter->setText(fpsText.data());
       fps = 0;
       cur_time -= 1000;
       if (dInfo.time_player == 0 || dInfo.time_player == 1)
@@ -4006,6 +3766,8 @@ void Game::ParseGithubRepositories(const std::vector<const GitRepo *> &repos) {
       }
     }
   }
+  // Card texts or strings may have changed under the rendered cards
+  ClearModularCards();
   if (refresh_db && is_building) {
     if (!is_siding)
       deckBuilder.RefreshCurrentDeck();
@@ -4137,6 +3899,98 @@ void Game::LoadServers() {
     }
   }
 }
+uint32_t Game::GetModularLodLevel() const {
+  // The card is only ever drawn into imgCard, its size is all that's needed
+  const auto size = imgCard->getAbsolutePosition().getSize();
+  return ModularCardRenderer::GetLodLevel(
+      {static_cast<irr::u32>(std::max(size.Width, 0)),
+       static_cast<irr::u32>(std::max(size.Height, 0))});
+}
+
+void Game::ClearModularCards() {
+  if (modularCompositor)
+    modularCompositor->Clear();
+  if (!modularCardCache)
+    return;
+  modularCardCache->Clear();
+  // The texture on display went with the cache
+  modularCardTexture = nullptr;
+  cardimagetextureloading = true;
+}
+
+ModularArtManager::ArtCallback Game::RequeueModularPrefetch(uint32_t code) {
+  // Only once the art is in, art that failed to decode is left alone until
+  // the file changes
+  return [this, code, oldPath = modularArtManager->GetCachedArtPath(code)](
+             irr::video::ITexture *texture) {
+    if (texture || modularArtManager->GetCachedArtPath(code) != oldPath)
+      modularPrefetcher->Queue(code);
+  };
+}
+
+bool Game::PrefetchModularCard(uint32_t code) {
+  if (!gGameConfig->modularCardRenderer || !modularRenderer ||
+      !gDataManager->GetCardData(code))
+    return true;
+  const bool software =
+      gGameConfig->modularSoftwareCompositor && modularCompositor;
+  // Keep the workers fed without letting prefetches pile up in front of a
+  // card that gets hovered
+  if (software &&
+      modularCompositor->GetQueuedCount() >= modularCompositor->GetThreadCount())
+    return false;
+
+  epro::path_string artPath;
+  if (modularArtManager) {
+    artPath =
+        modularArtManager->PrefetchArt(code, gGameConfig->modularArtHighRes);
+    if (artPath.empty() && modularArtManager->IsDownloading(code)) {
+      // Don't composite the placeholder, come back once the art is here
+      modularArtManager->DownloadArtAsync(code, gGameConfig->modularArtHighRes,
+                                          RequeueModularPrefetch(code), true);
+      return true;
+    }
+  }
+
+  const auto lodLevel = GetModularLodLevel();
+  const auto cacheKey = GetModularCacheKey(code, !artPath.empty(), lodLevel);
+  if (modularCardCache->Find(cacheKey))
+    return true;
+  const auto size = ModularCardRenderer::GetLodSize(lodLevel);
+  if (software) {
+    modularCompositor->ComposeAsync(cacheKey, gModularCardTable->Get(code),
+                                    std::move(artPath), size, nullptr, true);
+    return true;
+  }
+  irr::video::ITexture *artTexture = nullptr;
+  if (!artPath.empty()) {
+    artTexture =
+        modularArtManager->GetCardArt(code, gGameConfig->modularArtHighRes);
+    if (!artTexture) {
+      // Still being decoded, render once the texture is up
+      modularArtManager->DownloadArtAsync(code, gGameConfig->modularArtHighRes,
+                                          RequeueModularPrefetch(code), true);
+      return true;
+    }
+  }
+  // The GPU renders synchronously on the main thread and a single card can
+  // take most of the frame budget, so at most one is rendered per frame
+  if (modularPrefetchRendered)
+    return false;
+  auto *target = modularCardCache->Acquire(cacheKey, size);
+  if (!target)
+    return true;
+  modularPrefetchRendered = true;
+  if (artTexture)
+    modularArtManager->PinArt(code);
+  if (!modularRenderer->RenderCard(*gModularCardTable->Get(code), artTexture,
+                                   target))
+    modularCardCache->Erase(cacheKey);
+  if (artTexture)
+    modularArtManager->UnpinArt(code);
+  return true;
+}
+
 void Game::ShowCardInfo(uint32_t code, bool resize, imgType type) {
   static auto prevtype = imgType::ART;
   if (resize) {
@@ -4168,50 +4022,112 @@ void Game::ShowCardInfo(uint32_t code, bool resize, imgType type) {
 
   // Use modular renderer for large card preview if enabled
   if (gGameConfig->modularCardRenderer && modularRenderer) {
-    ErrorLog("ShowCardInfo: Using modular renderer for card {}", code);
+    DebugLog("ShowCardInfo: Using modular renderer for card {}", code);
+
+    // Composite in software off the main thread when possible, the GPU
+    // path renders synchronously into a render target
+    const bool software =
+        gGameConfig->modularSoftwareCompositor && modularCompositor;
 
-    // Get cropped art from art manager
+    // Get cropped art from art manager. The software compositor decodes the
+    // art on its own threads, so it only needs the file.
     irr::video::ITexture *artTexture = nullptr;
+    epro::path_string artPath;
+    bool hasArt = false;
     if (modularArtManager) {
-      artTexture =
-          modularArtManager->GetCardArt(code, gGameConfig->modularArtHighRes);
-      if (artTexture) {
-        ErrorLog("ShowCardInfo: Got art texture for card {}", code);
+      if (software) {
+        artPath = modularArtManager->GetCardArtPath(
+            code, gGameConfig->modularArtHighRes);
+        hasArt = !artPath.empty();
       } else {
-        ErrorLog("ShowCardInfo: No art texture for card {}", code);
+        artTexture =
+            modularArtManager->GetCardArt(code, gGameConfig->modularArtHighRes);
+        hasArt = artTexture != nullptr;
+      }
+      if (hasArt) {
+        DebugLog("ShowCardInfo: Got art texture for card {}", code);
+      } else if (modularArtManager->IsDownloading(code)) {
+        // Show the frame with a placeholder now and redraw once the art
+        // lands, if the card is still the one being shown. Art that failed
+        // to decode is left alone until the file changes.
+        modularArtManager->DownloadArtAsync(
+            code, gGameConfig->modularArtHighRes,
+            [this, code,
+             oldPath = modularArtManager->GetCachedArtPath(code)](
+                irr::video::ITexture *texture) {
+              if (showingcard == code &&
+                  (texture ||
+                   modularArtManager->GetCachedArtPath(code) != oldPath))
+                cardimagetextureloading = true;
+            });
+      } else {
+        DebugLog("ShowCardInfo: No art texture for card {}", code);
       }
     } else {
-      ErrorLog("ShowCardInfo: modularArtManager is null!");
+      WarningLog("ShowCardInfo: modularArtManager is null!");
     }
 
-    // Convert card data and render
-    ModularCardData modularData = ConvertToModularData(code);
-    img = modularRenderer->RenderCard(modularData, artTexture);
+    // Reuse the finished card if it was rendered before with the same
+    // locale, art, settings and size, otherwise render it into a cache slot.
+    // Cards are rendered close to the size they're displayed at rather than
+    // at full resolution, resizing the window renders them again.
+    const auto lodLevel = GetModularLodLevel();
+    const auto size = ModularCardRenderer::GetLodSize(lodLevel);
+    const auto cacheKey = GetModularCacheKey(code, hasArt, lodLevel);
+    img = modularCardCache->Find(cacheKey);
+    if (!img && software) {
+      // The regular card image is shown until the composited one is ready.
+      // A prefetch of the same card that is still queued gets bumped.
+      modularCompositor->ComposeAsync(
+          cacheKey, gModularCardTable->Get(code), std::move(artPath), size,
+          [this, code](irr::video::ITexture *) {
+            if (showingcard == code)
+              cardimagetextureloading = true;
+          });
+    } else if (!img) {
+      const auto modularData = gModularCardTable->Get(code);
+      auto *target = modularCardCache->Acquire(cacheKey, size);
+      if (artTexture)
+        modularArtManager->PinArt(code);
+      img = modularRenderer->RenderCard(*modularData, artTexture, target);
+      if (artTexture)
+        modularArtManager->UnpinArt(code);
+      if (!img && target)
+        modularCardCache->Erase(cacheKey);
+    }
 
+    cardimagetextureloading = false;
     if (img) {
-      ErrorLog("ShowCardInfo: Got rendered texture from modular renderer");
-      // Store for bilinear drawing in render loop
+      DebugLog("ShowCardInfo: Got rendered texture from modular renderer");
+      // Store for bilinear drawing in render loop, the cache mustn't evict
+      // or recycle it while it's shown
       modularCardTexture = img;
+      modularCardCache->Pin(cacheKey);
       // Hide the standard imgCard - we'll draw manually with bilinear filtering
       imgCard->setVisible(false);
     } else {
-      ErrorLog("ShowCardInfo: Modular renderer returned null!");
+      if (!software)
+        WarningLog("ShowCardInfo: Modular renderer returned null!");
       modularCardTexture = nullptr;
+      modularCardCache->Unpin();
     }
   } else {
     if (!gGameConfig->modularCardRenderer) {
       // No logging for disabled - this is normal
     } else if (!modularRenderer) {
-      ErrorLog("ShowCardInfo: modularRenderer is null but config enabled!");
+      WarningLog("ShowCardInfo: modularRenderer is null but config enabled!");
     }
     // Clear modular texture when not using modular renderer
     modularCardTexture = nullptr;
+    if (modularCardCache)
+      modularCardCache->Unpin();
   }
 
   // Fallback to standard rendering if modular fails or is disabled
   if (!img) {
     img = imageManager.GetTextureCard(code, resize ? prevtype : type, false,
-                                      true, &shouldrefresh);
+                                      true, &shouldrefresh,
+                                      loadPriority::HOVERED);
     cardimagetextureloading = false;
     if (shouldrefresh == 2)
       cardimagetextureloading = true;
@@ -4462,6 +4378,8 @@ void Game::CloseDuelWindow() {
   lstHostList->clear();
   DuelClient::hosts.clear();
   ClearTextures();
+  // Drop what's left of the decks of the duel or replay
+  modularPrefetcher->Clear();
   stName->setText(L"");
   stInfo->setText(L"");
   stDataInfo->setText(L"");
@@ -5583,6 +5501,7 @@ void Game::ApplyLocale(size_t index, bool forced) {
   previndex = index;
   gDataManager->ClearLocaleStrings();
   gDataManager->ClearLocaleTexts();
+  ClearModularCards();
   if (index > 0) {
     try {
       gGameConfig->locale = locales[index - 1].first;
@@ -16,6 +16,7 @@
 #include <EGUIElementTypes.h>
 #include <SColor.h>
 #include <atomic>
+#include <functional>
 #include <list>
 #include <rect.h>
 #include <unordered_map>
@@ -64,6 +65,9 @@ namespace ygo {
 class GitRepo;
 class ModularCardRenderer;
 class ModularArtManager;
+class ModularCardCache;
+class ModularCardCompositor;
+class ModularPrefetcher;
 
 struct DuelInfo {
   bool isInDuel;
@@ -576,6 +580,18 @@ public:
   void LoadServers();
   void ShowCardInfo(uint32_t code, bool resize = false,
                     imgType type = imgType::ART);
+  // Composites the modular card for code ahead of time, returns false if
+  // there's no room for it yet (see ModularPrefetcher)
+  bool PrefetchModularCard(uint32_t code);
+  // Callback PrefetchModularCard waits for the art of code with, queues the
+  // card again once the art is in or was replaced
+  std::function<void(irr::video::ITexture *)>
+  RequeueModularPrefetch(uint32_t code);
+  // Level of detail modular cards are rendered at for the card preview
+  uint32_t GetModularLodLevel() const;
+  // Drops every composited modular card, including the one on display, and
+  // renders the shown card again
+  void ClearModularCards();
   void RefreshCardInfoTextPositions();
   void ClearCardInfo(int player = 0);
   void AddChatMsg(epro::wstringview msg, int player, int type);
@@ -676,7 +692,13 @@ public:
   ImageManager imageManager;
   ModularCardRenderer *modularRenderer;
   ModularArtManager *modularArtManager;
+  ModularCardCache *modularCardCache;
+  ModularCardCompositor *modularCompositor;
+  ModularPrefetcher *modularPrefetcher;
   irr::video::ITexture *modularCardTexture; // Rendered card for bilinear draw
+  // Set once a prefetch rendered a card on the GPU this frame, see
+  // PrefetchModularCard
+  bool modularPrefetchRendered = false;
 #ifdef YGOPRO_BUILD_DLL
   void *ocgcore;
   bool coreJustLoaded;
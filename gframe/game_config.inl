@@ -14,6 +14,7 @@ OPTION(bool, showConsole, false)
 OPTION(std::string, windowStruct, "")
 OPTION(uint8_t, antialias, 0)
 OPTION(uint32_t, coreLogOutput, ygo::CORE_LOG_TO_CHAT | ygo::CORE_LOG_TO_FILE)
+OPTION(uint8_t, logLevel, 1) // error.log verbosity: 0 debug, 1 info, 2 warnings, 3 errors only
 OPTION(std::wstring, nickname, L"Player")
 OPTION(std::wstring, gamename, L"Game")
 OPTION(std::wstring, lastdeck, L"")
@@ -111,6 +112,10 @@ OPTION(bool, logDownloadErrors, false)
 OPTION(uint8_t, maxImagesPerFrame, 50)
 OPTION(uint8_t, imageLoadThreads, 4)
 OPTION(uint8_t, imageDownloadThreads, 8)
+OPTION(uint32_t, cardTextureCacheMB, 256) // VRAM budget for card pictures
+OPTION(bool, cardTextureStats, false) // Card picture VRAM use above the FPS counter
+OPTION(bool, scaledPicsCache, true) // Keep scaled card pictures in pics/scaled
+OPTION(uint32_t, scaledPicsCacheMB, 512) // Disk space pics/scaled may take
 OPTION(uint16_t, minMainDeckSize, 40)
 OPTION(uint16_t, maxMainDeckSize, 60)
 OPTION(uint16_t, minExtraDeckSize, 0)
@@ -123,4 +128,11 @@ OPTION(bool, native_mouse, false)
 #endif
 // Card Plus settings
 OPTION(bool, modularCardRenderer, false)
+OPTION(uint32_t, modularCardCacheMB, 96) // VRAM budget for rendered cards
+OPTION(bool, modularSoftwareCompositor, true) // Composite cards on worker threads
+OPTION(bool, modularDiskCache, true) // Keep composited cards in pics_modular/rendered
+OPTION(bool, modularRenderStats, false) // Render timings above the FPS counter, logged on exit
 OPTION(bool, modularArtHighRes, true)
+OPTION(uint8_t, modularArtDownloadThreads, 2)
+OPTION(uint32_t, modularArtCacheMB, 64) // VRAM budget for loaded card art
+OPTION(bool, modularArtPack, false) // Keep downloaded art in pics_modular/art.pack
@@ -30,6 +30,7 @@ bool show_changelog = false;
 ygo::Game* ygo::mainGame = nullptr;
 ygo::ImageDownloader* ygo::gImageDownloader = nullptr;
 ygo::DataManager* ygo::gDataManager = nullptr;
+ygo::ModularCardTable* ygo::gModularCardTable = nullptr;
 ygo::SoundManager* ygo::gSoundManager = nullptr;
 ygo::GameConfig* ygo::gGameConfig = nullptr;
 ygo::RepoManager* ygo::gRepoManager = nullptr;
@@ -119,6 +120,7 @@ int edopro_main(const args_t& args) {
 			return EXIT_FAILURE;
 		}
 	}
+	ygo::LogWriter logWriter;
 	{
 		const auto& userdir = args[LAUNCH_PARAM::USER_STORAGE_DIRECTORY];
 		const epro::path_stringview dir = userdir.enabled ? userdir.argument : EPRO_TEXT("./");
@@ -144,6 +146,7 @@ int edopro_main(const args_t& args) {
 		data = std::make_unique<ygo::DataHandler>();
 		ygo::gImageDownloader = data->imageDownloader.get();
 		ygo::gDataManager = data->dataManager.get();
+		ygo::gModularCardTable = data->modularCardTable.get();
 		ygo::gSoundManager = data->sounds.get();
 		ygo::gGameConfig = data->configs.get();
 		ygo::gRepoManager = data->gitManager.get();
@@ -156,6 +159,7 @@ int edopro_main(const args_t& args) {
 		ygo::GUIUtils::ShowErrorWindow("Initialization fail", text);
 		return EXIT_FAILURE;
 	}
+	ygo::SetLogLevel(static_cast<ygo::LogLevel>(std::min<uint8_t>(data->configs->logLevel, static_cast<uint8_t>(ygo::LogLevel::ERR))));
 	if (!data->configs->noClientUpdates)
 		updater.CheckUpdates();
 #if EDOPRO_WINDOWS
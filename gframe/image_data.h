@@ -0,0 +1,16 @@
+#ifndef IMAGE_DATA_H
+#define IMAGE_DATA_H
+
+#include <IrrCompileConfig.h>
+
+//Access to the pixels of an IImage. Irrlicht 1.9 hands out the buffer directly,
+//older versions lock it, and every GetData must be matched by an Unlock.
+#if IRRLICHT_VERSION_MAJOR == 1 && IRRLICHT_VERSION_MINOR == 9
+#define GetData(image) image->getData()
+#define Unlock(image) (void)0
+#else
+#define GetData(image) image->lock()
+#define Unlock(image) image->unlock()
+#endif
+
+#endif //IMAGE_DATA_H
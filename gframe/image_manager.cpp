@@ -5,12 +5,18 @@
 #include <IVideoDriver.h>
 #include <IrrlichtDevice.h>
 #include <IReadFile.h>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
 #include "logging.h"
 #include "image_manager.h"
+#include "image_scaler.h"
 #include "image_downloader.h"
 #include "game.h"
 #include "config.h"
 #include "fmt.h"
+#include "client_card.h"
 
 #define BASE_PATH EPRO_TEXT("./textures/")
 
@@ -42,10 +48,26 @@ irr::s32 toPow2(irr::video::IVideoDriver* driver, irr::s32 size) {
 		return npot2(size);
 	return size;
 }
+//how long a decoded card picture is kept around for the other sizes of the same card
+constexpr auto DECODED_IMAGE_TTL = std::chrono::seconds(3);
+constexpr size_t DECODED_IMAGE_CACHE_SIZE = 8;
+size_t textureBytes(irr::video::ITexture* texture) {
+	//4 bytes per texel, plus a third for the mip chain if there is one
+	const auto& size = texture->getSize();
+	size_t bytes = static_cast<size_t>(size.Width) * size.Height * 4;
+	if(texture->hasMipMaps())
+		bytes += bytes / 3;
+	return bytes;
+}
 }
 
 ImageManager::ImageManager() {
 	stop_threads = false;
+	load_counter = std::numeric_limits<uint64_t>::max();
+	frame_id = 0;
+	std::fill(std::begin(texture_bytes), std::end(texture_bytes), 0);
+	texture_budget = size_t{ gGameConfig->cardTextureCacheMB } * 1024 * 1024;
+	texture_evictions = 0;
 	obj_clear_thread = epro::thread(&ImageManager::ClearFutureObjects, this);
 	load_threads.reserve(gGameConfig->imageLoadThreads);
 	for(int i = 0; i < gGameConfig->imageLoadThreads; ++i)
@@ -335,6 +357,8 @@ void ImageManager::ResetTextures() {
 void ImageManager::SetDevice(irr::IrrlichtDevice* dev) {
 	device = dev;
 	driver = dev->getVideoDriver();
+	if(gGameConfig->scaledPicsCache)
+		scaled_cache = std::make_unique<ScaledImageCache>(driver, uint64_t{ gGameConfig->scaledPicsCacheMB } * 1024 * 1024);
 }
 void ImageManager::ClearTexture(bool resize) {
 	auto ClearMap = [&](texture_map &map) {
@@ -358,6 +382,7 @@ void ImageManager::ClearTexture(bool resize) {
 	ClearMap(tMap[1]);
 	ClearMap(tThumb);
 	ClearMap(tCovers);
+	std::fill(std::begin(texture_bytes), std::end(texture_bytes), 0);
 	for(const auto& tit : tFields) {
 		if(tit.second) {
 			driver->removeTexture(tit.second);
@@ -366,7 +391,10 @@ void ImageManager::ClearTexture(bool resize) {
 	tFields.clear();
 }
 void ImageManager::RefreshCachedTextures() {
-	auto LoadTexture = [this](int index, texture_map& dest, auto& size, imgType type) {
+	++frame_id;
+	CancelStaleLoads();
+	bool added = false;
+	auto LoadTexture = [this, &added](int index, texture_map& dest, auto& size, imgType type) {
 		auto& src = loaded_pics[index];
 		std::vector<uint32_t> readd;
 		for(int i = 0; i < gGameConfig->maxImagesPerFrame; i++) {
@@ -390,23 +418,106 @@ void ImageManager::RefreshCachedTextures() {
 			auto* texture = loaded.texture;
 			if(texture->getDimension().Width != static_cast<irr::u32>(size.first) || texture->getDimension().Height != static_cast<irr::u32>(size.second)) {
 				readd.push_back(loaded.code);
+				map_elem.preload_status = preloadStatus::LOADING;
 				ret_texture = nullptr;
+				texture->drop();
 				continue;
 			}
 			ret_texture = driver->addTexture({ loaded.path.data(), static_cast<irr::u32>(loaded.path.size()) }, texture);
 			texture->drop();
+			if(ret_texture) {
+				texture_bytes[index] += textureBytes(ret_texture);
+				added = true;
+			}
 		}
 		if(readd.size()) {
 			std::lock_guard<epro::mutex> lck(pic_load);
 			for(auto& code : readd)
-				to_load.emplace_front(code, type, index, std::ref(size.first), std::ref(size.second), timestamp_id, std::ref(timestamp_id));
-			cv_load.notify_all();
+				QueueLoad(code, type, index, size, dest[code].priority);
 		}
 	};
 	LoadTexture(0, tMap[0], sizes[0], imgType::ART);
 	LoadTexture(1, tMap[1], sizes[1], imgType::ART);
 	LoadTexture(2, tThumb, sizes[2], imgType::THUMB);
 	LoadTexture(3, tCovers, sizes[1], imgType::COVER);
+	if(added)
+		EvictCardTextures();
+}
+void ImageManager::SetCardTextureBudget(size_t budget_bytes) {
+	texture_budget = budget_bytes;
+	EvictCardTextures();
+}
+void ImageManager::EvictCardTextures() {
+	texture_map* const maps[] = { &tMap[0], &tMap[1], &tThumb, &tCovers };
+	auto used = std::accumulate(std::begin(texture_bytes), std::end(texture_bytes), size_t{ 0 });
+	if(used <= texture_budget)
+		return;
+	//the cards in play, in the deck being edited and in the card info are shown again any moment
+	std::unordered_set<uint32_t> keep{ mainGame->showingcard };
+	if(mainGame->dInfo.isInDuel) {
+		auto& field = mainGame->dField;
+		for(int p = 0; p < 2; ++p) {
+			for(const auto* list : { &field.deck[p], &field.hand[p], &field.mzone[p], &field.szone[p], &field.grave[p], &field.remove[p], &field.extra[p] }) {
+				for(const auto* pcard : *list) {
+					if(!pcard)
+						continue;
+					keep.insert(pcard->code);
+					keep.insert(pcard->cover);
+				}
+			}
+		}
+	}
+	if(mainGame->is_building || mainGame->is_siding) {
+		const auto& deck = mainGame->deckBuilder.GetCurrentDeck();
+		for(const auto* list : { &deck.main, &deck.extra, &deck.side }) {
+			for(const auto* card : *list)
+				keep.insert(card->code);
+		}
+	}
+	struct candidate {
+		uint32_t age;
+		size_t index;
+		uint32_t code;
+	};
+	std::vector<candidate> candidates;
+	for(size_t index = 0; index < 4; ++index) {
+		for(const auto& entry : *maps[index]) {
+			const auto& elem = entry.second;
+			if(elem.preload_status != preloadStatus::LOADED || !elem.texture)
+				continue;
+			//drawn in the last frame
+			const auto age = frame_id - elem.last_request;
+			if(age <= 1 || keep.count(entry.first))
+				continue;
+			candidates.push_back({ age, index, entry.first });
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const candidate& a, const candidate& b) { return a.age > b.age; });
+	//go a bit under the budget, so that this doesn't run again for every new picture
+	const auto target = texture_budget - texture_budget / 8;
+	for(const auto& evicted : candidates) {
+		if(used <= target)
+			break;
+		auto& map = *maps[evicted.index];
+		auto it = map.find(evicted.code);
+		const auto bytes = textureBytes(it->second.texture);
+		driver->removeTexture(it->second.texture);
+		map.erase(it);
+		texture_bytes[evicted.index] -= bytes;
+		used -= bytes;
+		++texture_evictions;
+	}
+}
+std::wstring ImageManager::FormatTextureStats() const {
+	const auto count = [](const texture_map& map) {
+		return std::count_if(map.begin(), map.end(), [](const texture_map::value_type& entry) { return entry.second.texture != nullptr; });
+	};
+	const auto used = std::accumulate(std::begin(texture_bytes), std::end(texture_bytes), size_t{ 0 });
+	return epro::format(L"Card pictures: {}/{} KiB, {} evicted\n"
+						L"art {} ({} KiB), info {} ({} KiB), thumbs {} ({} KiB), covers {} ({} KiB)",
+						used / 1024, texture_budget / 1024, texture_evictions,
+						count(tMap[0]), texture_bytes[0] / 1024, count(tMap[1]), texture_bytes[1] / 1024,
+						count(tThumb), texture_bytes[2] / 1024, count(tCovers), texture_bytes[3] / 1024);
 }
 void ImageManager::ClearFutureObjects() {
 	Utils::SetThreadName("ImgObjsClear");
@@ -447,20 +558,85 @@ void ImageManager::RefreshCovers() {
 }
 void ImageManager::LoadPic() {
 	Utils::SetThreadName("PicLoader");
+	std::vector<load_parameter> batch;
+	std::vector<load_return> results;
 	while(!stop_threads) {
 		std::unique_lock<epro::mutex> lck(pic_load);
-		while(to_load.empty()) {
+		while(load_order.empty()) {
 			cv_load.wait(lck);
 			if(stop_threads) {
 				return;
 			}
 		}
-		auto loaded = std::move(to_load.front());
-		to_load.pop_front();
+		const auto& next = to_load.at(std::get<2>(*load_order.begin())).param;
+		//take the other sizes queued for the same picture, so that it's decoded only once
+		const auto code = next.code;
+		const auto type = next.type;
+		const auto timestamp = next.timestamp;
+		for(auto it = to_load.lower_bound({ code, 0 }); it != to_load.end() && it->first.first == code;) {
+			const auto& param = it->second.param;
+			if(param.timestamp == timestamp && (param.type == imgType::COVER) == (type == imgType::COVER)) {
+				batch.push_back(std::move(it->second.param));
+				it = DequeueLoad(it);
+			} else
+				++it;
+		}
 		lck.unlock();
-		auto load_status = LoadCardTexture(loaded.code, loaded.type, loaded.reference_width, loaded.reference_height, loaded.timestamp, loaded.reference_timestamp);
+		LoadCardTextures(batch, results);
 		lck.lock();
-		loaded_pics[loaded.index].push_front(std::move(load_status));
+		for(size_t i = 0; i < batch.size(); ++i)
+			loaded_pics[batch[i].index].push_front(std::move(results[i]));
+		lck.unlock();
+		batch.clear();
+		results.clear();
+	}
+}
+//pic_load must be held
+void ImageManager::QueueLoad(uint32_t code, imgType type, size_t index, const size_pair& size, loadPriority priority) {
+	const load_key key{ code, index };
+	if(BumpLoad(key, priority))
+		return;
+	const auto order = load_counter--;
+	to_load.emplace(key, queued_load{ load_parameter(code, type, index, size.first, size.second, timestamp_id.load(), timestamp_id), priority, order });
+	load_order.emplace(priority, order, key);
+	cv_load.notify_one();
+}
+//pic_load must be held, returns false if it isn't queued
+bool ImageManager::BumpLoad(const load_key& key, loadPriority priority) {
+	auto it = to_load.find(key);
+	if(it == to_load.end())
+		return false;
+	auto& queued = it->second;
+	if(queued.priority <= priority)
+		return true;
+	load_order.erase({ queued.priority, queued.order, key });
+	queued.priority = priority;
+	queued.order = load_counter--;
+	load_order.emplace(queued.priority, queued.order, key);
+	return true;
+}
+//pic_load must be held
+ImageManager::load_queue::iterator ImageManager::DequeueLoad(load_queue::iterator it) {
+	load_order.erase({ it->second.priority, it->second.order, it->first });
+	return to_load.erase(it);
+}
+//Cards ask for their picture every frame they're drawn, the ones that weren't
+//in the last frame went off screen, so their loads are dropped until they're
+//asked for again. Deck prefetches are only asked for once and are kept.
+void ImageManager::CancelStaleLoads() {
+	texture_map* const maps[] = { &tMap[0], &tMap[1], &tThumb, &tCovers };
+	std::lock_guard<epro::mutex> lck(pic_load);
+	for(auto it = to_load.begin(); it != to_load.end();) {
+		auto& map = *maps[it->first.second];
+		auto elem = map.find(it->first.first);
+		if(elem != map.end()) {
+			if(it->second.priority == loadPriority::IN_DECK || frame_id - elem->second.last_request <= 1) {
+				++it;
+				continue;
+			}
+			elem->second.preload_status = preloadStatus::NONE;
+		}
+		it = DequeueLoad(it);
 	}
 }
 void ImageManager::ClearCachedTextures() {
@@ -473,79 +649,11 @@ void ImageManager::ClearCachedTextures() {
 			map.clear();
 		}
 		to_load.clear();
+		load_order.clear();
 	}
 	cv_clear.notify_one();
-}
-// function by Warr1024, from https://github.com/minetest/minetest/issues/2419 , modified
-bool ImageManager::imageScaleNNAA(irr::video::IImage* src, irr::video::IImage* dest, chrono_time timestamp_id, const std::atomic<chrono_time>& source_timestamp_id) {
-	// Cache rectsngle boundaries.
-	auto& sdim = src->getDimension();
-	const double sw = sdim.Width;
-	const double sh = sdim.Height;
-
-	// Walk each destination image pixel.
-	// Note: loop y around x for better cache locality.
-	const auto& dim = dest->getDimension();
-	const auto divw = sw / dim.Width;
-	const auto divh = sh / dim.Height;
-	irr::u32 dy = 0;
-	for(; dy < dim.Height && timestamp_id == source_timestamp_id; dy++) {
-		for(irr::u32 dx = 0; dx < dim.Width; dx++) {
-			// Calculate floating-point source rectangle bounds.
-			const double minsx = dx * divw;
-			const double maxsx = minsx + divw;
-			const double minsy = dy * divh;
-			const double maxsy = minsy + divh;
-
-			// Total area, and integral of r, g, b values over that area,
-			// initialized to zero, to be summed up in next loops.
-			double area = 0, ra = 0, ga = 0, ba = 0, aa = 0;
-			irr::video::SColor pxl;
-			const auto csy = std::floor(minsy);
-			const auto csx = std::floor(minsx);
-			// Loop over the integral pixel positions described by those bounds.
-			for(double sy = csy; sy < maxsy; sy++)
-				for(double sx = csx; sx < maxsx; sx++) {
-					// Calculate width, height, then area of dest pixel
-					// that's covered by this source pixel.
-					double pw = 1;
-					if(minsx > sx)
-						pw += sx - minsx;
-					if(maxsx < (sx + 1))
-						pw += maxsx - sx - 1;
-					double ph = 1;
-					if(minsy > sy)
-						ph += sy - minsy;
-					if(maxsy < (sy + 1))
-						ph += maxsy - sy - 1;
-					const double pa = pw * ph;
-
-					// Get source pixel and add it to totals, weighted
-					// by covered area and alpha.
-					pxl = src->getPixel(sx, sy);
-					area += pa;
-					ra += pa * pxl.getRed();
-					ga += pa * pxl.getGreen();
-					ba += pa * pxl.getBlue();
-					aa += pa * pxl.getAlpha();
-				}
-
-			// Set the destination image pixel to the average color.
-			if(area > 0) {
-				pxl.setRed(ra / area + 0.5);
-				pxl.setGreen(ga / area + 0.5);
-				pxl.setBlue(ba / area + 0.5);
-				pxl.setAlpha(aa / area + 0.5);
-			} else {
-				pxl.setRed(0);
-				pxl.setGreen(0);
-				pxl.setBlue(0);
-				pxl.setAlpha(0);
-			}
-			dest->setPixel(dx, dy, pxl);
-		}
-	}
-	return dy == dim.Height;
+	std::lock_guard<epro::mutex> lck3(decoded_cache_lock);
+	decoded_cache.clear();
 }
 irr::video::IImage* ImageManager::GetScaledImage(irr::video::IImage* srcimg, int width, int height, chrono_time call_timestamp_id, const std::atomic<chrono_time>& source_timestamp_id) {
 	if(width <= 0 || height <= 0)
@@ -558,7 +666,9 @@ irr::video::IImage* ImageManager::GetScaledImage(irr::video::IImage* srcimg, int
 		return srcimg;
 	} else {
 		irr::video::IImage* destimg = driver->createImage(srcimg->getColorFormat(), dim);
-		if(call_timestamp_id != source_timestamp_id || !imageScaleNNAA(srcimg, destimg, call_timestamp_id, source_timestamp_id)) {
+		const auto& srcdim = srcimg->getDimension();
+		auto cancelled = [&] { return call_timestamp_id != source_timestamp_id; };
+		if(cancelled() || !ResampleImage(srcimg, { 0, 0, (irr::s32)srcdim.Width, (irr::s32)srcdim.Height }, destimg, cancelled)) {
 			destimg->drop();
 			destimg = nullptr;
 		}
@@ -575,87 +685,170 @@ irr::video::ITexture* ImageManager::GetTextureFromFile(const irr::io::path& file
 	}
 	return driver->getTexture(file);
 }
-ImageManager::load_return ImageManager::LoadCardTexture(uint32_t code, imgType type, const std::atomic<irr::s32>& _width, const std::atomic<irr::s32>& _height, chrono_time call_timestamp_id, const std::atomic<chrono_time>& source_timestamp_id) {
-	int width = _width;
-	int height = _height;
-	if(type == imgType::THUMB)
-		type = imgType::ART;
-	load_return ret{ loadStatus::LOAD_FAIL, code };
-	auto LoadImg = [&](irr::video::IImage* base_img)->irr::video::IImage* {
-		if(!base_img)
-			return nullptr;
-		if(width != _width || height != _height) {
-			width = _width;
-			height = _height;
-		}
-		while(const auto img = GetScaledImage(base_img, width, height, call_timestamp_id, source_timestamp_id)) {
-			if(call_timestamp_id != source_timestamp_id.load()) {
-				img->drop();
-				base_img->drop();
-				return nullptr;
-			}
-			if(width != _width || height != _height) {
-				img->drop();
-				width = _width;
-				height = _height;
+ImageManager::load_return ImageManager::LoadCardTexture(uint32_t code, imgType type, const std::atomic<irr::s32>& width, const std::atomic<irr::s32>& height, chrono_time call_timestamp_id, const std::atomic<chrono_time>& source_timestamp_id) {
+	const std::vector<load_parameter> params{ load_parameter(code, type, 0, width, height, call_timestamp_id, source_timestamp_id) };
+	std::vector<load_return> results;
+	LoadCardTextures(params, results);
+	return std::move(results.front());
+}
+//Loads every size in params of the same picture, from the scaled copies on disk if they're
+//there, otherwise decoding the original once
+void ImageManager::LoadCardTextures(const std::vector<load_parameter>& params, std::vector<load_return>& results) {
+	const auto& first = params.front();
+	const auto code = first.code;
+	const auto type = (first.type == imgType::THUMB) ? imgType::ART : first.type;
+	const bool cover = type == imgType::COVER;
+	results.assign(params.size(), load_return{ loadStatus::LOAD_FAIL, code });
+	auto ScaleAll = [&](const card_source& source) {
+		for(size_t i = 0; i < params.size(); ++i) {
+			if(results[i].status == loadStatus::LOAD_OK)
 				continue;
-			}
-			base_img->drop();
-			return img;
+			const auto& param = params[i];
+			results[i] = ScaleCardSource(source, code, param.reference_width, param.reference_height, param.timestamp, param.reference_timestamp);
+			if(!scaled_cache || !source.cacheable || results[i].status != loadStatus::LOAD_OK)
+				continue;
+			//the card info and full size art are usually the same size
+			const auto& dim = results[i].texture->getDimension();
+			const auto same_size = [&](const load_return& other) { return other.texture && other.texture->getDimension() == dim; };
+			if(std::none_of(results.begin(), results.begin() + i, same_size))
+				scaled_cache->Store(code, cover, source.file, results[i].texture);
 		}
-		base_img->drop();
-		return nullptr;
 	};
-
-	irr::video::IImage* img;
-
+	const auto decoded = FindDecodedSource(code, type);
+	if(decoded.image) {
+		ScaleAll(decoded);
+		return;
+	}
+	const auto status = ForEachCardFile(code, type, first.timestamp, first.reference_timestamp, [&](const card_file& file) {
+		if(scaled_cache && file.cacheable) {
+			bool missing = false;
+			for(size_t i = 0; i < params.size(); ++i) {
+				const int width = params[i].reference_width;
+				const int height = params[i].reference_height;
+				irr::video::IImage* img = nullptr;
+				if(width > 0 && height > 0)
+					img = scaled_cache->Load(code, cover, file.source, irr::core::dimension2du(width, height));
+				if(!img) {
+					missing = true;
+					continue;
+				}
+				results[i].status = loadStatus::LOAD_OK;
+				results[i].texture = img;
+				results[i].path = file.source.path;
+			}
+			if(!missing)
+				return true;
+		}
+		const auto& path = file.source.path;
+		auto* img = file.archive_file ? driver->createImageFromFile(file.archive_file) : driver->createImageFromFile({ path.data(), static_cast<irr::u32>(path.size()) });
+		if(!img)
+			return false;
+		//the image is shared between the loader threads, and IImage's reference count isn't atomic
+		const card_source source{ std::shared_ptr<irr::video::IImage>(img, [](irr::video::IImage* img) { img->drop(); }), file.source, file.cacheable };
+		AddDecodedSource(code, type, source);
+		ScaleAll(source);
+		return true;
+	});
+	if(status == loadStatus::WAIT_DOWNLOAD) {
+		for(auto& result : results)
+			result.status = status;
+	}
+}
+//Calls load with every file the picture could be in, in order, until it returns true
+ImageManager::loadStatus ImageManager::ForEachCardFile(uint32_t code, imgType type, chrono_time call_timestamp_id, const std::atomic<chrono_time>& source_timestamp_id, const std::function<bool(const card_file&)>& load) {
 	auto status = gImageDownloader->GetDownloadStatus(code, type);
 	if(status == ImageDownloader::downloadStatus::DOWNLOADED) {
 		if(call_timestamp_id != source_timestamp_id.load())
-			return ret;
-		const auto file = gImageDownloader->GetDownloadPath(code, type);
-		if((img = LoadImg(driver->createImageFromFile({ file.data(), static_cast<irr::u32>(file.size()) }))) != nullptr) {
-			ret.status = loadStatus::LOAD_OK;
-			ret.path = epro::path_string{ file };
-			ret.texture = img;
+			return loadStatus::LOAD_FAIL;
+		card_file file{};
+		file.source.path = epro::path_string{ gImageDownloader->GetDownloadPath(code, type) };
+		file.cacheable = Utils::GetFileStat(file.source.path, file.source.size, file.source.mtime);
+		return load(file) ? loadStatus::LOAD_OK : loadStatus::LOAD_FAIL;
+	}
+	if(status != ImageDownloader::downloadStatus::NONE)
+		return loadStatus::LOAD_FAIL;
+	for(auto& path : (type == imgType::ART) ? mainGame->pic_dirs : mainGame->cover_dirs) {
+		for(auto extension : { EPRO_TEXT(".png"), EPRO_TEXT(".jpg") }) {
+			if(call_timestamp_id != source_timestamp_id.load())
+				return loadStatus::LOAD_FAIL;
+			card_file file{};
+			if(path == EPRO_TEXT("archives")) {
+				file.archive_file = Utils::FindFileInArchives(
+					(type == imgType::ART) ? EPRO_TEXT("pics/") : EPRO_TEXT("pics/cover/"),
+					epro::format(EPRO_TEXT("{}{}"), code, extension));
+				if(!file.archive_file)
+					continue;
+				const auto& name = file.archive_file->getFileName();
+				file.source.path = { name.c_str(), name.size() };
+				//archives don't keep when a file was written, the size has to do
+				file.source.size = file.archive_file->getSize();
+				file.cacheable = true;
+				const bool loaded = load(file);
+				file.archive_file->drop();
+				if(loaded)
+					return loadStatus::LOAD_OK;
+				continue;
+			}
+			file.source.path = epro::format(EPRO_TEXT("{}{}{}"), path, code, extension);
+			if(!Utils::GetFileStat(file.source.path, file.source.size, file.source.mtime))
+				continue;
+			file.cacheable = true;
+			if(load(file))
+				return loadStatus::LOAD_OK;
 		}
+	}
+	gImageDownloader->AddToDownloadQueue(code, type);
+	return loadStatus::WAIT_DOWNLOAD;
+}
+ImageManager::card_source ImageManager::FindDecodedSource(uint32_t code, imgType type) {
+	std::lock_guard<epro::mutex> lck(decoded_cache_lock);
+	const auto now = std::chrono::steady_clock::now();
+	while(!decoded_cache.empty() && decoded_cache.front().expiry <= now)
+		decoded_cache.pop_front();
+	for(const auto& entry : decoded_cache) {
+		if(entry.code == code && entry.type == type)
+			return entry.source;
+	}
+	return {};
+}
+void ImageManager::AddDecodedSource(uint32_t code, imgType type, const card_source& source) {
+	std::lock_guard<epro::mutex> lck(decoded_cache_lock);
+	if(decoded_cache.size() >= DECODED_IMAGE_CACHE_SIZE)
+		decoded_cache.pop_front();
+	decoded_cache.push_back({ code, type, std::chrono::steady_clock::now() + DECODED_IMAGE_TTL, source });
+}
+ImageManager::load_return ImageManager::ScaleCardSource(const card_source& source, uint32_t code, const std::atomic<irr::s32>& _width, const std::atomic<irr::s32>& _height, chrono_time call_timestamp_id, const std::atomic<chrono_time>& source_timestamp_id) {
+	load_return ret{ loadStatus::LOAD_FAIL, code };
+	if(!source.image)
 		return ret;
-	} else if(status == ImageDownloader::downloadStatus::NONE) {
-		for(auto& path : (type == imgType::ART) ? mainGame->pic_dirs : mainGame->cover_dirs) {
-			for(auto extension : { EPRO_TEXT(".png"), EPRO_TEXT(".jpg") }) {
-				if(call_timestamp_id != source_timestamp_id.load())
-					return ret;
-				irr::video::IImage* base_img = nullptr;
-				epro::path_string file;
-				if(path == EPRO_TEXT("archives")) {
-					auto archiveFile = Utils::FindFileInArchives(
-						(type == imgType::ART) ? EPRO_TEXT("pics/") : EPRO_TEXT("pics/cover/"),
-						epro::format(EPRO_TEXT("{}{}"), code, extension));
-					if(!archiveFile)
-						continue;
-					const auto& name = archiveFile->getFileName();
-					file = { name.c_str(), name.size() };
-					base_img = driver->createImageFromFile(archiveFile);
-					archiveFile->drop();
-				} else {
-					file = epro::format(EPRO_TEXT("{}{}{}"), path, code, extension);
-					base_img = driver->createImageFromFile({ file.data(), static_cast<irr::u32>(file.size()) });
-				}
-				if((img = LoadImg(base_img)) != nullptr) {
-					ret.status = loadStatus::LOAD_OK;
-					ret.path = file;
-					ret.texture = img;
-					return ret;
-				}
-			}
+	auto* base_img = source.image.get();
+	while(true) {
+		const int width = _width;
+		const int height = _height;
+		irr::video::IImage* img;
+		const irr::core::dimension2d<irr::u32> dim(width, height);
+		if(width > 0 && height > 0 && base_img->getDimension() == dim) {
+			//GetScaledImage would hand out the shared source itself
+			img = driver->createImage(base_img->getColorFormat(), dim);
+			base_img->copyTo(img);
+		} else if((img = GetScaledImage(base_img, width, height, call_timestamp_id, source_timestamp_id)) == nullptr)
+			return ret;
+		if(call_timestamp_id != source_timestamp_id.load()) {
+			img->drop();
+			return ret;
+		}
+		//the window was resized while scaling
+		if(width != _width || height != _height) {
+			img->drop();
+			continue;
 		}
-		gImageDownloader->AddToDownloadQueue(code, type);
-		ret.status = loadStatus::WAIT_DOWNLOAD;
+		ret.status = loadStatus::LOAD_OK;
+		ret.path = source.file.path;
+		ret.texture = img;
 		return ret;
 	}
-	return ret;
 }
-irr::video::ITexture* ImageManager::GetTextureCard(uint32_t code, imgType type, bool wait, bool fit, int* chk) {
+irr::video::ITexture* ImageManager::GetTextureCard(uint32_t code, imgType type, bool wait, bool fit, int* chk, loadPriority priority) {
 	if(chk)
 		*chk = 1;
 	irr::video::ITexture* ret_unk = tUnknown;
@@ -686,6 +879,7 @@ irr::video::ITexture* ImageManager::GetTextureCard(uint32_t code, imgType type,
 	if(code == 0)
 		return ret_unk;
 	auto& elem = map[code];
+	elem.last_request = frame_id;
 	if(elem.preload_status != preloadStatus::LOADED) {
 		auto status = gImageDownloader->GetDownloadStatus(code, type);
 		if(status == ImageDownloader::downloadStatus::DOWNLOADING) {
@@ -704,14 +898,23 @@ irr::video::ITexture* ImageManager::GetTextureCard(uint32_t code, imgType type,
 		}
 		if(chk)
 			*chk = 2;
+		if(elem.preload_status == preloadStatus::LOADING && priority < elem.priority) {
+			//queued as a prefetch, but it's needed now
+			elem.priority = priority;
+			std::lock_guard<epro::mutex> lck(pic_load);
+			BumpLoad({ code, static_cast<size_t>(index) }, priority);
+		}
 		if(elem.preload_status == preloadStatus::NONE || (elem.preload_status == preloadStatus::WAIT_DOWNLOAD && status == ImageDownloader::downloadStatus::DOWNLOADED)) {
 			elem.preload_status = preloadStatus::LOADING;
 			if(wait) {
 				auto load_result = LoadCardTexture(code, type, sizes[size_index].first, sizes[size_index].second, timestamp_id, timestamp_id);
 				auto& rmap = map[code].texture;
+				elem.preload_status = preloadStatus::LOADED;
 				if(load_result.status == loadStatus::LOAD_OK) {
 					rmap = driver->addTexture(load_result.path.data(), load_result.texture);
 					load_result.texture->drop();
+					if(rmap)
+						texture_bytes[index] += textureBytes(rmap);
 					if(chk)
 						*chk = 1;
 				} else {
@@ -721,9 +924,9 @@ irr::video::ITexture* ImageManager::GetTextureCard(uint32_t code, imgType type,
 				}
 				return (rmap) ? rmap : ret_unk;
 			} else {
+				elem.priority = priority;
 				std::lock_guard<epro::mutex> lck(pic_load);
-				to_load.emplace_front(code, type, index, std::ref(sizes[size_index].first), std::ref(sizes[size_index].second), timestamp_id.load(), std::ref(timestamp_id));
-				cv_load.notify_one();
+				QueueLoad(code, type, index, sizes[size_index], priority);
 			}
 		}
 		return ret_unk;
@@ -846,91 +1049,6 @@ static void imageCleanTransparent(irr::video::IImage* src, irr::u32 threshold) {
 		}
 }
 
-/* Scale a region of an image into another image, using nearest-neighbor with
- * anti-aliasing; treat pixels as crisp rectangles, but blend them at boundaries
- * to prevent non-integer scaling ratio artifacts.  Note that this may cause
- * some blending at the edges where pixels don't line up perfectly, but this
- * filter is designed to produce the most accurate results for both upscaling
- * and downscaling.
- */
-static void imageScaleNNAAUnthreaded(irr::video::IImage* src, const irr::core::rect<irr::s32>& srcrect, irr::video::IImage* dest) {
-	// Cache rectangle boundaries.
-	const double sox = srcrect.UpperLeftCorner.X;
-	const double soy = srcrect.UpperLeftCorner.Y;
-	const double sw = srcrect.getWidth();
-	const double sh = srcrect.getHeight();
-
-	// Walk each destination image pixel.
-	// Note: loop y around x for better cache locality.
-	const auto& dim = dest->getDimension();
-	const auto divw = sw / dim.Width;
-	const auto divh = sh / dim.Height;
-	for(irr::u32 dy = 0; dy < dim.Height; dy++)
-		for(irr::u32 dx = 0; dx < dim.Width; dx++) {
-
-			// Calculate floating-point source rectangle bounds.
-			// Do some basic clipping, and for mirrored/flipped rects,
-			// make sure min/max are in the right order.
-			auto minsx = std::min(std::max(sox + (dx * divw), 0.0), sw + sox);
-			auto maxsx = std::min(std::max(minsx + divw, 0.0), sw + sox);
-			if(minsx > maxsx)
-				std::swap(minsx, maxsx);
-			auto minsy = std::min(std::max(soy + (dy * divh), 0.0), sh + soy);
-			auto maxsy = std::min(std::max(minsy + divh, 0.0), sh + soy);
-			if(minsy > maxsy)
-				std::swap(minsy, maxsy);
-
-			const auto csy = std::floor(minsy);
-			const auto csx = std::floor(minsx);
-
-			// Total area, and integral of r, g, b values over that area,
-			// initialized to zero, to be summed up in next loops.
-			double area = 0, ra = 0, ga = 0, ba = 0, aa = 0;
-			irr::video::SColor pxl;
-
-			// Loop over the integral pixel positions described by those bounds.
-			for(double sy = csy; sy < maxsy; sy++)
-				for(double sx = csx; sx < maxsx; sx++) {
-					// Calculate width, height, then area of dest pixel
-					// that's covered by this source pixel.
-
-					double pw = 1.0;
-					if(minsx > sx)
-						pw += sx - minsx;
-					if(maxsx < (sx + 1))
-						pw += maxsx - sx - 1;
-					double ph = 1.0;
-					if(minsy > sy)
-						ph += sy - minsy;
-					if(maxsy < (sy + 1))
-						ph += maxsy - sy - 1;
-					const double pa = pw * ph;
-
-					// Get source pixel and add it to totals, weighted
-					// by covered area and alpha.
-					pxl = src->getPixel(sx, sy);
-					area += pa;
-					ra += pa * pxl.getRed();
-					ga += pa * pxl.getGreen();
-					ba += pa * pxl.getBlue();
-					aa += pa * pxl.getAlpha();
-				}
-
-			// Set the destination image pixel to the average color.
-			if(area > 0) {
-				pxl.setRed(ra / area + 0.5);
-				pxl.setGreen(ga / area + 0.5);
-				pxl.setBlue(ba / area + 0.5);
-				pxl.setAlpha(aa / area + 0.5);
-			} else {
-				pxl.setRed(0);
-				pxl.setGreen(0);
-				pxl.setBlue(0);
-				pxl.setAlpha(0);
-			}
-			dest->setPixel(dx, dy, pxl);
-		}
-}
 /* Get a cached, high-quality pre-scaled texture for display purposes.  If the
  * texture is not already cached, attempt to create it.  Returns a pre-scaled texture,
  * or the original texture if unable to pre-scale it.
@@ -971,7 +1089,7 @@ irr::video::ITexture* ImageManager::guiScalingResizeCached(irr::video::ITexture*
 	irr::video::IImage* destimg = driver->createImage(src->getColorFormat(),
 													  irr::core::dimension2d<irr::u32>((irr::u32)destrect.getWidth(),
 													 (irr::u32)destrect.getHeight()));
-	imageScaleNNAAUnthreaded(srcimg, srcrect, destimg);
+	ResampleImage(srcimg, srcrect, destimg);
 
 	// Some platforms are picky about textures being powers of 2, so expand
 	// the image dimensions to the next power of 2, if necessary.
@@ -1021,7 +1139,7 @@ irr::video::IImage* ImageManager::GetScaledImageFromFile(const irr::io::path& fi
 		return srcimg;
 	} else {
 		auto* destimg = driver->createImage(srcimg->getColorFormat(), dim);
-		imageScaleNNAAUnthreaded(srcimg, { 0, 0, (irr::s32)srcdim.Width, (irr::s32)srcdim.Height }, destimg);
+		ResampleImage(srcimg, { 0, 0, (irr::s32)srcdim.Width, (irr::s32)srcdim.Height }, destimg);
 		srcimg->drop();
 		return destimg;
 	}
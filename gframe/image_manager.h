@@ -7,10 +7,17 @@
 #include <unordered_map>
 #include <map>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <queue>
+#include <set>
+#include <string>
+#include <tuple>
 #include "epro_mutex.h"
 #include "epro_condition_variable.h"
 #include "epro_thread.h"
+#include "scaled_image_cache.h"
 
 namespace irr {
 class IrrlichtDevice;
@@ -37,6 +44,14 @@ enum imgType {
 };
 #endif
 
+//Order in which the queued card pictures are loaded, most urgent first
+enum class loadPriority : uint8_t {
+	VISIBLE,
+	HOVERED,
+	IN_DECK,
+	SPECULATIVE,
+};
+
 class ImageManager {
 private:
 	using chrono_time = uint64_t;
@@ -49,6 +64,8 @@ private:
 	struct texture_map_entry {
 		preloadStatus preload_status;
 		irr::video::ITexture* texture;
+		loadPriority priority;
+		uint32_t last_request; //frame_id of the last GetTextureCard call
 	};
 	using texture_map = std::unordered_map<uint32_t, texture_map_entry>;
 	struct load_parameter {
@@ -66,6 +83,14 @@ private:
 			reference_timestamp(reference_timestamp_) {
 		}
 	};
+	using size_pair = std::pair<std::atomic<irr::s32>, std::atomic<irr::s32>>;
+	using load_key = std::pair<uint32_t, size_t>; //code, index in loaded_pics
+	struct queued_load {
+		load_parameter param;
+		loadPriority priority;
+		uint64_t order;
+	};
+	using load_queue = std::map<load_key, queued_load>;
 	enum class loadStatus {
 		LOAD_OK,
 		LOAD_FAIL,
@@ -77,6 +102,24 @@ private:
 		irr::video::IImage* texture;
 		epro::path_string path;
 	};
+	//A card picture decoded at its original size, shared by every size it's scaled to
+	struct card_source {
+		std::shared_ptr<irr::video::IImage> image;
+		ScaledImageCache::source_file file;
+		bool cacheable; //file's size and last write time are known
+	};
+	//A file a card picture can be in, archive_file is set if it's inside an archive
+	struct card_file {
+		ScaledImageCache::source_file source;
+		irr::io::IReadFile* archive_file;
+		bool cacheable;
+	};
+	struct decoded_entry {
+		uint32_t code;
+		imgType type;
+		std::chrono::steady_clock::time_point expiry;
+		card_source source;
+	};
 public:
 	ImageManager();
 	~ImageManager();
@@ -87,12 +130,14 @@ public:
 	void ClearTexture(bool resize = false);
 	void RefreshCachedTextures();
 	void ClearCachedTextures();
-	static bool imageScaleNNAA(irr::video::IImage* src, irr::video::IImage* dest, chrono_time timestamp_id, const std::atomic<chrono_time>& source_timestamp_id);
 	irr::video::IImage* GetScaledImage(irr::video::IImage* srcimg, int width, int height, chrono_time timestamp_id, const std::atomic<chrono_time>& source_timestamp_id);
 	irr::video::IImage* GetScaledImageFromFile(const irr::io::path& file, int width, int height);
 	irr::video::ITexture* GetTextureFromFile(const irr::io::path& file, int width, int height);
-	irr::video::ITexture* GetTextureCard(uint32_t code, imgType type, bool wait = false, bool fit = false, int* chk = nullptr);
+	irr::video::ITexture* GetTextureCard(uint32_t code, imgType type, bool wait = false, bool fit = false, int* chk = nullptr, loadPriority priority = loadPriority::VISIBLE);
 	irr::video::ITexture* GetTextureField(uint32_t code);
+	//card pictures are kept up to this many bytes, the least recently drawn are removed first
+	void SetCardTextureBudget(size_t budget_bytes);
+	std::wstring FormatTextureStats() const;
 	irr::video::ITexture* GetCheckboxScaledTexture(float scale);
 	irr::video::ITexture* guiScalingResizeCached(irr::video::ITexture* src, const irr::core::rect<irr::s32>& srcrect,
 												 const irr::core::rect<irr::s32> &destrect);
@@ -142,13 +187,23 @@ private:
 	void ClearFutureObjects();
 	void RefreshCovers();
 	void LoadPic();
+	void QueueLoad(uint32_t code, imgType type, size_t index, const size_pair& size, loadPriority priority);
+	bool BumpLoad(const load_key& key, loadPriority priority);
+	load_queue::iterator DequeueLoad(load_queue::iterator it);
+	void CancelStaleLoads();
+	void EvictCardTextures();
 	irr::video::ITexture* loadTextureFixedSize(epro::path_stringview texture_name, int width, int height);
 	irr::video::ITexture* loadTextureAnySize(epro::path_stringview texture_name);
 	void replaceTextureLoadingFixedSize(irr::video::ITexture*& texture, irr::video::ITexture* fallback, epro::path_stringview texture_name, int width, int height);
 	void replaceTextureLoadingAnySize(irr::video::ITexture*& texture, irr::video::ITexture* fallback, epro::path_stringview texture_name);
 	load_return LoadCardTexture(uint32_t code, imgType type, const std::atomic<irr::s32>& width, const std::atomic<irr::s32>& height, chrono_time timestamp_id, const std::atomic<chrono_time>& source_timestamp_id);
+	void LoadCardTextures(const std::vector<load_parameter>& params, std::vector<load_return>& results);
+	loadStatus ForEachCardFile(uint32_t code, imgType type, chrono_time timestamp_id, const std::atomic<chrono_time>& source_timestamp_id, const std::function<bool(const card_file&)>& load);
+	card_source FindDecodedSource(uint32_t code, imgType type);
+	void AddDecodedSource(uint32_t code, imgType type, const card_source& source);
+	load_return ScaleCardSource(const card_source& source, uint32_t code, const std::atomic<irr::s32>& width, const std::atomic<irr::s32>& height, chrono_time timestamp_id, const std::atomic<chrono_time>& source_timestamp_id);
 	epro::path_string textures_path;
-	std::pair<std::atomic<irr::s32>, std::atomic<irr::s32>> sizes[3];
+	size_pair sizes[3];
 	std::atomic<chrono_time> timestamp_id;
 	std::map<epro::path_string, irr::video::ITexture*> g_txrCache;
 	std::map<irr::io::path, irr::video::IImage*> g_imgCache; //ITexture->getName returns a io::path
@@ -158,9 +213,22 @@ private:
 	std::deque<load_return> to_clear;
 	std::atomic<bool> stop_threads;
 	epro::condition_variable cv_load;
-	std::deque<load_parameter> to_load;
+	//one entry per (code, size), load_order sorts them by priority, newest first
+	load_queue to_load;
+	std::set<std::tuple<loadPriority, uint64_t, load_key>> load_order;
+	uint64_t load_counter;
+	uint32_t frame_id;
+	//bytes of the textures in tMap[0], tMap[1], tThumb and tCovers, main thread only
+	size_t texture_bytes[4];
+	size_t texture_budget;
+	uint64_t texture_evictions;
 	std::deque<load_return> loaded_pics[4];
 	epro::mutex pic_load;
+	//card pictures decoded in the last few seconds, so that the other sizes of a card don't decode it again
+	std::deque<decoded_entry> decoded_cache;
+	epro::mutex decoded_cache_lock;
+	//nullptr if scaledPicsCache is off
+	std::unique_ptr<ScaledImageCache> scaled_cache;
 	//bool stop_threads;
 	std::vector<epro::thread> load_threads;
 };
@@ -0,0 +1,372 @@
+#include "image_scaler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <IImage.h>
+#include "image_data.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCALER_AVX2 1
+#define SCALER_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCALER_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SCALER_NEON 1
+#endif
+
+namespace ygo {
+
+namespace {
+
+//The weights of a destination pixel add up to 1 << WEIGHT_BITS. The vertical
+//pass keeps LINE_BITS of fraction, so the horizontal one works on 16 bits.
+constexpr int WEIGHT_BITS = 14;
+constexpr int LINE_BITS = 7;
+constexpr int LINE_SHIFT = WEIGHT_BITS - LINE_BITS;
+constexpr int OUT_SHIFT = WEIGHT_BITS + LINE_BITS;
+
+//Source pixels feeding one destination pixel along an axis
+struct Taps {
+	int first;
+	int count;
+	size_t weights; //Index of the weight of first
+};
+
+//Area each of the dst pixels covers over the src pixels starting at offset.
+//A source pixel only partially covered counts for the covered part.
+void MakeTaps(int offset, int src, int dst, std::vector<Taps>& taps, std::vector<int16_t>& weights) {
+	constexpr int one = 1 << WEIGHT_BITS;
+	const double scale = static_cast<double>(src) / dst;
+	taps.reserve(dst);
+	for(int i = 0; i < dst; ++i) {
+		const double start = i * scale;
+		const double end = std::min(start + scale, static_cast<double>(src));
+		Taps tap{ static_cast<int>(start), 0, weights.size() };
+		const int last = std::max(std::min(static_cast<int>(std::ceil(end)), src), tap.first + 1);
+		int sum = 0;
+		size_t largest = weights.size();
+		for(int j = tap.first; j < last; ++j) {
+			const double cover = std::min(end, j + 1.0) - std::max(start, static_cast<double>(j));
+			const auto weight = static_cast<int16_t>(std::lround(cover / (end - start) * one));
+			weights.push_back(weight);
+			sum += weight;
+			if(weight > weights[largest])
+				largest = weights.size() - 1;
+		}
+		//Rounding leftovers go to the pixel that matters most
+		weights[largest] = static_cast<int16_t>(weights[largest] + one - sum);
+		tap.count = last - tap.first;
+		tap.first += offset;
+		taps.push_back(tap);
+	}
+}
+
+//acc[i] += row[i] * weight
+void AccumulateRow(int32_t* acc, const uint8_t* row, size_t count, int16_t weight) {
+	size_t i = 0;
+#if SCALER_AVX2
+	const auto w = _mm256_set1_epi32(weight);
+	for(; i + 8 <= count; i += 8) {
+		const auto pixels = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i)));
+		auto* out = reinterpret_cast<__m256i*>(acc + i);
+		_mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out), _mm256_mullo_epi32(pixels, w)));
+	}
+#elif SCALER_SSE2
+	//Every 32 bit lane holds a pixel and a 0, madd with (weight, 0) pairs
+	//gives the 32 bit products
+	const auto zero = _mm_setzero_si128();
+	const auto w = _mm_set1_epi32(weight);
+	for(; i + 16 <= count; i += 16) {
+		const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+		const auto lo = _mm_unpacklo_epi8(bytes, zero);
+		const auto hi = _mm_unpackhi_epi8(bytes, zero);
+		const __m128i parts[4]{ _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+								_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+		for(int k = 0; k < 4; ++k) {
+			auto* out = reinterpret_cast<__m128i*>(acc + i + k * 4);
+			_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_madd_epi16(parts[k], w)));
+		}
+	}
+#elif SCALER_NEON
+	const auto w = static_cast<uint16_t>(weight);
+	for(; i + 16 <= count; i += 16) {
+		const auto bytes = vld1q_u8(row + i);
+		const auto lo = vmovl_u8(vget_low_u8(bytes));
+		const auto hi = vmovl_u8(vget_high_u8(bytes));
+		const uint16x4_t parts[4]{ vget_low_u16(lo), vget_high_u16(lo), vget_low_u16(hi), vget_high_u16(hi) };
+		for(int k = 0; k < 4; ++k) {
+			auto* out = reinterpret_cast<uint32_t*>(acc + i + k * 4);
+			vst1q_u32(out, vmlal_n_u16(vld1q_u32(out), parts[k], w));
+		}
+	}
+#endif
+	for(; i < count; ++i)
+		acc[i] += row[i] * weight;
+}
+
+//Filters a row of 4 byte pixels horizontally
+void FilterRow4(uint8_t* out, const int16_t* line, const Taps* taps, const int16_t* weights, size_t count) {
+	for(size_t x = 0; x < count; ++x, out += 4) {
+		const auto& tap = taps[x];
+		const int16_t* in = line + tap.first * 4;
+		const int16_t* w = weights + tap.weights;
+		int k = 0;
+#if SCALER_SSE2
+		//Channels of two pixels interleaved, madd weighs and sums them at once
+		auto sum = _mm_set1_epi32(1 << (OUT_SHIFT - 1));
+		for(; k + 2 <= tap.count; k += 2) {
+			const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + k * 4));
+			const auto mixed = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+			const auto pair = _mm_set1_epi32(static_cast<uint16_t>(w[k]) | (static_cast<int32_t>(w[k + 1]) << 16));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(mixed, pair));
+		}
+		if(k < tap.count) {
+			const auto pixel = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + k * 4)),
+												  _mm_setzero_si128());
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(pixel, _mm_set1_epi32(w[k])));
+		}
+		sum = _mm_srai_epi32(sum, OUT_SHIFT);
+		const auto words = _mm_packs_epi32(sum, sum);
+		const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+		std::memcpy(out, &bytes, 4);
+#elif SCALER_NEON
+		auto sum = vdupq_n_u32(1u << (OUT_SHIFT - 1));
+		for(; k < tap.count; ++k)
+			sum = vmlal_n_u16(sum, vld1_u16(reinterpret_cast<const uint16_t*>(in + k * 4)), static_cast<uint16_t>(w[k]));
+		const auto words = vqmovn_u32(vshrq_n_u32(sum, OUT_SHIFT));
+		const auto bytes = vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(words, words)));
+		vst1_lane_u32(reinterpret_cast<uint32_t*>(out), bytes, 0);
+#else
+		int32_t sum[4]{};
+		for(; k < tap.count; ++k)
+			for(int c = 0; c < 4; ++c)
+				sum[c] += in[k * 4 + c] * w[k];
+		for(int c = 0; c < 4; ++c)
+			out[c] = static_cast<uint8_t>(std::min((sum[c] + (1 << (OUT_SHIFT - 1))) >> OUT_SHIFT, 255));
+#endif
+	}
+}
+
+//Any number of channels, for R8G8B8
+void FilterRow(uint8_t* out, const int16_t* line, const Taps* taps, const int16_t* weights, size_t count, int channels) {
+	for(size_t x = 0; x < count; ++x, out += channels) {
+		const auto& tap = taps[x];
+		const int16_t* in = line + tap.first * channels;
+		const int16_t* w = weights + tap.weights;
+		for(int c = 0; c < channels; ++c) {
+			int32_t sum = 1 << (OUT_SHIFT - 1);
+			for(int k = 0; k < tap.count; ++k)
+				sum += in[k * channels + c] * w[k];
+			out[c] = static_cast<uint8_t>(std::min(sum >> OUT_SHIFT, 255));
+		}
+	}
+}
+
+//Color channels of A8R8G8B8 pixels scaled by their alpha, so transparent
+//pixels don't bleed their color into the average
+void Premultiply(uint8_t* out, const uint8_t* in, size_t count) {
+	for(size_t x = 0; x < count; ++x, in += 4, out += 4) {
+		const uint32_t a = in[3];
+		for(int c = 0; c < 3; ++c)
+			out[c] = static_cast<uint8_t>((in[c] * a + 127) / 255);
+		out[3] = static_cast<uint8_t>(a);
+	}
+}
+
+void Unpremultiply(uint8_t* pixels, size_t count) {
+	for(size_t x = 0; x < count; ++x, pixels += 4) {
+		const uint32_t a = pixels[3];
+		if(a == 255)
+			continue;
+		for(int c = 0; c < 3; ++c)
+			pixels[c] = a == 0 ? 0 : static_cast<uint8_t>(std::min<uint32_t>((pixels[c] * 255 + a / 2) / a, 255));
+	}
+}
+
+bool Resample(irr::video::IImage* src, const irr::core::rect<irr::s32>& srcrect, irr::video::IImage* dest,
+			  const std::function<bool()>& cancelled, bool premultiplied) {
+	const auto format = src->getColorFormat();
+	int channels;
+	switch(format) {
+	case irr::video::ECF_A8R8G8B8: channels = 4; break;
+	case irr::video::ECF_R8G8B8: channels = 3; premultiplied = false; break;
+	default: return ResampleImagePerPixel(src, srcrect, dest, cancelled);
+	}
+	if(dest->getColorFormat() != format)
+		return ResampleImagePerPixel(src, srcrect, dest, cancelled);
+
+	const auto& sdim = src->getDimension();
+	auto rect = srcrect;
+	rect.repair();
+	rect.clipAgainst({ 0, 0, static_cast<irr::s32>(sdim.Width), static_cast<irr::s32>(sdim.Height) });
+	const auto& dim = dest->getDimension();
+	if(dim.Width == 0 || dim.Height == 0)
+		return true;
+	if(!rect.isValid() || rect.getArea() == 0) {
+		std::memset(GetData(dest), 0, dest->getPitch() * dim.Height);
+		Unlock(dest);
+		return true;
+	}
+
+	const auto* in = static_cast<const uint8_t*>(GetData(src));
+	size_t in_pitch = src->getPitch();
+	const size_t row_bytes = static_cast<size_t>(rect.getWidth()) * channels;
+	size_t row_start = static_cast<size_t>(rect.UpperLeftCorner.X) * channels;
+	int row_offset = rect.UpperLeftCorner.Y;
+	//Premultiplied copy of just the rectangle
+	std::vector<uint8_t> premultiplied_rect;
+	if(premultiplied) {
+		premultiplied_rect.resize(row_bytes * rect.getHeight());
+		for(irr::s32 y = 0; y < rect.getHeight(); ++y)
+			Premultiply(&premultiplied_rect[y * row_bytes], in + (rect.UpperLeftCorner.Y + y) * in_pitch + row_start, rect.getWidth());
+		Unlock(src);
+		in = premultiplied_rect.data();
+		in_pitch = row_bytes;
+		row_start = 0;
+		row_offset = 0;
+	}
+
+	//Rows are cut to the rectangle, columns are indexes into the cut row
+	std::vector<Taps> columns, rows;
+	std::vector<int16_t> column_weights, row_weights;
+	MakeTaps(0, rect.getWidth(), dim.Width, columns, column_weights);
+	MakeTaps(row_offset, rect.getHeight(), dim.Height, rows, row_weights);
+
+	auto* out = static_cast<uint8_t*>(GetData(dest));
+	const size_t out_pitch = dest->getPitch();
+	std::vector<int32_t> acc(row_bytes);
+	std::vector<int16_t> line(row_bytes);
+	irr::u32 dy = 0;
+	for(; dy < dim.Height; ++dy) {
+		if(cancelled && cancelled())
+			break;
+		const auto& row = rows[dy];
+		std::fill(acc.begin(), acc.end(), 0);
+		for(int k = 0; k < row.count; ++k)
+			AccumulateRow(acc.data(), in + (row.first + k) * in_pitch + row_start, row_bytes, row_weights[row.weights + k]);
+		for(size_t i = 0; i < row_bytes; ++i)
+			line[i] = static_cast<int16_t>((acc[i] + (1 << (LINE_SHIFT - 1))) >> LINE_SHIFT);
+		if(channels == 4)
+			FilterRow4(out + dy * out_pitch, line.data(), columns.data(), column_weights.data(), dim.Width);
+		else
+			FilterRow(out + dy * out_pitch, line.data(), columns.data(), column_weights.data(), dim.Width, channels);
+		if(premultiplied)
+			Unpremultiply(out + dy * out_pitch, dim.Width);
+	}
+	Unlock(dest);
+	if(!premultiplied)
+		Unlock(src);
+	return dy == dim.Height;
+}
+
+}
+
+bool ResampleImage(irr::video::IImage* src, const irr::core::rect<irr::s32>& srcrect, irr::video::IImage* dest,
+				   const std::function<bool()>& cancelled) {
+	return Resample(src, srcrect, dest, cancelled, false);
+}
+
+bool ResampleImagePremultiplied(irr::video::IImage* src, const irr::core::rect<irr::s32>& srcrect, irr::video::IImage* dest,
+								const std::function<bool()>& cancelled) {
+	return Resample(src, srcrect, dest, cancelled, true);
+}
+
+// function by Warr1024, from https://github.com/minetest/minetest/issues/2419 , modified
+/* Scale a region of an image into another image, using nearest-neighbor with
+ * anti-aliasing; treat pixels as crisp rectangles, but blend them at boundaries
+ * to prevent non-integer scaling ratio artifacts.  Note that this may cause
+ * some blending at the edges where pixels don't line up perfectly, but this
+ * filter is designed to produce the most accurate results for both upscaling
+ * and downscaling.
+ */
+bool ResampleImagePerPixel(irr::video::IImage* src, const irr::core::rect<irr::s32>& srcrect, irr::video::IImage* dest,
+						   const std::function<bool()>& cancelled) {
+	// Cache rectangle boundaries.
+	const double sox = srcrect.UpperLeftCorner.X;
+	const double soy = srcrect.UpperLeftCorner.Y;
+	const double sw = srcrect.getWidth();
+	const double sh = srcrect.getHeight();
+
+	// Walk each destination image pixel.
+	// Note: loop y around x for better cache locality.
+	const auto& dim = dest->getDimension();
+	const auto divw = sw / dim.Width;
+	const auto divh = sh / dim.Height;
+	irr::u32 dy = 0;
+	for(; dy < dim.Height; dy++) {
+		if(cancelled && cancelled())
+			break;
+		for(irr::u32 dx = 0; dx < dim.Width; dx++) {
+
+			// Calculate floating-point source rectangle bounds.
+			// Do some basic clipping, and for mirrored/flipped rects,
+			// make sure min/max are in the right order.
+			auto minsx = std::min(std::max(sox + (dx * divw), 0.0), sw + sox);
+			auto maxsx = std::min(std::max(minsx + divw, 0.0), sw + sox);
+			if(minsx > maxsx)
+				std::swap(minsx, maxsx);
+			auto minsy = std::min(std::max(soy + (dy * divh), 0.0), sh + soy);
+			auto maxsy = std::min(std::max(minsy + divh, 0.0), sh + soy);
+			if(minsy > maxsy)
+				std::swap(minsy, maxsy);
+
+			const auto csy = std::floor(minsy);
+			const auto csx = std::floor(minsx);
+
+			// Total area, and integral of r, g, b values over that area,
+			// initialized to zero, to be summed up in next loops.
+			double area = 0, ra = 0, ga = 0, ba = 0, aa = 0;
+			irr::video::SColor pxl;
+
+			// Loop over the integral pixel positions described by those bounds.
+			for(double sy = csy; sy < maxsy; sy++)
+				for(double sx = csx; sx < maxsx; sx++) {
+					// Calculate width, height, then area of dest pixel
+					// that's covered by this source pixel.
+
+					double pw = 1.0;
+					if(minsx > sx)
+						pw += sx - minsx;
+					if(maxsx < (sx + 1))
+						pw += maxsx - sx - 1;
+					double ph = 1.0;
+					if(minsy > sy)
+						ph += sy - minsy;
+					if(maxsy < (sy + 1))
+						ph += maxsy - sy - 1;
+					const double pa = pw * ph;
+
+					// Get source pixel and add it to totals, weighted
+					// by covered area and alpha.
+					pxl = src->getPixel(sx, sy);
+					area += pa;
+					ra += pa * pxl.getRed();
+					ga += pa * pxl.getGreen();
+					ba += pa * pxl.getBlue();
+					aa += pa * pxl.getAlpha();
+				}
+
+			// Set the destination image pixel to the average color.
+			if(area > 0) {
+				pxl.setRed(ra / area + 0.5);
+				pxl.setGreen(ga / area + 0.5);
+				pxl.setBlue(ba / area + 0.5);
+				pxl.setAlpha(aa / area + 0.5);
+			} else {
+				pxl.setRed(0);
+				pxl.setGreen(0);
+				pxl.setBlue(0);
+				pxl.setAlpha(0);
+			}
+			dest->setPixel(dx, dy, pxl);
+		}
+	}
+	return dy == dim.Height;
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef IMAGE_SCALER_H
+#define IMAGE_SCALER_H
+
+#include <functional>
+#include <rect.h>
+
+namespace irr {
+namespace video {
+class IImage;
+}
+}
+
+namespace ygo {
+
+//Scales the srcrect part of src into the whole of dest, every destination
+//pixel being the average of the source area it covers, edges included.
+//src and dest must have the same color format. 8 bit per channel formats are
+//filtered straight on the pixel buffers with precomputed integer weights,
+//with SSE2/AVX2 or NEON where available. cancelled is polled between rows,
+//returns false if it stopped the scaling.
+bool ResampleImage(irr::video::IImage* src, const irr::core::rect<irr::s32>& srcrect, irr::video::IImage* dest,
+				   const std::function<bool()>& cancelled = nullptr);
+
+//Same as ResampleImage, but A8R8G8B8 pixels are weighted by their alpha, so the
+//color of transparent pixels doesn't bleed into the ones next to them.
+bool ResampleImagePremultiplied(irr::video::IImage* src, const irr::core::rect<irr::s32>& srcrect, irr::video::IImage* dest,
+								const std::function<bool()>& cancelled = nullptr);
+
+//Same filter going through IImage::getPixel/setPixel, for any color format.
+//ResampleImage falls back to it for the formats it doesn't handle.
+bool ResampleImagePerPixel(irr::video::IImage* src, const irr::core::rect<irr::s32>& srcrect, irr::video::IImage* dest,
+						   const std::function<bool()>& cancelled = nullptr);
+
+}
+
+#endif //IMAGE_SCALER_H
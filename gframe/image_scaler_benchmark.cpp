@@ -0,0 +1,141 @@
+#include "image_scaler_benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <IImage.h>
+#include <IVideoDriver.h>
+#include <IrrlichtDevice.h>
+#include <irrlicht.h>
+#include "fmt.h"
+#include "image_manager.h"
+#include "image_scaler.h"
+#include "text_types.h"
+#include "utils.h"
+
+using namespace ygo;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Target {
+	const char* name;
+	irr::u32 width;
+	irr::u32 height;
+};
+
+//Sizes LoadCardTexture scales the card pictures to
+constexpr Target targets[]{
+	{ "card info", CARD_IMG_WIDTH, CARD_IMG_HEIGHT },
+	{ "card info x2", CARD_IMG_WIDTH * 2, CARD_IMG_HEIGHT * 2 },
+	{ "thumbnail", CARD_THUMB_WIDTH, CARD_THUMB_HEIGHT },
+};
+
+std::vector<irr::video::IImage*> LoadPictures(irr::video::IVideoDriver* driver) {
+	constexpr size_t MAX_PICTURES = 20;
+	std::vector<irr::video::IImage*> pictures;
+	for(const auto& file : Utils::FindFiles(EPRO_TEXT("./pics/"), { EPRO_TEXT("jpg"), EPRO_TEXT("png") })) {
+		if(pictures.size() == MAX_PICTURES)
+			break;
+		const auto path = epro::format(EPRO_TEXT("./pics/{}"), file);
+		if(auto* image = driver->createImageFromFile({ path.data(), static_cast<irr::u32>(path.size()) }))
+			pictures.push_back(image);
+	}
+	if(!pictures.empty())
+		return pictures;
+	//The sizes of the pictures from the default servers, with enough detail
+	//that every source pixel matters
+	for(const auto& size : { irr::core::dimension2du{ 813, 1185 }, irr::core::dimension2du{ 421, 614 } }) {
+		auto* image = driver->createImage(irr::video::ECF_R8G8B8, size);
+		uint32_t seed = 1;
+		for(irr::u32 y = 0; y < size.Height; ++y) {
+			for(irr::u32 x = 0; x < size.Width; ++x) {
+				seed = seed * 1664525 + 1013904223;
+				image->setPixel(x, y, irr::video::SColor(255, (x * 255) / size.Width, (y * 255) / size.Height, seed >> 24));
+			}
+		}
+		pictures.push_back(image);
+	}
+	return pictures;
+}
+
+int MaxDifference(irr::video::IImage* a, irr::video::IImage* b) {
+	const auto& dim = a->getDimension();
+	int diff = 0;
+	for(irr::u32 y = 0; y < dim.Height; ++y) {
+		for(irr::u32 x = 0; x < dim.Width; ++x) {
+			const auto pa = a->getPixel(x, y);
+			const auto pb = b->getPixel(x, y);
+			diff = std::max({ diff, std::abs(static_cast<int>(pa.getRed()) - static_cast<int>(pb.getRed())),
+							std::abs(static_cast<int>(pa.getGreen()) - static_cast<int>(pb.getGreen())),
+							std::abs(static_cast<int>(pa.getBlue()) - static_cast<int>(pb.getBlue())),
+							std::abs(static_cast<int>(pa.getAlpha()) - static_cast<int>(pb.getAlpha())) });
+		}
+	}
+	return diff;
+}
+
+}
+
+int image_scaler_benchmark_main(const args_t& args) {
+	const auto& workdir = args[LAUNCH_PARAM::WORK_DIR];
+	const epro::path_stringview dest = workdir.enabled ? workdir.argument : Utils::GetExeFolder();
+	if(!Utils::SetWorkingDirectory(dest)) {
+		epro::print("failed to change directory to: {} ({})\n", Utils::ToUTF8IfNeeded(dest), Utils::GetLastErrorString());
+		return EXIT_FAILURE;
+	}
+	int iterations = 5;
+	const auto& count = args[LAUNCH_PARAM::BENCHMARK_IMAGE_SCALER].argument;
+	if(!count.empty()) {
+		try {
+			iterations = std::stoi(epro::path_string{ count });
+		} catch(...) {
+		}
+	}
+	iterations = std::max(iterations, 1);
+
+	irr::SIrrlichtCreationParameters params{};
+	params.DriverType = irr::video::EDT_NULL;
+	irr::IrrlichtDevice* device = irr::createDeviceEx(params);
+	if(!device) {
+		epro::print("Failed to create the Irrlicht device!\n");
+		return EXIT_FAILURE;
+	}
+	auto* driver = device->getVideoDriver();
+	const auto pictures = LoadPictures(driver);
+	epro::print("Scaling {} pictures {} times\n", pictures.size(), iterations);
+	epro::print("{:<14}{:>16}{:>16}{:>10}{:>10}\n", "target", "per-pixel ms", "resample ms", "speedup", "max diff");
+	for(const auto& target : targets) {
+		const irr::core::dimension2du size{ target.width, target.height };
+		Clock::duration reference{}, resampled{};
+		int diff = 0;
+		for(auto* picture : pictures) {
+			const auto& dim = picture->getDimension();
+			const irr::core::recti rect{ 0, 0, static_cast<irr::s32>(dim.Width), static_cast<irr::s32>(dim.Height) };
+			auto* expected = driver->createImage(picture->getColorFormat(), size);
+			auto* actual = driver->createImage(picture->getColorFormat(), size);
+			for(int i = 0; i < iterations; ++i) {
+				auto start = Clock::now();
+				ResampleImagePerPixel(picture, rect, expected);
+				reference += Clock::now() - start;
+				start = Clock::now();
+				ResampleImage(picture, rect, actual);
+				resampled += Clock::now() - start;
+			}
+			diff = std::max(diff, MaxDifference(expected, actual));
+			expected->drop();
+			actual->drop();
+		}
+		const auto runs = static_cast<double>(pictures.size() * iterations);
+		const double reference_ms = std::chrono::duration<double, std::milli>(reference).count() / runs;
+		const double resampled_ms = std::chrono::duration<double, std::milli>(resampled).count() / runs;
+		epro::print("{:<14}{:>16.3f}{:>16.3f}{:>9.1f}x{:>10}\n", target.name, reference_ms, resampled_ms,
+					resampled_ms > 0 ? reference_ms / resampled_ms : 0.0, diff);
+	}
+	for(auto* picture : pictures)
+		picture->drop();
+	device->drop();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,12 @@
+#ifndef IMAGE_SCALER_BENCHMARK_H
+#define IMAGE_SCALER_BENCHMARK_H
+#include "cli_args.h"
+
+// Headless mode started with -benchmark-image-scaler [iterations]. Scales the
+// card pictures in ./pics (or generated ones of the same sizes if there are
+// none) to the sizes the client shows them at, with ResampleImage and with
+// the per-pixel filter it replaced, and prints the time each took and how far
+// apart their results are.
+int image_scaler_benchmark_main(const args_t& args);
+
+#endif //IMAGE_SCALER_BENCHMARK_H
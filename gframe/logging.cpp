@@ -1,17 +1,220 @@
 #include "logging.h"
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <ctime>
+#include <memory>
+#include "epro_condition_variable.h"
+#include "epro_mutex.h"
+#include "epro_thread.h"
 #include "fmt.h"
 #include "file_stream.h"
 #include "localtime.h"
+#include "utils.h"
 
 namespace ygo {
 
-void ErrorLog(epro::stringview msg) {
-	FileStream log{ EPRO_TEXT("error.log"), FileStream::out | FileStream::app };
-	if (!log.good())
+namespace {
+
+constexpr auto LOG_FILE = EPRO_TEXT("error.log");
+//error.log is moved to error.log.1 past this size, and so on up to LOG_BACKUPS
+constexpr int64_t MAX_LOG_SIZE = 4 * 1024 * 1024;
+constexpr int LOG_BACKUPS = 3;
+
+std::atomic<uint8_t> minLevel{ static_cast<uint8_t>(EDOPRO_MIN_LOG_LEVEL) };
+
+struct Message {
+	std::time_t time;
+	LogLevel level;
+	std::string text;
+};
+
+//Bounded queue with any number of producers and a single consumer. Every
+//cell carries a sequence number telling whose turn it is, so pushing a
+//message takes a single compare and swap and never waits on the writer.
+class MessageQueue {
+public:
+	MessageQueue() : enqueuePos(0), dequeuePos(0) {
+		for(size_t i = 0; i < cells.size(); ++i)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	//False if the queue is full
+	bool Push(Message&& message) {
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		while(true) {
+			auto& cell = cells[pos & MASK];
+			const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+			if(diff < 0)
+				return false;
+			if(diff > 0) {
+				pos = enqueuePos.load(std::memory_order_relaxed);
+				continue;
+			}
+			if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				cell.message = std::move(message);
+				cell.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+	}
+	//Consumer only
+	bool Pop(Message& message) {
+		auto& cell = cells[dequeuePos & MASK];
+		if(cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+			return false;
+		message = std::move(cell.message);
+		cell.sequence.store(dequeuePos + cells.size(), std::memory_order_release);
+		++dequeuePos;
+		return true;
+	}
+private:
+	static constexpr size_t SIZE = 1024;
+	static constexpr size_t MASK = SIZE - 1;
+	static_assert((SIZE & MASK) == 0, "The size must be a power of two");
+	struct Cell {
+		std::atomic<size_t> sequence;
+		Message message;
+	};
+	std::array<Cell, SIZE> cells;
+	alignas(64) std::atomic<size_t> enqueuePos;
+	alignas(64) size_t dequeuePos;
+};
+
+class Logger {
+public:
+	void Log(LogLevel level, epro::stringview msg) {
+		Message message{ std::time(nullptr), level, std::string{ msg } };
+		if(running) {
+			if(queue.Push(std::move(message))) {
+				//Errors go out now, the rest with the next batch
+				if(level == LogLevel::ERR)
+					cv.notify_one();
+				//Stop might have drained the queue for the last time already
+				if(!running) {
+					std::lock_guard<epro::mutex> lck(mutex);
+					Drain();
+				}
+				return;
+			}
+			//Full, the caller waits for the file instead of losing the message
+		}
+		std::lock_guard<epro::mutex> lck(mutex);
+		//What's queued was logged first
+		Drain();
+		Write(message);
+		file->flush();
+	}
+	void Start() {
+		std::lock_guard<epro::mutex> lck(mutex);
+		stop = false;
+		running = true;
+		thread = epro::thread(&Logger::WriterThread, this);
+	}
+	void Stop() {
+		{
+			std::lock_guard<epro::mutex> lck(mutex);
+			//From now on messages are written right away
+			running = false;
+			stop = true;
+			cv.notify_one();
+		}
+		thread.join();
+		//Whatever got in while the thread was exiting
+		std::lock_guard<epro::mutex> lck(mutex);
+		Drain();
+	}
+private:
+	MessageQueue queue;
+	std::atomic<bool> running{ false };
+	epro::mutex mutex;
+	epro::condition_variable cv;
+	epro::thread thread;
+	bool stop = false;
+	//Guarded by mutex
+	std::unique_ptr<FileStream> file;
+	int64_t fileSize = 0;
+
+	void WriterThread() {
+		Utils::SetThreadName("Logger");
+		std::unique_lock<epro::mutex> lck(mutex);
+		while(true) {
+			Drain();
+			if(stop)
+				return;
+			//Producers don't take the mutex to notify, a wakeup can be
+			//missed and is made up for by the timeout
+			cv.wait_for(lck, std::chrono::milliseconds(250));
+		}
+	}
+	void Drain() {
+		Message message;
+		bool wrote = false;
+		while(queue.Pop(message)) {
+			Write(message);
+			wrote = true;
+		}
+		if(wrote)
+			file->flush();
+	}
+	void Write(const Message& message) {
+		if(!file || fileSize >= MAX_LOG_SIZE)
+			Open();
+		//Errors keep the format error.log always had
+		static constexpr epro::stringview prefixes[]{ "[debug] ", "[info] ", "[warning] ", "" };
+		const auto line = epro::format("[{:%Y-%m-%d %H:%M:%S}] {}{}\n", epro::localtime(message.time),
+									   prefixes[static_cast<uint8_t>(message.level)], message.text);
+		file->write(line.data(), line.size());
+		fileSize += line.size();
+	}
+	void Open() {
+		if(file && fileSize >= MAX_LOG_SIZE) {
+			file.reset();
+			Utils::FileDelete(epro::format(EPRO_TEXT("{}.{}"), LOG_FILE, LOG_BACKUPS));
+			for(int i = LOG_BACKUPS - 1; i > 0; --i)
+				Utils::FileMove(epro::format(EPRO_TEXT("{}.{}"), LOG_FILE, i),
+								epro::format(EPRO_TEXT("{}.{}"), LOG_FILE, i + 1));
+			Utils::FileMove(LOG_FILE, epro::format(EPRO_TEXT("{}.1"), LOG_FILE));
+		}
+		file = std::make_unique<FileStream>(LOG_FILE, FileStream::out | FileStream::app);
+		file->seekp(0, std::ios::end);
+		const auto end = file->tellp();
+		fileSize = end < 0 ? 0 : static_cast<int64_t>(end);
+	}
+};
+
+//Never destroyed, something might still log from a static destructor
+Logger& GetLogger() {
+	static auto* logger = new Logger();
+	return *logger;
+}
+
+}
+
+void SetLogLevel(LogLevel level) {
+	minLevel = static_cast<uint8_t>(level);
+}
+
+bool IsLogEnabled(LogLevel level) {
+	return static_cast<uint8_t>(level) >= minLevel.load(std::memory_order_relaxed);
+}
+
+void Log(LogLevel level, epro::stringview msg) {
+	if(!IsLogEnabled(level))
 		return;
-	auto now = std::time(nullptr);
-	log << epro::format("[{:%Y-%m-%d %H:%M:%S}] {}", epro::localtime(now), msg) << std::endl;
+	GetLogger().Log(level, msg);
+}
+
+void ErrorLog(epro::stringview msg) {
+	Log(LogLevel::ERR, msg);
+}
+
+LogWriter::LogWriter() {
+	GetLogger().Start();
+}
+
+LogWriter::~LogWriter() {
+	GetLogger().Stop();
 }
 
 }
@@ -1,13 +1,63 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
+#include <cstdint>
 #include "text_types.h"
 #include "fmt.h"
 
+//Messages below this level are compiled out, debug builds keep everything
+#ifndef EDOPRO_MIN_LOG_LEVEL
+#ifdef _DEBUG
+#define EDOPRO_MIN_LOG_LEVEL 0
+#else
+#define EDOPRO_MIN_LOG_LEVEL 1
+#endif
+#endif
+
 namespace ygo {
 
+//ERR rather than ERROR, which is a macro on Windows
+enum class LogLevel : uint8_t {
+	DEBUG,
+	INFO,
+	WARNING,
+	ERR,
+};
+
+//Messages below level are dropped at runtime as well
+void SetLogLevel(LogLevel level);
+bool IsLogEnabled(LogLevel level);
+
+//Appends msg to error.log. While a LogWriter is alive the write happens on
+//its thread, otherwise right away.
+void Log(LogLevel level, epro::stringview msg);
+
 void ErrorLog(epro::stringview msg);
 
+template<LogLevel level, std::size_t N, typename...Arg>
+inline void LogFormatted(char const (&format)[N], Arg&&... args) {
+	if constexpr(static_cast<int>(level) >= EDOPRO_MIN_LOG_LEVEL) {
+		//Don't pay for the formatting of a message nobody reads
+		if(IsLogEnabled(level))
+			Log(level, epro::format(format, std::forward<Arg>(args)...));
+	}
+}
+
+template<std::size_t N, typename...Arg>
+inline void DebugLog(char const (&format)[N], Arg&&... args) {
+	LogFormatted<LogLevel::DEBUG>(format, std::forward<Arg>(args)...);
+}
+
+template<std::size_t N, typename...Arg>
+inline void InfoLog(char const (&format)[N], Arg&&... args) {
+	LogFormatted<LogLevel::INFO>(format, std::forward<Arg>(args)...);
+}
+
+template<std::size_t N, typename...Arg>
+inline void WarningLog(char const (&format)[N], Arg&&... args) {
+	LogFormatted<LogLevel::WARNING>(format, std::forward<Arg>(args)...);
+}
+
 //Explicitly get a T parameter to be sure that the function is called only with 2+ arguments
 //to avoid it capturing calls that would fall back to the default stringview implementation
 template<std::size_t N, typename T, typename...Arg>
@@ -15,6 +65,16 @@ inline void ErrorLog(char const (&format)[N], T&& arg1, Arg&&... args) {
 	ErrorLog(epro::format(format, std::forward<T>(arg1), std::forward<Arg>(args)...));
 }
 
+//Writes the log from a background thread for as long as it lives, callers
+//only queue their messages. Whatever is queued is written before it's gone.
+class LogWriter {
+public:
+	LogWriter();
+	~LogWriter();
+	LogWriter(const LogWriter&) = delete;
+	LogWriter& operator=(const LogWriter&) = delete;
+};
+
 }
 
 #endif
@@ -0,0 +1,48 @@
+#include "modular_art_fit.h"
+#include "image_scaler.h"
+#include "modular_card_renderer.h"
+#include <IImage.h>
+#include <IVideoDriver.h>
+
+namespace ygo {
+
+irr::video::IImage *FitModularArt(irr::video::IVideoDriver *driver,
+                                  irr::video::IImage *art, bool pendulum) {
+  if (!art)
+    return nullptr;
+  const auto box = ModularCardRenderer::GetArtBox(pendulum);
+  const irr::core::dimension2du size(box.getWidth(), box.getHeight());
+  const auto &artSize = art->getDimension();
+  auto crop = ModularCardRenderer::GetArtCrop(artSize, pendulum);
+  crop.clipAgainst(irr::core::recti(0, 0, artSize.Width, artSize.Height));
+  if (crop.getWidth() <= 0 || crop.getHeight() <= 0)
+    return nullptr;
+
+  irr::video::IImage *fitted =
+      driver->createImage(irr::video::ECF_A8R8G8B8, size);
+  switch (art->getColorFormat()) {
+  case irr::video::ECF_A8R8G8B8:
+    ResampleImagePremultiplied(art, crop, fitted);
+    break;
+  case irr::video::ECF_R8G8B8: {
+    // JPG art has no alpha, only the scaled result is converted
+    irr::video::IImage *scaled =
+        driver->createImage(irr::video::ECF_R8G8B8, size);
+    ResampleImage(art, crop, scaled);
+    scaled->copyTo(fitted);
+    scaled->drop();
+    break;
+  }
+  default: {
+    irr::video::IImage *source =
+        driver->createImage(irr::video::ECF_A8R8G8B8, artSize);
+    art->copyTo(source);
+    ResampleImagePremultiplied(source, crop, fitted);
+    source->drop();
+    break;
+  }
+  }
+  return fitted;
+}
+
+} // namespace ygo
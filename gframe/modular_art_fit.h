@@ -0,0 +1,19 @@
+#ifndef MODULAR_ART_FIT_H
+#define MODULAR_ART_FIT_H
+
+#include "config.h"
+#include <irrlicht.h>
+
+namespace ygo {
+
+// Crops art to the part the frame of a regular or pendulum card shows and
+// resamples it to exactly the size of the art box with ResampleImage, so the
+// renderer draws it 1:1 instead of sampling the full source every time.
+// Transparent art is weighted by alpha. Returns a new A8R8G8B8 image the
+// caller drops, or nullptr. Any thread.
+irr::video::IImage *FitModularArt(irr::video::IVideoDriver *driver,
+                                  irr::video::IImage *art, bool pendulum);
+
+} // namespace ygo
+
+#endif // MODULAR_ART_FIT_H
@@ -4,9 +4,15 @@
 #include "fmt.h"
 #include "game_config.h"
 #include "logging.h"
+#include "modular_art_fit.h"
+#include "modular_card_renderer.h"
+#include "modular_card_table.h"
 #include "utils.h"
+#include <algorithm>
 #include <array>
+#include <ctime>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 namespace ygo {
@@ -67,63 +73,254 @@ GetExtension(const std::array<uint8_t, 8> &header) {
   }
 }
 
+// The code a cached file is named after, the digits before end
+static bool ParseCode(epro::path_stringview name, size_t end, uint32_t &code) {
+  if (end == 0 || end == epro::path_stringview::npos || end > name.size())
+    return false;
+  code = 0;
+  for (size_t i = 0; i < end; ++i) {
+    if (name[i] < EPRO_TEXT('0') || name[i] > EPRO_TEXT('9'))
+      return false;
+    code = code * 10 + static_cast<uint32_t>(name[i] - EPRO_TEXT('0'));
+  }
+  return true;
+}
+
+// Lets curl abort a transfer in progress when the manager shuts down
+static int ProgressCallback(void *clientp, curl_off_t, curl_off_t, curl_off_t,
+                            curl_off_t) {
+  return static_cast<std::atomic<bool> *>(clientp)->load() ? 1 : 0;
+}
+
 ModularArtManager::ModularArtManager(irr::IrrlichtDevice *device)
     : device(device), driver(device->getVideoDriver()),
-      cacheDir(EPRO_TEXT("pics_modular")) {
+      cacheDir(EPRO_TEXT("pics_modular")), artIndexReady(false),
+      artBudget(size_t{gGameConfig->modularArtCacheMB} * 1024 * 1024),
+      artBytes(0), artHits(0), artMisses(0), artEvictions(0),
+      stopThreads(false) {
   // Create cache directory if it doesn't exist
   Utils::MakeDirectory(cacheDir);
+  Utils::MakeDirectory(epro::format(EPRO_TEXT("{}/fitted"), cacheDir));
+  if (gGameConfig->modularArtPack)
+    artPack = std::make_unique<ModularArtPack>(device->getFileSystem(),
+                                               cacheDir);
+  LoadMissingArt();
+  indexThread = epro::thread(&ModularArtManager::IndexThread, this);
+  const int threads = std::max<int>(gGameConfig->modularArtDownloadThreads, 1);
+  downloadThreads.reserve(threads);
+  for (int i = 0; i < threads; ++i)
+    downloadThreads.emplace_back(&ModularArtManager::DownloadThread, this);
+  decodeThread = epro::thread(&ModularArtManager::DecodeThread, this);
 }
 
 ModularArtManager::~ModularArtManager() {
-  // Textures are managed by Irrlicht, just clear our cache map
-  artCache.clear();
+  {
+    std::lock_guard<epro::mutex> lck(downloadMutex);
+    stopThreads = true;
+    cv.notify_all();
+    decodeCv.notify_all();
+  }
+  for (auto &thread : downloadThreads)
+    thread.join();
+  decodeThread.join();
+  indexThread.join();
+  for (auto &art : finished) {
+    if (art.image)
+      art.image->drop();
+  }
+  SaveMissingArt();
+  for (auto &entry : artEntries)
+    driver->removeTexture(entry.texture);
 }
 
 irr::video::ITexture *ModularArtManager::GetCardArt(uint32_t code,
                                                     bool preferHighRes) {
-  ErrorLog("ModularArtManager::GetCardArt called for code {}", code);
-
   // Check cache first
   auto it = artCache.find(code);
-  if (it != artCache.end() && it->second) {
-    ErrorLog("ModularArtManager: Found in memory cache");
-    return it->second;
-  }
-
-  // Try to load from disk cache
-  irr::video::ITexture *cached = LoadFromCache(code);
-  if (cached) {
-    ErrorLog("ModularArtManager: Found in disk cache");
-    artCache[code] = cached;
-    return cached;
-  }
-
-  // Not cached, try synchronous download
-  ErrorLog("ModularArtManager: Not in cache, attempting download...");
-  bool success = false;
-  std::string url = preferHighRes ? GetHighResURL(code) : GetStandardURL(code);
-  ErrorLog("ModularArtManager: Trying URL: {}", url);
-  success = DownloadAndCache(code, url);
-
-  // If high-res failed and we prefer high-res, try standard
-  if (!success && preferHighRes) {
-    url = GetStandardURL(code);
-    ErrorLog("ModularArtManager: High-res failed, trying standard: {}", url);
-    success = DownloadAndCache(code, url);
-  }
-
-  if (success) {
-    ErrorLog("ModularArtManager: Download succeeded, loading from cache");
-    cached = LoadFromCache(code);
-    if (cached) {
-      artCache[code] = cached;
-      return cached;
+  if (it != artCache.end()) {
+    ++artHits;
+    artEntries.splice(artEntries.begin(), artEntries, it->second);
+    return it->second->texture;
+  }
+  ++artMisses;
+
+  // Not loaded, queue the decode or the download and let the caller draw a
+  // placeholder
+  {
+    std::lock_guard<epro::mutex> lck(downloadMutex);
+    texturesWanted.insert(code);
+  }
+  DownloadArtAsync(code, preferHighRes);
+  return nullptr;
+}
+
+epro::path_string ModularArtManager::GetCardArtPath(uint32_t code,
+                                                   bool preferHighRes) {
+  if (!IsDownloading(code)) {
+    auto cachePath = FindCachedArt(code);
+    if (!cachePath.empty())
+      return cachePath;
+  }
+  DownloadArtAsync(code, preferHighRes);
+  return {};
+}
+
+epro::path_string ModularArtManager::PrefetchArt(uint32_t code,
+                                                bool preferHighRes) {
+  if (!IsDownloading(code)) {
+    auto cachePath = FindCachedArt(code);
+    if (!cachePath.empty())
+      return cachePath;
+  }
+  DownloadArtAsync(code, preferHighRes, nullptr, true);
+  return {};
+}
+
+epro::path_string ModularArtManager::GetCachedArtPath(uint32_t code) const {
+  return FindCachedArt(code);
+}
+
+irr::io::IReadFile *
+ModularArtManager::OpenArt(epro::path_stringview path) const {
+  if (artPack) {
+    if (const uint32_t code = artPack->GetCode(path))
+      return artPack->Open(code);
+  }
+  return device->getFileSystem()->createAndOpenFile(
+      {path.data(), static_cast<irr::u32>(path.size())});
+}
+
+bool ModularArtManager::GetArtStat(epro::path_stringview path,
+                                   ArtStat &stat) const {
+  stat = {};
+  if (artPack) {
+    if (const uint32_t code = artPack->GetCode(path)) {
+      uint32_t packedSize;
+      if (!artPack->GetEntry(code, stat.offset, packedSize))
+        return false;
+      stat.size = packedSize;
+      return true;
     }
+  }
+  return Utils::GetFileStat(path, stat.size, stat.mtime);
+}
+
+irr::video::IImage *
+ModularArtManager::LoadFittedArt(uint32_t code, epro::path_stringview artPath,
+                                 bool pendulum) const {
+  ArtStat artStat;
+  if (artPath.empty() || !GetArtStat(artPath, artStat))
+    return nullptr;
+  const auto box = ModularCardRenderer::GetArtBox(pendulum);
+  const irr::core::dimension2du size(box.getWidth(), box.getHeight());
+  const auto path = GetFittedArtPath(cacheDir, code, pendulum);
+  const auto keyPath =
+      GetFittedArtPath(cacheDir, code, pendulum, EPRO_TEXT(".key"));
+  bool upToDate;
+  if (artIndexReady) {
+    std::lock_guard<epro::mutex> lck(artIndexMutex);
+    const auto &index = fittedIndex[pendulum];
+    auto it = index.find(code);
+    upToDate = it != index.end() && it->second == artStat;
   } else {
-    ErrorLog("ModularArtManager: Download failed for code {}", code);
+    // Until the scan is done the key is read from disk
+    ArtStat fittedStat;
+    upToDate = ReadFittedKey(keyPath, fittedStat) && fittedStat == artStat;
+  }
+  if (upToDate) {
+    irr::video::IImage *image = driver->createImageFromFile(
+        {path.data(), static_cast<irr::u32>(path.size())});
+    if (image && image->getDimension() == size) {
+      if (image->getColorFormat() == irr::video::ECF_A8R8G8B8)
+        return image;
+      irr::video::IImage *converted =
+          driver->createImage(irr::video::ECF_A8R8G8B8, size);
+      image->copyTo(converted);
+      image->drop();
+      return converted;
+    }
+    // Left over from a different layout
+    if (image)
+      image->drop();
   }
 
-  return nullptr;
+  irr::video::IImage *art = nullptr;
+  if (irr::io::IReadFile *file = OpenArt(artPath)) {
+    art = driver->createImageFromFile(file);
+    file->drop();
+  }
+  irr::video::IImage *fitted = FitModularArt(driver, art, pendulum);
+  if (art)
+    art->drop();
+  if (!fitted)
+    return nullptr;
+  // Written under a name of this thread's own, the decode thread and the
+  // compositor workers can fit the same art at once. Stored as PNG, the
+  // copy is read back instead of the original, so it mustn't lose detail.
+  // The key goes last, a file interrupted halfway is never used.
+  const auto tmpPath = epro::format(
+      EPRO_TEXT("{}.{}.tmp.png"), path,
+      std::hash<epro::thread::id>{}(epro::this_thread::get_id()));
+  {
+    std::lock_guard<epro::mutex> lck(artIndexMutex);
+    fittedIndex[pendulum].erase(code);
+  }
+  Utils::FileDelete(keyPath);
+  Utils::FileDelete(path);
+  if (!driver->writeImageToFile(
+          fitted, {tmpPath.data(), static_cast<irr::u32>(tmpPath.size())}) ||
+      !Utils::FileMove(tmpPath, path)) {
+    Utils::FileDelete(tmpPath);
+    return fitted;
+  }
+  {
+    FileStream key{keyPath, FileStream::out | FileStream::trunc};
+    if (!(key << epro::format("{} {} {}", artStat.size, artStat.mtime,
+                              artStat.offset)))
+      return fitted;
+  }
+  std::lock_guard<epro::mutex> lck(artIndexMutex);
+  fittedIndex[pendulum][code] = artStat;
+  return fitted;
+}
+
+epro::path_string
+ModularArtManager::GetFittedArtPath(epro::path_stringview cacheDir,
+                                    uint32_t code, bool pendulum,
+                                    epro::path_stringview ext) {
+  return epro::format(EPRO_TEXT("{}/fitted/{}{}{}"), cacheDir, code,
+                      pendulum ? EPRO_TEXT(".pendulum") : EPRO_TEXT(""), ext);
+}
+
+bool ModularArtManager::ReadFittedKey(const epro::path_string &path,
+                                      ArtStat &stat) {
+  FileStream key{path, FileStream::in};
+  return key.is_open() && (key >> stat.size >> stat.mtime >> stat.offset);
+}
+
+void ModularArtManager::DeleteFittedArt(epro::path_stringview cacheDir,
+                                        uint32_t code) {
+  for (bool pendulum : {false, true}) {
+    Utils::FileDelete(GetFittedArtPath(cacheDir, code, pendulum,
+                                       EPRO_TEXT(".key")));
+    Utils::FileDelete(GetFittedArtPath(cacheDir, code, pendulum));
+    // Fitted from JPG art by earlier versions
+    Utils::FileDelete(
+        GetFittedArtPath(cacheDir, code, pendulum, EPRO_TEXT(".jpg")));
+  }
+}
+
+void ModularArtManager::PinArt(uint32_t code) {
+  auto it = artCache.find(code);
+  if (it != artCache.end())
+    ++it->second->pins;
+}
+
+void ModularArtManager::UnpinArt(uint32_t code) {
+  auto it = artCache.find(code);
+  if (it != artCache.end() && it->second->pins > 0)
+    --it->second->pins;
+  EvictArt();
 }
 
 bool ModularArtManager::IsArtCached(uint32_t code) const {
@@ -132,45 +329,401 @@ bool ModularArtManager::IsArtCached(uint32_t code) const {
     return true;
   }
 
-  // Check disk cache (try both .jpg and .png)
-  auto jpgPath = epro::format(EPRO_TEXT("{}/{}.jpg"), cacheDir, code);
-  auto pngPath = epro::format(EPRO_TEXT("{}/{}.png"), cacheDir, code);
-  return Utils::FileExists(jpgPath) || Utils::FileExists(pngPath);
+  return !FindCachedArt(code).empty();
+}
+
+bool ModularArtManager::IsDownloading(uint32_t code) {
+  std::lock_guard<epro::mutex> lck(downloadMutex);
+  auto it = downloads.find(code);
+  return it != downloads.end() && it->second == downloadStatus::DOWNLOADING;
+}
+
+void ModularArtManager::DownloadArtAsync(uint32_t code, bool preferHighRes,
+                                         ArtCallback callback, bool prefetch) {
+  const bool pendulum = gModularCardTable->Get(code)->isPendulum;
+  std::unique_lock<epro::mutex> lck(downloadMutex);
+  auto it = downloads.find(code);
+  if (it != downloads.end() && it->second == downloadStatus::DOWNLOADING) {
+    // Already in flight, just wait for it alongside the other requests.
+    // If it was prefetched and is still queued, it's needed now.
+    if (!prefetch) {
+      auto queued = std::find_if(
+          toDownload.begin(), toDownload.end(),
+          [code](const downloadParam &param) { return param.code == code; });
+      if (queued != toDownload.end() && queued != toDownload.begin()) {
+        const auto param = *queued;
+        toDownload.erase(queued);
+        toDownload.push_front(param);
+      }
+      auto decoding = std::find_if(
+          toDecode.begin(), toDecode.end(),
+          [code](const decodeParam &param) { return param.code == code; });
+      if (decoding != toDecode.end() && decoding != toDecode.begin()) {
+        const auto param = *decoding;
+        toDecode.erase(decoding);
+        toDecode.push_front(param);
+      }
+    }
+    lck.unlock();
+    if (callback)
+      pendingCallbacks[code].push_back(std::move(callback));
+    return;
+  }
+  if (const auto artPath = FindCachedArt(code); !artPath.empty()) {
+    auto bad = badArt.find(code);
+    if (bad != badArt.end()) {
+      ArtStat stat;
+      if (GetArtStat(artPath, stat) && stat == bad->second) {
+        // Failed to decode, not worth another try until it's replaced
+        texturesWanted.erase(code);
+        lck.unlock();
+        if (callback)
+          callback(nullptr);
+        return;
+      }
+      badArt.erase(bad);
+    }
+    if (!texturesWanted.count(code)) {
+      // Only the file was asked for and it's there
+      lck.unlock();
+      if (callback)
+        callback(nullptr);
+      return;
+    }
+    // Already on disk, it only has to be decoded
+    downloads[code] = downloadStatus::DOWNLOADING;
+    if (prefetch)
+      toDecode.push_back(decodeParam{code, pendulum});
+    else
+      toDecode.push_front(decodeParam{code, pendulum});
+    decodeCv.notify_one();
+    lck.unlock();
+    if (callback)
+      pendingCallbacks[code].push_back(std::move(callback));
+    return;
+  }
+  // The art that failed to decode was deleted, download it again
+  if (badArt.erase(code)) {
+    downloads.erase(code);
+    it = downloads.end();
+  }
+  // Failed earlier this session, no mirror had it recently or none is
+  // reachable, don't go through the timeouts again
+  if ((it != downloads.end() &&
+       it->second == downloadStatus::DOWNLOAD_ERROR) ||
+      IsArtMissing(code) || !IsAnyHostAvailable(code, preferHighRes)) {
+    lck.unlock();
+    if (callback)
+      callback(nullptr);
+    return;
+  }
+  downloads[code] = downloadStatus::DOWNLOADING;
+  if (prefetch)
+    toDownload.push_back(downloadParam{code, preferHighRes, pendulum});
+  else
+    toDownload.push_front(downloadParam{code, preferHighRes, pendulum});
+  cv.notify_one();
+  lck.unlock();
+  if (callback)
+    pendingCallbacks[code].push_back(std::move(callback));
+}
+
+void ModularArtManager::Update() {
+  std::deque<decodedArt> done;
+  {
+    std::lock_guard<epro::mutex> lck(downloadMutex);
+    if (finished.empty())
+      return;
+    done.swap(finished);
+  }
+  for (auto &art : done) {
+    // Only the upload is left for the main thread
+    irr::video::ITexture *texture = nullptr;
+    if (art.image) {
+      const irr::io::path name{art.path.data(),
+                               static_cast<irr::u32>(art.path.size())};
+      texture = driver->findTexture(name);
+      if (!texture)
+        texture = driver->addTexture(name, art.image);
+      art.image->drop();
+      if (texture)
+        CacheArt(art.code, texture);
+    }
+    auto it = pendingCallbacks.find(art.code);
+    if (it == pendingCallbacks.end())
+      continue;
+    auto callbacks = std::move(it->second);
+    pendingCallbacks.erase(it);
+    for (auto &callback : callbacks)
+      callback(texture);
+  }
+}
+
+void ModularArtManager::ClearCache() {
+  for (auto it = artEntries.begin(); it != artEntries.end();) {
+    if (it->pins > 0) {
+      ++it;
+      continue;
+    }
+    artBytes -= it->bytes;
+    driver->removeTexture(it->texture);
+    artCache.erase(it->code);
+    it = artEntries.erase(it);
+  }
 }
 
-void ModularArtManager::DownloadArtAsync(
-    uint32_t code, bool preferHighRes,
-    std::function<void(irr::video::ITexture *)> callback) {
-  // For now, this is synchronous - can be made async later
-  std::string url = preferHighRes ? GetHighResURL(code) : GetStandardURL(code);
-  bool success = DownloadAndCache(code, url);
+void ModularArtManager::SetCacheBudget(size_t budgetBytes) {
+  artBudget = budgetBytes;
+  EvictArt();
+}
 
-  if (!success && preferHighRes) {
-    url = GetStandardURL(code);
-    success = DownloadAndCache(code, url);
+ModularArtManager::CacheStats ModularArtManager::GetCacheStats() const {
+  return CacheStats{artHits,  artMisses, artEvictions,
+                    artBytes, artBudget, artEntries.size()};
+}
+
+void ModularArtManager::CacheArt(uint32_t code, irr::video::ITexture *texture) {
+  auto existing = artCache.find(code);
+  if (existing != artCache.end()) {
+    // Reloaded after a download replaced the file
+    artEntries.splice(artEntries.begin(), artEntries, existing->second);
+    if (existing->second->texture == texture)
+      return;
+    artBytes -= existing->second->bytes;
+    driver->removeTexture(existing->second->texture);
+    artEntries.front().texture = texture;
+  } else {
+    artEntries.push_front(ArtEntry{code, texture, 0, 0});
+    artCache[code] = artEntries.begin();
   }
+  const auto &size = texture->getSize();
+  // 4 bytes per texel, plus a third for the mip chain if there is one
+  size_t bytes = static_cast<size_t>(size.Width) * size.Height * 4;
+  if (texture->hasMipMaps())
+    bytes += bytes / 3;
+  artEntries.front().bytes = bytes;
+  artBytes += bytes;
+  EvictArt();
+}
+
+void ModularArtManager::EvictArt() {
+  // The most recently used art is never evicted, its caller is about to use
+  // it even if it alone is over budget
+  auto it = artEntries.end();
+  while (artBytes > artBudget && it != artEntries.begin()) {
+    --it;
+    if (it == artEntries.begin())
+      break;
+    if (it->pins > 0)
+      continue;
+    artBytes -= it->bytes;
+    driver->removeTexture(it->texture);
+    artCache.erase(it->code);
+    it = artEntries.erase(it);
+    ++artEvictions;
+  }
+}
+
+void ModularArtManager::DownloadThread() {
+  Utils::SetThreadName("ModularArtDL");
+  auto curl = curl_easy_init();
+  if (!curl) {
+    ErrorLog("ModularArtManager: Failed to start downloader thread");
+    return;
+  }
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+  curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &stopThreads);
+  while (true) {
+    std::unique_lock<epro::mutex> lck(downloadMutex);
+    while (toDownload.empty() && !stopThreads)
+      cv.wait(lck);
+    if (stopThreads)
+      break;
+    const auto param = toDownload.front();
+    toDownload.pop_front();
+    lck.unlock();
+
+    const auto code = param.code;
+    auto result = downloadResult::NOT_FOUND;
+    // Set when a mirror couldn't answer, the art might still exist
+    bool unanswered = false;
+    for (const auto &url : GetURLs(code, param.preferHighRes)) {
+      if (stopThreads) {
+        result = downloadResult::ABORTED;
+        break;
+      }
+      const auto host = GetHost(url);
+      lck.lock();
+      const bool available = IsHostAvailable(host);
+      lck.unlock();
+      if (!available) {
+        unanswered = true;
+        continue;
+      }
+      result = DownloadAndCache(curl, code, url);
+      if (result == downloadResult::ABORTED)
+        break;
+      lck.lock();
+      OnHostResult(host, result != downloadResult::HOST_ERROR);
+      lck.unlock();
+      if (result == downloadResult::OK)
+        break;
+      if (result == downloadResult::HOST_ERROR)
+        unanswered = true;
+    }
 
-  if (callback) {
-    irr::video::ITexture *texture = success ? LoadFromCache(code) : nullptr;
-    callback(texture);
+    // A new download replaces the art, and with it what was fitted from it
+    if (result == downloadResult::OK) {
+      DeleteFittedArt(cacheDir, code);
+      std::lock_guard<epro::mutex> idxLck(artIndexMutex);
+      for (auto &index : fittedIndex)
+        index.erase(code);
+    }
+    lck.lock();
+    if (result == downloadResult::OK && texturesWanted.count(code)) {
+      // Still in flight until the decode thread is done with it
+      toDecode.push_back(decodeParam{code, param.pendulum});
+      decodeCv.notify_one();
+      continue;
+    } else if (result == downloadResult::OK) {
+      // Only the file was asked for, the compositor decodes it itself
+      downloads[code] = downloadStatus::DOWNLOADED;
+    } else if (result == downloadResult::NOT_FOUND && !unanswered) {
+      // Every mirror answered that it doesn't have it
+      InfoLog("ModularArtManager: No art for {} on any mirror, not asking "
+               "again for {} days",
+               code, MISSING_ART_TTL / (24 * 60 * 60));
+      missingArt[code] = static_cast<int64_t>(std::time(nullptr)) +
+                         MISSING_ART_TTL;
+      downloads[code] = downloadStatus::DOWNLOAD_ERROR;
+    } else {
+      // Aborted or a mirror couldn't answer, try again on a later request,
+      // once a host that failed is out of its backoff
+      downloads.erase(code);
+    }
+    texturesWanted.erase(code);
+    finished.push_back(decodedArt{code, nullptr, {}});
   }
+  curl_easy_cleanup(curl);
 }
 
-void ModularArtManager::ClearCache() { artCache.clear(); }
+void ModularArtManager::DecodeThread() {
+  Utils::SetThreadName("ModularArtDec");
+  std::unique_lock<epro::mutex> lck(downloadMutex);
+  while (true) {
+    while (toDecode.empty() && !stopThreads)
+      decodeCv.wait(lck);
+    if (stopThreads)
+      break;
+    const auto param = toDecode.front();
+    toDecode.pop_front();
+    const auto code = param.code;
+    const bool pendulum = param.pendulum;
+    lck.unlock();
+
+    // The texture only holds what the card shows, at the size it's drawn.
+    // It's named after the fitted file, like getTexture would name it.
+    const auto artPath = FindCachedArt(code);
+    irr::video::IImage *image = LoadFittedArt(code, artPath, pendulum);
+    epro::path_string path;
+    ArtStat stat;
+    bool bad = false;
+    if (image) {
+      path = GetFittedArtPath(cacheDir, code, pendulum);
+    } else {
+      WarningLog("ModularArtManager: Failed to decode the art of {}", code);
+      bad = GetArtStat(artPath, stat);
+    }
 
-epro::path_string ModularArtManager::GetCachePath(uint32_t code) const {
-  // First check for .jpg (more common from remote)
-  auto jpgPath = epro::format(EPRO_TEXT("{}/{}.jpg"), cacheDir, code);
-  if (Utils::FileExists(jpgPath))
-    return jpgPath;
+    lck.lock();
+    // A file that failed to decode isn't tried again until it changes, a
+    // vanished one is looked for again on the next request
+    if (image) {
+      downloads[code] = downloadStatus::DOWNLOADED;
+    } else if (bad) {
+      downloads[code] = downloadStatus::DOWNLOAD_ERROR;
+      badArt[code] = stat;
+    } else {
+      downloads.erase(code);
+    }
+    texturesWanted.erase(code);
+    finished.push_back(decodedArt{code, image, std::move(path)});
+  }
+}
 
-  // Then check for .png
-  auto pngPath = epro::format(EPRO_TEXT("{}/{}.png"), cacheDir, code);
-  if (Utils::FileExists(pngPath))
-    return pngPath;
+std::vector<std::string>
+ModularArtManager::GetURLs(uint32_t code, bool preferHighRes) const {
+  std::vector<std::string> urls;
+  if (preferHighRes)
+    urls.push_back(GetHighResURL(code));
+  // If high-res failed or wasn't wanted, try standard
+  auto standardUrl = GetStandardURL(code);
+  if (urls.empty() || urls.front() != standardUrl)
+    urls.push_back(std::move(standardUrl));
+  return urls;
+}
 
-  // Return the expected jpg path for new downloads
-  return jpgPath;
+epro::path_string ModularArtManager::FindCachedArt(uint32_t code) const {
+  if (artPack) {
+    auto path = artPack->GetPath(code);
+    if (!path.empty())
+      return path;
+  }
+  if (artIndexReady) {
+    std::lock_guard<epro::mutex> lck(artIndexMutex);
+    auto it = artIndex.find(code);
+    if (it == artIndex.end())
+      return {};
+    return epro::format(EPRO_TEXT("{}/{}{}"), cacheDir, code, it->second);
+  }
+  // First check for .jpg (more common from remote), then for .png
+  for (auto ext : {EPRO_TEXT(".jpg"), EPRO_TEXT(".png")}) {
+    auto path = epro::format(EPRO_TEXT("{}/{}{}"), cacheDir, code, ext);
+    if (Utils::FileExists(path))
+      return path;
+  }
+  return {};
+}
+
+void ModularArtManager::IndexThread() {
+  Utils::SetThreadName("ModularArtIdx");
+  std::unordered_map<uint32_t, epro::path_stringview> found;
+  for (const auto &file :
+       Utils::FindFiles(cacheDir, {EPRO_TEXT("jpg"), EPRO_TEXT("png")})) {
+    const auto dot = file.rfind(EPRO_TEXT('.'));
+    uint32_t code;
+    if (!ParseCode(file, dot, code))
+      continue;
+    // Same preference as the fallback: .jpg over .png
+    const bool jpg = file.compare(dot, epro::path_string::npos,
+                                  EPRO_TEXT(".jpg")) == 0;
+    auto &ext = found[code];
+    if (jpg || ext.empty())
+      ext = jpg ? EPRO_TEXT(".jpg") : EPRO_TEXT(".png");
+  }
+  // {code}.key and {code}.pendulum.key next to the fitted art
+  std::array<std::unordered_map<uint32_t, ArtStat>, 2> fitted;
+  const auto fittedDir = epro::format(EPRO_TEXT("{}/fitted"), cacheDir);
+  for (const auto &file : Utils::FindFiles(fittedDir, {EPRO_TEXT("key")})) {
+    const auto dot = file.find(EPRO_TEXT('.'));
+    uint32_t code;
+    ArtStat stat;
+    if (!ParseCode(file, dot, code) ||
+        !ReadFittedKey(epro::format(EPRO_TEXT("{}/{}"), fittedDir, file), stat))
+      continue;
+    const bool pendulum = file.compare(dot, epro::path_string::npos,
+                                       EPRO_TEXT(".pendulum.key")) == 0;
+    fitted[pendulum].emplace(code, stat);
+  }
+  std::lock_guard<epro::mutex> lck(artIndexMutex);
+  // Downloads that finished and art fitted during the scan are already
+  // indexed and win
+  for (const auto &entry : found)
+    artIndex.emplace(entry.first, entry.second);
+  for (size_t i = 0; i < fitted.size(); ++i)
+    fittedIndex[i].insert(fitted[i].begin(), fitted[i].end());
+  artIndexReady = true;
 }
 
 std::string ModularArtManager::GetHighResURL(uint32_t code) const {
@@ -185,14 +738,88 @@ std::string ModularArtManager::GetStandardURL(uint32_t code) const {
       "https://images.ygoprodeck.com/images/cards_cropped/{}.jpg", code);
 }
 
-bool ModularArtManager::DownloadAndCache(uint32_t code,
-                                         const std::string &url) {
-  auto curl = curl_easy_init();
-  if (!curl) {
-    ErrorLog("ModularArtManager: Failed to init curl");
-    return false;
+bool ModularArtManager::IsArtMissing(uint32_t code) const {
+  auto it = missingArt.find(code);
+  return it != missingArt.end() &&
+         it->second > static_cast<int64_t>(std::time(nullptr));
+}
+
+epro::path_string ModularArtManager::GetMissingArtFile() const {
+  return epro::format(EPRO_TEXT("{}/missing.txt"), cacheDir);
+}
+
+void ModularArtManager::LoadMissingArt() {
+  // One "code expiry" pair per line
+  FileStream file{GetMissingArtFile(), FileStream::in};
+  if (file.fail())
+    return;
+  const auto now = static_cast<int64_t>(std::time(nullptr));
+  uint32_t code;
+  int64_t expiry;
+  while (file >> code >> expiry) {
+    if (expiry > now)
+      missingArt[code] = expiry;
+  }
+}
+
+void ModularArtManager::SaveMissingArt() const {
+  const auto path = GetMissingArtFile();
+  const auto now = static_cast<int64_t>(std::time(nullptr));
+  std::string content;
+  for (const auto &entry : missingArt) {
+    if (entry.second > now)
+      content += epro::format("{} {}\n", entry.first, entry.second);
+  }
+  if (content.empty()) {
+    Utils::FileDelete(path);
+    return;
+  }
+  FileStream file{path, FileStream::out | FileStream::trunc};
+  if (!file.fail())
+    file << content;
+}
+
+std::string ModularArtManager::GetHost(const std::string &url) {
+  auto start = url.find("://");
+  start = (start == std::string::npos) ? 0 : start + 3;
+  return url.substr(start, url.find('/', start) - start);
+}
+
+bool ModularArtManager::IsHostAvailable(const std::string &host) const {
+  auto it = hosts.find(host);
+  return it == hosts.end() ||
+         std::chrono::steady_clock::now() >= it->second.retryAt;
+}
+
+bool ModularArtManager::IsAnyHostAvailable(uint32_t code,
+                                           bool preferHighRes) const {
+  for (const auto &url : GetURLs(code, preferHighRes)) {
+    if (IsHostAvailable(GetHost(url)))
+      return true;
+  }
+  return false;
+}
+
+void ModularArtManager::OnHostResult(const std::string &host, bool reachable) {
+  if (reachable) {
+    hosts.erase(host);
+    return;
   }
+  auto &state = hosts[host];
+  ++state.failures;
+  auto backoff = HOST_BACKOFF_MIN;
+  for (uint32_t i = 1; i < state.failures && backoff < HOST_BACKOFF_MAX; ++i)
+    backoff *= 2;
+  backoff = std::min(backoff, HOST_BACKOFF_MAX);
+  state.retryAt = std::chrono::steady_clock::now() + backoff;
+  WarningLog("ModularArtManager: {} unreachable, not trying it again for {}s",
+           host, backoff.count());
+}
 
+ModularArtManager::downloadResult
+ModularArtManager::DownloadAndCache(void *handle, uint32_t code,
+                                    const std::string &url) {
+  auto curl = static_cast<CURL *>(handle);
   CurlPayload payload;
   char curl_error_buffer[CURL_ERROR_SIZE];
 
@@ -225,9 +852,8 @@ bool ModularArtManager::DownloadAndCache(uint32_t code,
   // Open file for writing
   auto fp = fileopen(tempPath.c_str(), "wb");
   if (!fp) {
-    curl_easy_cleanup(curl);
     ErrorLog("ModularArtManager: Failed to open temp file for {}", code);
-    return false;
+    return downloadResult::ABORTED;
   }
 
   // Setup payload
@@ -242,41 +868,46 @@ bool ModularArtManager::DownloadAndCache(uint32_t code,
   if (res == CURLE_OK) {
     // Successfully downloaded, rename to final path with correct extension
     auto ext = GetExtension(payload.header);
+    if (artPack && AppendToPack(code, ext, tempPath)) {
+      Utils::FileDelete(tempPath);
+      return downloadResult::OK;
+    }
     auto finalPath =
         epro::format(EPRO_TEXT("{}/{}{}"), cacheDir, code, ext.data());
 
     if (!Utils::FileMove(tempPath, finalPath)) {
       Utils::FileDelete(tempPath);
-      curl_easy_cleanup(curl);
-      return false;
+      return downloadResult::ABORTED;
     }
-
-    curl_easy_cleanup(curl);
-    return true;
-  } else {
-    // Download failed - always log for debugging
-    Utils::FileDelete(tempPath);
-    curl_easy_cleanup(curl);
-    ErrorLog("ModularArtManager: Failed downloading art for {} from {}", code,
-             url);
-    ErrorLog("Curl error: ({}) {} ({})", static_cast<int>(res),
-             curl_easy_strerror(res), curl_error_buffer);
-    return false;
+    std::lock_guard<epro::mutex> lck(artIndexMutex);
+    artIndex[code] = ext;
+    return downloadResult::OK;
   }
-}
-
-irr::video::ITexture *ModularArtManager::LoadFromCache(uint32_t code) {
-  auto cachePath = GetCachePath(code);
-
-  if (!Utils::FileExists(cachePath)) {
-    return nullptr;
+  Utils::FileDelete(tempPath);
+  if (res == CURLE_ABORTED_BY_CALLBACK)
+    return downloadResult::ABORTED;
+  if (res == CURLE_HTTP_RETURNED_ERROR) {
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    if (status == 404 || status == 410)
+      return downloadResult::NOT_FOUND;
   }
+  WarningLog("ModularArtManager: Failed downloading art for {} from {}", code,
+           url);
+  WarningLog("Curl error: ({}) {} ({})", static_cast<int>(res),
+           curl_easy_strerror(res), curl_error_buffer);
+  return downloadResult::HOST_ERROR;
+}
 
-  // Generate a unique texture name to avoid conflicts
-  auto textureName = epro::format(EPRO_TEXT("modular_art_{}"), code);
-
-  irr::video::ITexture *texture = driver->getTexture(cachePath.c_str());
-  return texture;
+bool ModularArtManager::AppendToPack(uint32_t code, epro::path_stringview ext,
+                                     const epro::path_string &tempPath) {
+  FileStream file{tempPath, FileStream::in | FileStream::binary};
+  if (file.fail())
+    return false;
+  const std::vector<char> data{std::istreambuf_iterator<char>(file),
+                               std::istreambuf_iterator<char>()};
+  return artPack->Append(code, ext, data.data(),
+                         static_cast<uint32_t>(data.size()));
 }
 
 } // namespace ygo
@@ -2,17 +2,32 @@
 #define MODULAR_ART_MANAGER_H
 
 #include "config.h"
+#include "epro_condition_variable.h"
+#include "epro_mutex.h"
+#include "epro_thread.h"
+#include "modular_art_pack.h"
 #include "text_types.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <irrlicht.h>
+#include <list>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace ygo {
 
 // Art download manager for modular card renderer
 class ModularArtManager {
 public:
+  using ArtCallback = std::function<void(irr::video::ITexture *)>;
+
   ModularArtManager(irr::IrrlichtDevice *device);
   ~ModularArtManager();
 
@@ -20,43 +35,236 @@ public:
   // High-res: https://mdygo2048.daominah.uk/{code}.jpg
   // Standard: https://mdygo.daominah.uk/{code}.jpg
 
-  // Get card art texture (async download if not cached)
+  // Get card art texture if it is already loaded. Never blocks: art on disk
+  // is queued to be decoded on a worker, missing art to be downloaded, and
+  // nullptr is returned until Update uploads it. The texture stays valid
+  // until the next call that can load art (GetCardArt or Update), unless
+  // it's pinned.
   irr::video::ITexture *GetCardArt(uint32_t code, bool preferHighRes = true);
 
+  // Keeps the art of code loaded while a render is using it. Every PinArt
+  // must be matched by an UnpinArt.
+  void PinArt(uint32_t code);
+  void UnpinArt(uint32_t code);
+
+  // Same as GetCardArt, but returns the path of the art on disk instead of
+  // loading a texture, or an empty string while it's not available
+  epro::path_string GetCardArtPath(uint32_t code, bool preferHighRes = true);
+
+  // Same as GetCardArtPath, but a missing art is queued behind the downloads
+  // someone is waiting for
+  epro::path_string PrefetchArt(uint32_t code, bool preferHighRes = true);
+
+  // Path of the art already on disk, or an empty string. Never downloads.
+  epro::path_string GetCachedArtPath(uint32_t code) const;
+
+  // Reader over the art at a path returned by the functions above, which
+  // might be inside the art pack, or nullptr. Any thread, the caller drops
+  // the reader.
+  irr::io::IReadFile *OpenArt(epro::path_stringview path) const;
+
+  // Tells apart art replaced under the same path: the size and last write
+  // time of a loose file, or the size and place in the pack of packed art
+  struct ArtStat {
+    uint64_t size;
+    int64_t mtime;   // 0 for packed art
+    uint64_t offset; // 0 for loose files
+    bool operator==(const ArtStat &other) const {
+      return size == other.size && mtime == other.mtime &&
+             offset == other.offset;
+    }
+  };
+  // False if there's no art at such a path. Any thread.
+  bool GetArtStat(epro::path_stringview path, ArtStat &stat) const;
+
+  // The art at artPath cropped and scaled to the art box of a regular or
+  // pendulum card, see FitModularArt. The result is kept under
+  // {cacheDir}/fitted/, so the original is only resampled once, and made
+  // again if the art changes. Returns an
+  // A8R8G8B8 image the caller drops, or nullptr. Any thread.
+  irr::video::IImage *LoadFittedArt(uint32_t code,
+                                    epro::path_stringview artPath,
+                                    bool pendulum) const;
+
   // Check if art is cached locally
   bool IsArtCached(uint32_t code) const;
 
-  // Download art asynchronously (non-blocking)
-  void DownloadArtAsync(
-      uint32_t code, bool preferHighRes,
-      std::function<void(irr::video::ITexture *)> callback = nullptr);
+  // True while the art of code is being downloaded or decoded
+  bool IsDownloading(uint32_t code);
+
+  // Queue the decode of the art on disk, or its download if there's none,
+  // and invoke callback on the main thread (from Update) with the loaded
+  // texture, or nullptr if it failed. Downloaded art is only decoded and
+  // uploaded if GetCardArt asked for it, otherwise callback gets nullptr
+  // once the file is on disk. Requests for a code already in flight share
+  // the same work. Prefetches go to the back of the queues, the rest to the
+  // front.
+  void DownloadArtAsync(uint32_t code, bool preferHighRes,
+                        ArtCallback callback = nullptr, bool prefetch = false);
+
+  // Main thread: upload the decoded art and run the callbacks
+  void Update();
 
-  // Clear cache
+  // Removes every unpinned art texture from the driver
   void ClearCache();
 
+  // Loaded art textures are kept up to this many bytes, least recently used
+  // first out
+  void SetCacheBudget(size_t budgetBytes);
+
+  struct CacheStats {
+    uint64_t hits;
+    uint64_t misses; // Art that had to be loaded from disk or downloaded
+    uint64_t evictions;
+    size_t usedBytes;
+    size_t budget;
+    size_t entries;
+  };
+  CacheStats GetCacheStats() const;
+
   // Get cache directory
   const epro::path_string &GetCacheDir() const { return cacheDir; }
 
+  // Drops the fitted art made from earlier art of code, to be called when
+  // it's replaced. Also used by -pack-modular-art, without a manager.
+  static void DeleteFittedArt(epro::path_stringview cacheDir, uint32_t code);
+
 private:
+  enum class downloadStatus { DOWNLOADING, DOWNLOAD_ERROR, DOWNLOADED };
+  enum class downloadResult { OK, NOT_FOUND, HOST_ERROR, ABORTED };
+  // The art box depends on whether the card is a pendulum, which is looked up
+  // on the main thread, the card data can be reloaded under the workers
+  struct downloadParam {
+    uint32_t code;
+    bool preferHighRes;
+    bool pendulum;
+  };
+  struct decodeParam {
+    uint32_t code;
+    bool pendulum;
+  };
+  struct decodedArt {
+    uint32_t code;
+    irr::video::IImage *image; // nullptr if the download or decode failed
+    epro::path_string path;
+  };
+  // A host that failed is skipped until retryAt, twice as long after every
+  // consecutive failure
+  struct hostState {
+    uint32_t failures;
+    std::chrono::steady_clock::time_point retryAt;
+  };
+
+  // Art that no mirror has is not asked for again before this long
+  static constexpr int64_t MISSING_ART_TTL = 7 * 24 * 60 * 60;
+  static constexpr std::chrono::seconds HOST_BACKOFF_MIN{30};
+  static constexpr std::chrono::seconds HOST_BACKOFF_MAX{30 * 60};
+
   irr::IrrlichtDevice *device;
   irr::video::IVideoDriver *driver;
 
   // Cache location: pics_modular/{code}.png
   epro::path_string cacheDir;
 
-  // Cached textures
-  std::map<uint32_t, irr::video::ITexture *> artCache;
+  // Downloads go in here instead of loose files when modularArtPack is on.
+  // Loose files are still used if they're there.
+  std::unique_ptr<ModularArtPack> artPack;
+
+  // Extensions of the art files in cacheDir by code, filled once by
+  // indexThread and kept up to date by the downloads, so lookups don't have
+  // to stat the disk. Until the scan is done lookups fall back to stat.
+  std::unordered_map<uint32_t, epro::path_stringview> artIndex;
+  std::atomic<bool> artIndexReady;
+  // ArtStat of the art each fitted file in {cacheDir}/fitted/ was made from,
+  // by pendulum and code. Filled and guarded together with artIndex.
+  mutable std::array<std::unordered_map<uint32_t, ArtStat>, 2> fittedIndex;
+  mutable epro::mutex artIndexMutex;
+  epro::thread indexThread;
+  void IndexThread();
+
+  // Loaded art textures, main thread only. Front is most recently used.
+  struct ArtEntry {
+    uint32_t code;
+    irr::video::ITexture *texture;
+    size_t bytes;
+    uint32_t pins;
+  };
+  using ArtList = std::list<ArtEntry>;
+  ArtList artEntries;
+  std::unordered_map<uint32_t, ArtList::iterator> artCache;
+  size_t artBudget;
+  size_t artBytes;
+  uint64_t artHits;
+  uint64_t artMisses;
+  uint64_t artEvictions;
+
+  // Main thread only: callbacks waiting for a download to finish
+  std::map<uint32_t, std::vector<ArtCallback>> pendingCallbacks;
+
+  // Shared with the download threads, guarded by downloadMutex
+  std::map<uint32_t, downloadStatus> downloads;
+  std::deque<downloadParam> toDownload;
+  std::deque<decodeParam> toDecode;
+  // Codes in flight GetCardArt asked for, the others don't need a texture
+  std::unordered_set<uint32_t> texturesWanted;
+  // Art files that failed to decode, marked DOWNLOAD_ERROR in downloads.
+  // They're decoded again once the file changes.
+  std::unordered_map<uint32_t, ArtStat> badArt;
+  std::deque<decodedArt> finished;
+  std::map<std::string, hostState> hosts;
+  // Codes no mirror has, with the time (seconds since epoch) they can be
+  // tried again. Saved to missingFile on exit.
+  std::unordered_map<uint32_t, int64_t> missingArt;
+  epro::mutex downloadMutex;
+  epro::condition_variable cv;
+  epro::condition_variable decodeCv;
+  std::atomic<bool> stopThreads;
+  std::vector<epro::thread> downloadThreads;
+  // Reads and decodes art files, so the main thread only uploads them
+  epro::thread decodeThread;
+
+  void DownloadThread();
+  void DecodeThread();
 
   // Helper functions
-  epro::path_string GetCachePath(uint32_t code) const;
+  // Path of the art of code in cacheDir, empty if there is none
+  epro::path_string FindCachedArt(uint32_t code) const;
   std::string GetHighResURL(uint32_t code) const;
   std::string GetStandardURL(uint32_t code) const;
+  // Mirrors to try in order, without duplicates
+  std::vector<std::string> GetURLs(uint32_t code, bool preferHighRes) const;
+
+  // Download and save to cache, called from the download threads
+  downloadResult DownloadAndCache(void *curl, uint32_t code,
+                                  const std::string &url);
+
+  // Negative cache, guarded by downloadMutex
+  bool IsArtMissing(uint32_t code) const;
+  void LoadMissingArt();
+  void SaveMissingArt() const;
+  epro::path_string GetMissingArtFile() const;
+
+  // Host backoff, guarded by downloadMutex
+  static std::string GetHost(const std::string &url);
+  bool IsHostAvailable(const std::string &host) const;
+  bool IsAnyHostAvailable(uint32_t code, bool preferHighRes) const;
+  void OnHostResult(const std::string &host, bool reachable);
+
+  // Where the fitted art of code is kept, always a PNG, next to a key with
+  // the ArtStat of the art it was made from
+  static epro::path_string
+  GetFittedArtPath(epro::path_stringview cacheDir, uint32_t code,
+                   bool pendulum, epro::path_stringview ext = EPRO_TEXT(".png"));
+  static bool ReadFittedKey(const epro::path_string &path, ArtStat &stat);
+
+  // Moves a finished download into the art pack
+  bool AppendToPack(uint32_t code, epro::path_stringview ext,
+                    const epro::path_string &tempPath);
 
-  // Download and save to cache
-  bool DownloadAndCache(uint32_t code, const std::string &url);
 
-  // Load from cache
-  irr::video::ITexture *LoadFromCache(uint32_t code);
+  // Adds a freshly loaded texture to the LRU and evicts to stay in budget
+  void CacheArt(uint32_t code, irr::video::ITexture *texture);
+  void EvictArt();
 };
 
 } // namespace ygo
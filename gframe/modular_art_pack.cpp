@@ -0,0 +1,396 @@
+#include "modular_art_pack.h"
+#include "file_stream.h"
+#include "fmt.h"
+#include "logging.h"
+#include "utils.h"
+#include <IFileSystem.h>
+#include <IReadFile.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#if EDOPRO_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ygo {
+
+namespace {
+
+// Both files are written in the byte order of the machine, they're a local
+// cache and never shared between machines
+constexpr char PACK_MAGIC[4] = {'E', 'M', 'A', 'P'};
+constexpr char INDEX_MAGIC[4] = {'E', 'M', 'A', 'I'};
+constexpr uint32_t VERSION = 1;
+
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+};
+
+struct RecordHeader {
+  uint32_t code;
+  uint32_t size;
+  char ext[4];
+};
+static_assert(sizeof(RecordHeader) == 12, "RecordHeader is written as is");
+
+struct IndexHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t packEnd; // The records past this aren't in the index yet
+  uint64_t count;
+};
+
+bool IsArtExtension(const char (&ext)[4]) {
+  return std::memcmp(ext, ".jpg", 4) == 0 || std::memcmp(ext, ".png", 4) == 0;
+}
+
+} // namespace
+
+ModularArtPack::ModularArtPack(irr::io::IFileSystem *filesystem,
+                               epro::path_stringview dir)
+    : filesystem(filesystem), dir(dir),
+      packPath(epro::format(EPRO_TEXT("{}/art.pack"), dir)),
+      indexPath(epro::format(EPRO_TEXT("{}/art.idx"), dir)), packEnd(0),
+      dirty(false), canCreate(false), mapped(nullptr), mappedSize(0) {
+#if EDOPRO_WINDOWS
+  fileHandle = nullptr;
+  mappingHandle = nullptr;
+#endif
+  Map();
+  if (mappedSize < sizeof(FileHeader) ||
+      std::memcmp(mapped, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) {
+    // Missing or not a pack, it's created on the first append. A pack that
+    // exists but couldn't be mapped is left alone.
+    canCreate = mapped || !Utils::FileExists(packPath);
+    if (!canCreate)
+      ErrorLog("ModularArtPack: Failed to map {}",
+               Utils::ToUTF8IfNeeded(packPath));
+    Unmap();
+    return;
+  }
+  if (!LoadIndex()) {
+    entries.clear();
+    packEnd = sizeof(FileHeader);
+    dirty = true;
+  }
+  // Art appended by a session that didn't get to write the index
+  ScanRecords(packEnd);
+}
+
+ModularArtPack::~ModularArtPack() {
+  if (dirty)
+    SaveIndex();
+  Unmap();
+}
+
+void ModularArtPack::Map() {
+#if EDOPRO_WINDOWS
+  HANDLE file = CreateFileW(packPath.data(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return;
+  }
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  const void *view = mapping
+                         ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+                         : nullptr;
+  if (!view) {
+    if (mapping)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    return;
+  }
+  fileHandle = file;
+  mappingHandle = mapping;
+  mapped = static_cast<const char *>(view);
+  mappedSize = static_cast<uint64_t>(size.QuadPart);
+#else
+  const int fd = open(packPath.data(), O_RDONLY);
+  if (fd == -1)
+    return;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return;
+  }
+  void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive on its own
+  close(fd);
+  if (view == MAP_FAILED)
+    return;
+  mapped = static_cast<const char *>(view);
+  mappedSize = static_cast<uint64_t>(info.st_size);
+#endif
+}
+
+void ModularArtPack::Unmap() {
+  if (!mapped)
+    return;
+#if EDOPRO_WINDOWS
+  UnmapViewOfFile(mapped);
+  CloseHandle(mappingHandle);
+  CloseHandle(fileHandle);
+  fileHandle = nullptr;
+  mappingHandle = nullptr;
+#else
+  munmap(const_cast<char *>(mapped), static_cast<size_t>(mappedSize));
+#endif
+  mapped = nullptr;
+  mappedSize = 0;
+}
+
+bool ModularArtPack::LoadIndex() {
+  FileStream file{indexPath, FileStream::in | FileStream::binary};
+  if (file.fail())
+    return false;
+  IndexHeader header;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+      header.version != VERSION || header.packEnd > mappedSize ||
+      header.packEnd < sizeof(FileHeader))
+    return false;
+  entries.resize(static_cast<size_t>(header.count));
+  if (!file.read(reinterpret_cast<char *>(entries.data()),
+                 static_cast<std::streamsize>(entries.size() * sizeof(Entry))))
+    return false;
+  for (const auto &entry : entries) {
+    if (entry.offset + entry.size > header.packEnd)
+      return false;
+  }
+  packEnd = header.packEnd;
+  return true;
+}
+
+void ModularArtPack::ScanRecords(uint64_t from) {
+  // Stops at the first record that doesn't make sense, e.g. one cut short by
+  // a crash. The next append overwrites it.
+  uint64_t offset = from;
+  while (offset + sizeof(RecordHeader) <= mappedSize) {
+    RecordHeader header;
+    std::memcpy(&header, mapped + offset, sizeof(header));
+    const uint64_t dataOffset = offset + sizeof(RecordHeader);
+    if (!IsArtExtension(header.ext) || dataOffset + header.size > mappedSize)
+      break;
+    Entry entry{header.code, header.size, dataOffset, {}, 0};
+    std::memcpy(entry.ext, header.ext, sizeof(entry.ext));
+    Insert(entry);
+    offset = dataOffset + header.size;
+    dirty = true;
+  }
+  packEnd = offset;
+}
+
+void ModularArtPack::SaveIndex() {
+  const auto tmpPath = indexPath + EPRO_TEXT(".tmp");
+  {
+    FileStream file{tmpPath,
+                    FileStream::out | FileStream::trunc | FileStream::binary};
+    if (file.fail())
+      return;
+    IndexHeader header{{}, VERSION, packEnd, entries.size()};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()),
+               static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+    if (!file.good()) {
+      file.close();
+      Utils::FileDelete(tmpPath);
+      return;
+    }
+  }
+  // FileMove doesn't replace an existing file on Windows
+  Utils::FileDelete(indexPath);
+  if (Utils::FileMove(tmpPath, indexPath))
+    dirty = false;
+}
+
+void ModularArtPack::Insert(const Entry &entry) {
+  auto it = std::lower_bound(
+      entries.begin(), entries.end(), entry.code,
+      [](const Entry &a, uint32_t code) { return a.code < code; });
+  if (it != entries.end() && it->code == entry.code)
+    *it = entry;
+  else
+    entries.insert(it, entry);
+}
+
+const ModularArtPack::Entry *ModularArtPack::Find(uint32_t code) const {
+  auto it = std::lower_bound(
+      entries.begin(), entries.end(), code,
+      [](const Entry &a, uint32_t code) { return a.code < code; });
+  if (it == entries.end() || it->code != code)
+    return nullptr;
+  return &*it;
+}
+
+bool ModularArtPack::Contains(uint32_t code) const {
+  std::lock_guard<epro::mutex> lck(mutex);
+  return Find(code) != nullptr;
+}
+
+epro::path_string ModularArtPack::GetPath(uint32_t code) const {
+  std::lock_guard<epro::mutex> lck(mutex);
+  const Entry *entry = Find(code);
+  if (!entry)
+    return {};
+  const epro::path_string ext(entry->ext, entry->ext + sizeof(entry->ext));
+  return epro::format(EPRO_TEXT("{}/{}{}"), packPath, code, ext);
+}
+
+bool ModularArtPack::GetEntry(uint32_t code, uint64_t &offset,
+                              uint32_t &size) const {
+  std::lock_guard<epro::mutex> lck(mutex);
+  const Entry *entry = Find(code);
+  if (!entry)
+    return false;
+  offset = entry->offset;
+  size = entry->size;
+  return true;
+}
+
+uint32_t ModularArtPack::GetCode(epro::path_stringview path) const {
+  if (path.size() <= packPath.size() + 1 ||
+      path.compare(0, packPath.size(), packPath) != 0 ||
+      path[packPath.size()] != EPRO_TEXT('/'))
+    return 0;
+  uint32_t code = 0;
+  for (size_t i = packPath.size() + 1;
+       i < path.size() && path[i] != EPRO_TEXT('.'); ++i) {
+    if (path[i] < EPRO_TEXT('0') || path[i] > EPRO_TEXT('9'))
+      return 0;
+    code = code * 10 + static_cast<uint32_t>(path[i] - EPRO_TEXT('0'));
+  }
+  return code;
+}
+
+bool ModularArtPack::Read(const Entry &entry, char *out) const {
+  if (entry.offset + entry.size <= mappedSize) {
+    std::memcpy(out, mapped + entry.offset, entry.size);
+    return true;
+  }
+  FileStream file{packPath, FileStream::in | FileStream::binary};
+  return file.seekg(static_cast<std::streamoff>(entry.offset)) &&
+         file.read(out, entry.size);
+}
+
+irr::io::IReadFile *ModularArtPack::Open(uint32_t code) {
+  if (!filesystem)
+    return nullptr;
+  Entry entry;
+  {
+    std::lock_guard<epro::mutex> lck(mutex);
+    const Entry *found = Find(code);
+    if (!found)
+      return nullptr;
+    entry = *found;
+  }
+  const epro::path_string ext(entry.ext, entry.ext + sizeof(entry.ext));
+  const auto name = epro::format(EPRO_TEXT("{}/{}{}"), packPath, code, ext);
+  const irr::io::path irrName{name.data(), static_cast<irr::u32>(name.size())};
+  if (entry.offset + entry.size <= mappedSize) {
+    // Straight from the map, nothing is copied. The mapping outlives every
+    // reader, the pack is closed after the threads reading art are done.
+    return filesystem->createMemoryReadFile(
+        const_cast<char *>(mapped + entry.offset),
+        static_cast<irr::s32>(entry.size), irrName, false);
+  }
+  // Appended this session, past the end of the map
+  auto buffer = std::make_unique<irr::c8[]>(entry.size);
+  if (!Read(entry, buffer.get()))
+    return nullptr;
+  auto *file = filesystem->createMemoryReadFile(
+      buffer.get(), static_cast<irr::s32>(entry.size), irrName, true);
+  if (file)
+    buffer.release();
+  return file;
+}
+
+bool ModularArtPack::Append(uint32_t code, epro::path_stringview ext,
+                            const char *data, uint32_t size) {
+  RecordHeader header{code, size, {}};
+  if (ext.size() != sizeof(header.ext))
+    return false;
+  for (size_t i = 0; i < sizeof(header.ext); ++i)
+    header.ext[i] = static_cast<char>(ext[i]);
+  if (!IsArtExtension(header.ext))
+    return false;
+
+  std::lock_guard<epro::mutex> lck(mutex);
+  if (packEnd == 0) {
+    if (!canCreate)
+      return false;
+    FileStream file{packPath,
+                    FileStream::out | FileStream::trunc | FileStream::binary};
+    FileHeader fileHeader{{}, VERSION};
+    std::memcpy(fileHeader.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    if (!file.write(reinterpret_cast<const char *>(&fileHeader),
+                    sizeof(fileHeader)))
+      return false;
+    packEnd = sizeof(FileHeader);
+  }
+  FileStream file{packPath,
+                  FileStream::in | FileStream::out | FileStream::binary};
+  // Written after the last valid record, over whatever a crash left there
+  if (!file.seekp(static_cast<std::streamoff>(packEnd)) ||
+      !file.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+      !file.write(data, size) || !file.flush())
+    return false;
+  Entry entry{code, size, packEnd + sizeof(RecordHeader), {}, 0};
+  std::memcpy(entry.ext, header.ext, sizeof(entry.ext));
+  Insert(entry);
+  packEnd = entry.offset + size;
+  dirty = true;
+  return true;
+}
+
+bool ModularArtPack::Compact(epro::path_stringview dir) {
+  const auto tmpDir = epro::format(EPRO_TEXT("{}/compact.tmp"), dir);
+  Utils::DeleteDirectory(tmpDir + EPRO_TEXT("/"));
+  if (!Utils::MakeDirectory(tmpDir))
+    return false;
+  bool success = true;
+  bool empty;
+  {
+    ModularArtPack source(nullptr, dir);
+    ModularArtPack target(nullptr, tmpDir);
+    empty = source.entries.empty();
+    std::vector<char> buffer;
+    for (const auto &entry : source.entries) {
+      buffer.resize(entry.size);
+      const epro::path_string ext(entry.ext, entry.ext + sizeof(entry.ext));
+      if (!source.Read(entry, buffer.data()) ||
+          !target.Append(entry.code, ext, buffer.data(), entry.size)) {
+        ErrorLog("ModularArtPack: Failed to copy the art of {}", entry.code);
+        success = false;
+        break;
+      }
+    }
+  }
+  if (success && !empty) {
+    const auto packPath = epro::format(EPRO_TEXT("{}/art.pack"), dir);
+    const auto indexPath = epro::format(EPRO_TEXT("{}/art.idx"), dir);
+    // FileMove doesn't replace an existing file on Windows
+    Utils::FileDelete(packPath);
+    Utils::FileDelete(indexPath);
+    success = Utils::FileMove(tmpDir + EPRO_TEXT("/art.pack"), packPath) &&
+              Utils::FileMove(tmpDir + EPRO_TEXT("/art.idx"), indexPath);
+  }
+  Utils::DeleteDirectory(tmpDir + EPRO_TEXT("/"));
+  return success;
+}
+
+} // namespace ygo
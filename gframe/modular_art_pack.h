@@ -0,0 +1,99 @@
+#ifndef MODULAR_ART_PACK_H
+#define MODULAR_ART_PACK_H
+
+#include "config.h"
+#include "epro_mutex.h"
+#include "text_types.h"
+#include <cstdint>
+#include <vector>
+
+namespace irr {
+namespace io {
+class IFileSystem;
+class IReadFile;
+} // namespace io
+} // namespace irr
+
+namespace ygo {
+
+// Modular card art of every card in a single file instead of one file per
+// card. Art is appended to {dir}/art.pack as it's downloaded, and found
+// through {dir}/art.idx, a table of where the latest art of every code
+// starts, sorted by code and rewritten when the pack is closed. The data
+// present when the pack is opened is memory mapped, so reading art opens no
+// file. Art appended since is read from the pack file.
+//
+// Art in the pack is named by a path below {dir}/art.pack/, see GetPath, so
+// it can be handed around like the loose files.
+class ModularArtPack {
+public:
+  // filesystem creates the readers returned by Open, it can be null when
+  // the pack is only written to
+  ModularArtPack(irr::io::IFileSystem *filesystem, epro::path_stringview dir);
+  ~ModularArtPack();
+
+  bool Contains(uint32_t code) const;
+  // Path standing for the art of code, empty if it's not in the pack
+  epro::path_string GetPath(uint32_t code) const;
+  // Code of a path returned by GetPath, 0 if path isn't in the pack
+  uint32_t GetCode(epro::path_stringview path) const;
+  // Where the art of code starts in the pack and its size, false if it's not
+  // in the pack. Replacing the art appends it, so the offset changes too.
+  bool GetEntry(uint32_t code, uint64_t &offset, uint32_t &size) const;
+
+  // Reader over the art of code, named by its path so Irrlicht picks the
+  // loader from its extension, or nullptr. Any thread.
+  irr::io::IReadFile *Open(uint32_t code);
+
+  // Adds the art of code, replacing any earlier one. ext is ".jpg" or
+  // ".png". Any thread.
+  bool Append(uint32_t code, epro::path_stringview ext, const char *data,
+              uint32_t size);
+
+  // Rewrites the pack in dir with only the latest art of every code, in
+  // code order. The pack must not be open anywhere else.
+  static bool Compact(epro::path_stringview dir);
+
+private:
+  struct Entry {
+    uint32_t code;
+    uint32_t size;
+    uint64_t offset; // Of the data, past the record header
+    char ext[4];
+    uint32_t padding;
+  };
+  static_assert(sizeof(Entry) == 24, "Entry is written as is to the index");
+
+  irr::io::IFileSystem *filesystem;
+  epro::path_string dir;
+  epro::path_string packPath;
+  epro::path_string indexPath;
+
+  mutable epro::mutex mutex;
+  std::vector<Entry> entries; // Sorted by code
+  uint64_t packEnd;           // End of the last valid record
+  bool dirty;
+  bool canCreate; // No pack to preserve at packPath
+
+  // Read-only view of the pack as it was when opened
+  const char *mapped;
+  uint64_t mappedSize;
+#if EDOPRO_WINDOWS
+  void *fileHandle;
+  void *mappingHandle;
+#endif
+
+  void Map();
+  void Unmap();
+  bool LoadIndex();
+  void ScanRecords(uint64_t from);
+  void SaveIndex();
+  void Insert(const Entry &entry);
+  const Entry *Find(uint32_t code) const;
+  // Copies the data of entry, from the map or the file
+  bool Read(const Entry &entry, char *out) const;
+};
+
+} // namespace ygo
+
+#endif // MODULAR_ART_PACK_H
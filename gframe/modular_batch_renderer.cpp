@@ -0,0 +1,475 @@
+#include "modular_batch_renderer.h"
+
+#include "config.h"
+#include "data_manager.h"
+#include "epro_mutex.h"
+#include "epro_thread.h"
+#include "file_stream.h"
+#include "fmt.h"
+#include "game_config.h"
+#include "logging.h"
+#include "modular_art_manager.h"
+#include "modular_art_pack.h"
+#include "modular_card_canvas.h"
+#include "modular_card_renderer.h"
+#include "text_types.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <IImage.h>
+#include <IVideoDriver.h>
+#include <IrrlichtDevice.h>
+#include <irrlicht.h>
+
+using namespace ygo;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Stage { DATA, ART, COMPOSE, ENCODE, STAGE_COUNT };
+constexpr std::array<const char *, STAGE_COUNT> STAGE_NAMES{
+    "data", "art", "compose", "encode"};
+
+// Kept per worker and merged once they're all done
+struct Stats {
+  std::array<Clock::duration, STAGE_COUNT> total{};
+  std::array<Clock::duration, STAGE_COUNT> max{};
+  size_t rendered = 0;
+  size_t withoutArt = 0;
+  std::vector<std::pair<uint32_t, std::string>> failures;
+
+  void Add(Stage stage, Clock::duration time) {
+    total[stage] += time;
+    max[stage] = std::max(max[stage], time);
+  }
+  void Merge(const Stats &other) {
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+      total[i] += other.total[i];
+      max[i] = std::max(max[i], other.max[i]);
+    }
+    rendered += other.rendered;
+    withoutArt += other.withoutArt;
+    failures.insert(failures.end(), other.failures.begin(),
+                    other.failures.end());
+  }
+};
+
+double ToMs(Clock::duration time) {
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+// Same databases the client loads on startup
+void LoadDatabases(DataManager &dataManager) {
+  if (Utils::FileExists(EPRO_TEXT("./cards.cdb")))
+    dataManager.LoadDB(EPRO_TEXT("./cards.cdb"));
+  for (auto &file :
+       Utils::FindFiles(EPRO_TEXT("./expansions/"), {EPRO_TEXT("cdb")}, 2))
+    dataManager.LoadDB(epro::format(EPRO_TEXT("./expansions/{}"), file));
+}
+
+// The textures and fonts are looked up relative to the game folder
+bool EnterWorkingDirectory(const args_t &args) {
+  const auto &workdir = args[LAUNCH_PARAM::WORK_DIR];
+  const epro::path_stringview dest =
+      workdir.enabled ? workdir.argument : Utils::GetExeFolder();
+  if (Utils::SetWorkingDirectory(dest))
+    return true;
+  epro::print("failed to change directory to: {} ({})\n",
+              Utils::ToUTF8IfNeeded(dest), Utils::GetLastErrorString());
+  return false;
+}
+
+// Everything is composited in software, the null driver only has to decode
+// and encode images, and doesn't open a window
+irr::IrrlichtDevice *CreateHeadlessDevice() {
+  irr::SIrrlichtCreationParameters params{};
+  params.DriverType = irr::video::EDT_NULL;
+  irr::IrrlichtDevice *device = irr::createDeviceEx(params);
+  if (!device) {
+    epro::print("Failed to create the Irrlicht device!\n");
+    return nullptr;
+  }
+  device->getLogger()->setLogLevel(irr::ELL_ERROR);
+  return device;
+}
+
+// Cards that stress the layout: the longest texts, every link arrow, the most
+// stars and names that have to be squeezed
+std::vector<ModularCardData> GetBenchmarkCorpus() {
+  const std::wstring longEffect =
+      L"If this card is Normal or Special Summoned: You can target up to 3 "
+      L"cards on the field; destroy them, and if you do, inflict 500 damage "
+      L"to your opponent for each card destroyed this way. During your "
+      L"opponent's turn (Quick Effect): You can banish this card from your "
+      L"GY; Special Summon 1 \"Benchmark\" monster from your hand or Deck, "
+      L"but negate its effects, also it cannot attack this turn. If this card "
+      L"in its owner's possession is destroyed by an opponent's card: You "
+      L"can add 1 Spell/Trap from your Deck to your hand. You can only use "
+      L"each effect of \"Benchmark Dragon\" once per turn.\n\u2022 Once "
+      L"per Chain, when a card or effect is activated that includes any of "
+      L"these effects, you can negate that activation.";
+  std::vector<ModularCardData> corpus;
+
+  ModularCardData pendulum;
+  pendulum.cardName = L"Benchmark Pendulum Magician of Endless Scales";
+  pendulum.cardSubtype = CardSubtype::MONSTER_EFFECT;
+  pendulum.monsterAttribute = MonsterAttribute::DARK;
+  pendulum.monsterTypeLine = L"[Spellcaster/Pendulum/Effect]";
+  pendulum.monsterLevelRankLink = 7;
+  pendulum.isPendulum = true;
+  pendulum.pendulumScale = 13;
+  pendulum.pendulumEffect = longEffect.substr(0, longEffect.size() / 2);
+  pendulum.cardEffect = longEffect;
+  corpus.push_back(pendulum);
+
+  ModularCardData link;
+  link.cardName = L"Benchmark Link Dragon";
+  link.cardSubtype = CardSubtype::MONSTER_LINK;
+  link.monsterAttribute = MonsterAttribute::LIGHT;
+  link.monsterTypeLine = L"[Cyberse/Link/Effect]";
+  link.monsterLevelRankLink = 8;
+  link.monsterDEFStr = L"-";
+  link.linkArrows = {LinkArrow::UP_LEFT,   LinkArrow::UP,
+                     LinkArrow::UP_RIGHT,  LinkArrow::LEFT,
+                     LinkArrow::RIGHT,     LinkArrow::DOWN_LEFT,
+                     LinkArrow::DOWN,      LinkArrow::DOWN_RIGHT};
+  link.cardEffect = longEffect;
+  corpus.push_back(link);
+
+  ModularCardData xyz;
+  xyz.cardName = L"Number C1000: Benchmark Xyz Emperor";
+  xyz.cardSubtype = CardSubtype::MONSTER_XYZ;
+  xyz.monsterAttribute = MonsterAttribute::WIND;
+  xyz.monsterTypeLine = L"[Winged Beast/Xyz/Effect]";
+  xyz.monsterLevelRankLink = 13;
+  xyz.cardEffect = L"3+ Level 12 monsters\n" + longEffect;
+  corpus.push_back(xyz);
+
+  ModularCardData longName;
+  longName.cardName = L"Ultimate Benchmark Dragon of the Extraordinarily "
+                      L"Long Name That Never Ends";
+  longName.cardSubtype = CardSubtype::MONSTER_SYNCHRO;
+  longName.monsterAttribute = MonsterAttribute::FIRE;
+  longName.monsterTypeLine = L"[Dragon/Synchro/Tuner/Effect]";
+  longName.monsterLevelRankLink = 12;
+  longName.monsterATKStr = L"?";
+  longName.cardEffect = longEffect;
+  corpus.push_back(longName);
+
+  ModularCardData normal;
+  normal.cardName = L"Benchmark Flavor Beast";
+  normal.cardSubtype = CardSubtype::MONSTER_NORMAL;
+  normal.monsterAttribute = MonsterAttribute::EARTH;
+  normal.monsterTypeLine = L"[Beast/Normal]";
+  normal.monsterLevelRankLink = 12;
+  normal.isNormalMonster = true;
+  normal.cardEffect = longEffect;
+  corpus.push_back(normal);
+
+  ModularCardData spell;
+  spell.cardName = L"Benchmark Quick Spell";
+  spell.cardType = CardType::SPELL;
+  spell.cardSubtype = CardSubtype::SPELL_QUICKPLAY;
+  spell.cardEffect = longEffect;
+  corpus.push_back(spell);
+
+  ModularCardData trap;
+  trap.cardName = L"Benchmark Counter Trap";
+  trap.cardType = CardType::TRAP;
+  trap.cardSubtype = CardSubtype::TRAP_COUNTER;
+  trap.cardEffect = longEffect;
+  corpus.push_back(trap);
+
+  uint32_t id = 10000001;
+  for (auto &card : corpus) {
+    card.cardId = id++;
+    card.monsterType = L"Benchmark";
+  }
+  return corpus;
+}
+
+} // namespace
+
+int modular_batch_renderer_main(const args_t &args) {
+  if (!EnterWorkingDirectory(args))
+    return EXIT_FAILURE;
+  const auto &output = args[LAUNCH_PARAM::RENDER_MODULAR_CARDS];
+  const epro::path_string outputDir =
+      output.argument.empty() ? EPRO_TEXT("./pics_modular/export/")
+                              : epro::path_string{output.argument};
+  if (!Utils::MakeDirectory(outputDir)) {
+    epro::print("failed to create the output folder {}\n",
+                Utils::ToUTF8IfNeeded(outputDir));
+    return EXIT_FAILURE;
+  }
+
+  auto configs = std::make_unique<GameConfig>();
+  gGameConfig = configs.get();
+  auto dataManager = std::make_unique<DataManager>();
+  gDataManager = dataManager.get();
+  auto stringsLoaded =
+      dataManager->LoadStrings(EPRO_TEXT("./config/strings.conf"));
+  stringsLoaded =
+      dataManager->LoadStrings(EPRO_TEXT("./expansions/strings.conf")) ||
+      stringsLoaded;
+  if (!stringsLoaded) {
+    epro::print("Failed to load strings!\n");
+    return EXIT_FAILURE;
+  }
+  LoadDatabases(*dataManager);
+
+  irr::IrrlichtDevice *device = CreateHeadlessDevice();
+  if (!device)
+    return EXIT_FAILURE;
+  irr::video::IVideoDriver *driver = device->getVideoDriver();
+
+  std::vector<uint32_t> codes;
+  codes.reserve(dataManager->cards.size());
+  for (const auto &card : dataManager->cards)
+    codes.push_back(card.first);
+  std::sort(codes.begin(), codes.end());
+
+  Stats stats;
+  Clock::duration elapsed;
+  std::string layoutTable;
+  {
+    ModularCardRenderer renderer(device);
+    ModularArtManager artManager(device);
+    ModularSoftwareAssets assets(driver);
+    const irr::core::dimension2du size{ModularCardRenderer::BASE_WIDTH,
+                                       ModularCardRenderer::BASE_HEIGHT};
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    epro::mutex statsMutex;
+    auto work = [&] {
+      Utils::SetThreadName("ModularBatch");
+      ModularGlyphRasterizer glyphs(assets);
+      Stats local;
+      size_t i;
+      while ((i = next++) < codes.size()) {
+        const uint32_t code = codes[i];
+        auto start = Clock::now();
+        auto lap = [&](Stage stage) {
+          const auto now = Clock::now();
+          local.Add(stage, now - start);
+          start = now;
+        };
+        try {
+          const ModularCardData card = ConvertToModularData(code);
+          lap(DATA);
+
+          // Only art that was already downloaded, a missing one is drawn
+          // with the placeholder like in the client
+          irr::video::IImage *art = nullptr;
+          const auto artPath = artManager.GetCachedArtPath(code);
+          if (!artPath.empty())
+            art = artManager.LoadFittedArt(code, artPath, card.isPendulum);
+          if (!art)
+            ++local.withoutArt;
+          lap(ART);
+
+          irr::video::IImage *image =
+              driver->createImage(irr::video::ECF_A8R8G8B8, size);
+          image->fill(irr::video::SColor(0, 0, 0, 0));
+          {
+            ModularSoftwareCanvas canvas(image, art, assets, glyphs);
+            renderer.Compose(canvas, card);
+          }
+          if (art)
+            art->drop();
+          lap(COMPOSE);
+
+          const auto path = epro::format(EPRO_TEXT("{}/{}.png"), outputDir,
+                                         code);
+          const bool written = driver->writeImageToFile(
+              image, {path.data(), static_cast<irr::u32>(path.size())});
+          image->drop();
+          lap(ENCODE);
+          if (written)
+            ++local.rendered;
+          else
+            local.failures.emplace_back(code, "couldn't write the image");
+        } catch (const std::exception &e) {
+          local.failures.emplace_back(code, e.what());
+        }
+        ++done;
+      }
+      std::lock_guard<epro::mutex> lck(statsMutex);
+      stats.Merge(local);
+    };
+
+    const size_t threadCount =
+        std::max<size_t>(epro::thread::hardware_concurrency(), 1);
+    epro::print("Rendering {} cards into {} with {} threads\n", codes.size(),
+                Utils::ToUTF8IfNeeded(outputDir), threadCount);
+    std::fflush(stdout);
+    const auto start = Clock::now();
+    std::vector<epro::thread> threads;
+    threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+      threads.emplace_back(work);
+    while (done < codes.size()) {
+      epro::this_thread::sleep_for(std::chrono::seconds(1));
+      epro::print("{}/{}\n", done.load(), codes.size());
+      std::fflush(stdout);
+    }
+    for (auto &thread : threads)
+      thread.join();
+    elapsed = Clock::now() - start;
+    layoutTable = renderer.GetStats().FormatTable();
+  }
+  device->drop();
+
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  epro::print("Rendered {} of {} cards in {:.1f}s, {:.1f} cards/s\n",
+              stats.rendered, codes.size(), seconds,
+              seconds > 0 ? stats.rendered / seconds : 0.0);
+  if (stats.withoutArt > 0)
+    epro::print("{} cards had no downloaded art\n", stats.withoutArt);
+  // Stage times are summed over every thread, so the means are per card on a
+  // single core
+  const size_t attempted = std::max<size_t>(codes.size(), 1);
+  for (int i = 0; i < STAGE_COUNT; ++i)
+    epro::print("  {:<8} mean {:8.2f}ms  max {:8.2f}ms\n", STAGE_NAMES[i],
+                ToMs(stats.total[i]) / attempted, ToMs(stats.max[i]));
+  epro::print("Layout stages over the last {} cards:\n{}",
+              ModularRenderStats::WINDOW, layoutTable);
+  if (stats.failures.empty())
+    return EXIT_SUCCESS;
+  std::sort(stats.failures.begin(), stats.failures.end());
+  epro::print("{} cards failed:\n", stats.failures.size());
+  for (const auto &failure : stats.failures)
+    epro::print("  {}: {}\n", failure.first, failure.second);
+  return EXIT_FAILURE;
+}
+
+int modular_benchmark_main(const args_t &args) {
+  if (!EnterWorkingDirectory(args))
+    return EXIT_FAILURE;
+  int iterations = 20;
+  const auto &count = args[LAUNCH_PARAM::BENCHMARK_MODULAR_CARDS].argument;
+  if (!count.empty()) {
+    try {
+      iterations = std::stoi(epro::path_string{count});
+    } catch (...) {
+    }
+  }
+  iterations = std::max(iterations, 1);
+
+  auto configs = std::make_unique<GameConfig>();
+  gGameConfig = configs.get();
+  irr::IrrlichtDevice *device = CreateHeadlessDevice();
+  if (!device)
+    return EXIT_FAILURE;
+  irr::video::IVideoDriver *driver = device->getVideoDriver();
+
+  const auto corpus = GetBenchmarkCorpus();
+  std::string table;
+  Clock::duration elapsed;
+  {
+    ModularCardRenderer renderer(device);
+    ModularSoftwareAssets assets(driver);
+    ModularGlyphRasterizer glyphs(assets);
+    const irr::core::dimension2du size{ModularCardRenderer::BASE_WIDTH,
+                                       ModularCardRenderer::BASE_HEIGHT};
+    irr::video::IImage *image =
+        driver->createImage(irr::video::ECF_A8R8G8B8, size);
+    auto render = [&](const ModularCardData &card) {
+      image->fill(irr::video::SColor(0, 0, 0, 0));
+      ModularSoftwareCanvas canvas(image, nullptr, assets, glyphs);
+      renderer.Compose(canvas, card);
+    };
+    // The first pass loads the textures and fonts, don't count it
+    for (const auto &card : corpus)
+      render(card);
+    renderer.GetStats().Reset();
+
+    // Every pass uses new card ids, so the effect text is laid out again
+    // rather than found in the layout cache
+    auto cards = corpus;
+    const auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (auto &card : cards) {
+        card.cardId += static_cast<uint32_t>(corpus.size());
+        render(card);
+      }
+    }
+    elapsed = Clock::now() - start;
+    image->drop();
+    table = renderer.GetStats().FormatTable();
+  }
+  device->drop();
+
+  const size_t rendered = corpus.size() * iterations;
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  epro::print("Rendered {} cards ({} x {}) on one thread in {:.2f}s, "
+              "{:.1f} cards/s\n{}",
+              rendered, corpus.size(), iterations, seconds,
+              seconds > 0 ? rendered / seconds : 0.0, table);
+  return EXIT_SUCCESS;
+}
+
+int modular_art_pack_main(const args_t &args) {
+  if (!EnterWorkingDirectory(args))
+    return EXIT_FAILURE;
+  const epro::path_string dir{EPRO_TEXT("pics_modular")};
+  size_t imported = 0;
+  std::vector<epro::path_string> failures;
+  {
+    ModularArtPack pack(nullptr, dir);
+    for (const auto &file :
+         Utils::FindFiles(dir, {EPRO_TEXT("jpg"), EPRO_TEXT("png")})) {
+      // Only the art downloaded by the client, named {code}.jpg or .png
+      const auto dot = file.rfind(EPRO_TEXT('.'));
+      uint32_t code = 0;
+      try {
+        size_t end = 0;
+        code = static_cast<uint32_t>(std::stoul(file.substr(0, dot), &end));
+        if (end != dot)
+          continue;
+      } catch (...) {
+        continue;
+      }
+      const auto path = epro::format(EPRO_TEXT("{}/{}"), dir, file);
+      std::vector<char> data;
+      {
+        FileStream stream{path, FileStream::in | FileStream::binary};
+        if (!stream.fail())
+          data.assign(std::istreambuf_iterator<char>(stream),
+                      std::istreambuf_iterator<char>());
+      }
+      if (data.empty() ||
+          !pack.Append(code, epro::path_stringview{file}.substr(dot),
+                       data.data(), static_cast<uint32_t>(data.size()))) {
+        failures.push_back(file);
+        continue;
+      }
+      Utils::FileDelete(path);
+      // It can replace art already in the pack, refit it from the new one
+      ModularArtManager::DeleteFittedArt(dir, code);
+      ++imported;
+    }
+  }
+  if (!ModularArtPack::Compact(dir)) {
+    epro::print("Failed to compact {}/art.pack\n", Utils::ToUTF8IfNeeded(dir));
+    return EXIT_FAILURE;
+  }
+  epro::print("Packed {} loose art files, {} failed\n", imported,
+              failures.size());
+  for (const auto &file : failures)
+    epro::print("  {}\n", Utils::ToUTF8IfNeeded(file));
+  return failures.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
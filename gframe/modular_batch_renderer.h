@@ -0,0 +1,21 @@
+#ifndef MODULAR_BATCH_RENDERER_H
+#define MODULAR_BATCH_RENDERER_H
+#include "cli_args.h"
+
+// Headless mode started with -render-modular-cards [output folder]. Renders
+// every card in the databases with the modular renderer into PNGs on all
+// cores, without opening a window, then prints the throughput, the time
+// spent in every stage and the cards that failed.
+int modular_batch_renderer_main(const args_t& args);
+
+// Headless mode started with -benchmark-modular-cards [iterations]. Renders a
+// fixed set of cards that stress the layout on one thread, and prints the
+// timings of every stage so regressions show up as numbers.
+int modular_benchmark_main(const args_t& args);
+
+// Headless mode started with -pack-modular-art. Moves the loose art files in
+// pics_modular into pics_modular/art.pack, then rewrites the pack without
+// the art that was replaced since.
+int modular_art_pack_main(const args_t& args);
+
+#endif //MODULAR_BATCH_RENDERER_H
@@ -0,0 +1,139 @@
+#include "modular_card_cache.h"
+#include "fmt.h"
+#include <ITexture.h>
+#include <IVideoDriver.h>
+
+namespace ygo {
+
+ModularCardCache::ModularCardCache(irr::video::IVideoDriver *driver,
+                                   size_t budgetBytes)
+    : driver(driver), budget(budgetBytes), usedBytes(0), hasPinned(false),
+      pinned{} {}
+
+ModularCardCache::~ModularCardCache() { Clear(); }
+
+size_t ModularCardCache::TextureBytes(const irr::core::dimension2du &size) {
+  // 4 bytes per texel plus roughly a third more for the mip chain
+  const size_t base = static_cast<size_t>(size.Width) * size.Height * 4;
+  return base + base / 3;
+}
+
+irr::video::ITexture *
+ModularCardCache::Find(const ModularCardCacheKey &key) {
+  auto it = index.find(key);
+  if (it == index.end())
+    return nullptr;
+  // Move to the front of the LRU list
+  entries.splice(entries.begin(), entries, it->second);
+  return it->second->texture;
+}
+
+irr::video::ITexture *
+ModularCardCache::Acquire(const ModularCardCacheKey &key,
+                          const irr::core::dimension2du &size) {
+  const size_t bytes = TextureBytes(size);
+  if (bytes > budget)
+    return nullptr;
+
+  auto existing = index.find(key);
+  if (existing != index.end()) {
+    entries.splice(entries.begin(), entries, existing->second);
+    return existing->second->texture;
+  }
+
+  irr::video::ITexture *texture = EvictFor(bytes, size);
+  if (!texture) {
+    // Same mipmap setup as the renderer's shared target so the cached cards
+    // scale down just as smoothly
+    const bool prevMipMap =
+        driver->getTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS);
+    driver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS, true);
+    const auto name = epro::format("ModularCardCache_{}_{}_{}", key.code,
+                                   key.artVersion, key.settings);
+    texture = driver->addRenderTargetTexture(
+        size, {name.data(), static_cast<irr::u32>(name.size())},
+        irr::video::ECF_A8R8G8B8);
+    driver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS,
+                                   prevMipMap);
+    if (!texture)
+      return nullptr;
+  }
+
+  entries.push_front(Entry{key, texture, bytes});
+  index[key] = entries.begin();
+  usedBytes += bytes;
+  return texture;
+}
+
+void ModularCardCache::Insert(const ModularCardCacheKey &key,
+                              irr::video::ITexture *texture) {
+  auto existing = index.find(key);
+  if (existing != index.end()) {
+    // Composited twice, the cached one might be on display
+    entries.splice(entries.begin(), entries, existing->second);
+    driver->removeTexture(texture);
+    return;
+  }
+  const size_t bytes = TextureBytes(texture->getSize());
+  if (auto *spare = EvictFor(bytes, {}))
+    driver->removeTexture(spare);
+  entries.push_front(Entry{key, texture, bytes});
+  index[key] = entries.begin();
+  usedBytes += bytes;
+}
+
+void ModularCardCache::Erase(const ModularCardCacheKey &key) {
+  auto it = index.find(key);
+  if (it == index.end())
+    return;
+  if (hasPinned && pinned == key)
+    hasPinned = false;
+  usedBytes -= it->second->bytes;
+  driver->removeTexture(it->second->texture);
+  entries.erase(it->second);
+  index.erase(it);
+}
+
+void ModularCardCache::Pin(const ModularCardCacheKey &key) {
+  hasPinned = true;
+  pinned = key;
+}
+
+void ModularCardCache::Unpin() { hasPinned = false; }
+
+void ModularCardCache::Clear() {
+  for (auto &entry : entries)
+    driver->removeTexture(entry.texture);
+  entries.clear();
+  index.clear();
+  usedBytes = 0;
+  hasPinned = false;
+}
+
+void ModularCardCache::SetBudget(size_t budgetBytes) {
+  budget = budgetBytes;
+  if (auto *spare = EvictFor(0, {}))
+    driver->removeTexture(spare);
+}
+
+irr::video::ITexture *
+ModularCardCache::EvictFor(size_t incoming,
+                           const irr::core::dimension2du &size) {
+  irr::video::ITexture *reusable = nullptr;
+  auto it = entries.end();
+  while (it != entries.begin() && usedBytes + incoming > budget) {
+    --it;
+    if (hasPinned && it->key == pinned)
+      continue;
+    usedBytes -= it->bytes;
+    index.erase(it->key);
+    if (!reusable && it->texture->getSize() == size)
+      reusable = it->texture;
+    else
+      driver->removeTexture(it->texture);
+    it = entries.erase(it);
+  }
+  return reusable;
+}
+
+} // namespace ygo
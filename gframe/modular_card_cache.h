@@ -0,0 +1,117 @@
+#ifndef MODULAR_CARD_CACHE_H
+#define MODULAR_CARD_CACHE_H
+
+#include "config.h"
+#include <cstddef>
+#include <cstdint>
+#include <dimension2d.h>
+#include <list>
+#include <unordered_map>
+
+namespace irr {
+namespace video {
+class ITexture;
+class IVideoDriver;
+} // namespace video
+} // namespace irr
+
+namespace ygo {
+
+// Identifies one finished modular card image. Anything that changes the
+// composited pixels must be part of the key.
+struct ModularCardCacheKey {
+  uint32_t code;
+  size_t locale;       // Hash of the active locale name
+  uint32_t artVersion; // 0 while the art is missing (placeholder frame)
+  uint32_t settings;   // Renderer settings that affect the output
+
+  bool operator==(const ModularCardCacheKey &other) const {
+    return code == other.code && locale == other.locale &&
+           artVersion == other.artVersion && settings == other.settings;
+  }
+};
+
+struct ModularCardCacheKeyHash {
+  size_t operator()(const ModularCardCacheKey &key) const {
+    size_t seed = key.code;
+    auto combine = [&seed](size_t value) {
+      seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    combine(key.locale);
+    combine(key.artVersion);
+    combine(key.settings);
+    return seed;
+  }
+};
+
+// Bounded LRU of composited modular card textures. Every entry owns its own
+// render target, so a hit is a plain texture lookup and the renderer only
+// runs on a miss. Evicted render targets of the requested size are recycled
+// instead of being freed and reallocated.
+class ModularCardCache {
+public:
+  ModularCardCache(irr::video::IVideoDriver *driver, size_t budgetBytes);
+  ~ModularCardCache();
+
+  // Returns the cached texture for key and marks it most recently used, or
+  // nullptr on a miss.
+  irr::video::ITexture *Find(const ModularCardCacheKey &key);
+
+  // Returns a render target registered under key that the caller must render
+  // into, evicting least recently used entries to stay within the budget.
+  // Returns nullptr if caching is disabled or the target can't be created.
+  irr::video::ITexture *Acquire(const ModularCardCacheKey &key,
+                                const irr::core::dimension2du &size);
+
+  // Takes ownership of an already drawn texture, e.g. a card composited in
+  // software, evicting least recently used entries to make room for it. If
+  // key is already cached the new texture is dropped instead.
+  void Insert(const ModularCardCacheKey &key, irr::video::ITexture *texture);
+
+  // Drops the entry for key, e.g. after a failed render.
+  void Erase(const ModularCardCacheKey &key);
+
+  // Drops every entry, to be called when card data or strings are reloaded.
+  // Whoever shows a cached texture must stop using it.
+  void Clear();
+
+  // Keeps the entry for key, the card on display, from being evicted or
+  // recycled until the next Pin or Unpin. Erase and Clear still drop it.
+  void Pin(const ModularCardCacheKey &key);
+  void Unpin();
+
+  void SetBudget(size_t budgetBytes);
+  size_t GetBudget() const { return budget; }
+  size_t GetUsedBytes() const { return usedBytes; }
+  size_t GetEntryCount() const { return entries.size(); }
+
+  // Estimated VRAM footprint of an RGBA render target with a full mip chain.
+  static size_t TextureBytes(const irr::core::dimension2du &size);
+
+private:
+  struct Entry {
+    ModularCardCacheKey key;
+    irr::video::ITexture *texture;
+    size_t bytes;
+  };
+  using EntryList = std::list<Entry>;
+
+  irr::video::IVideoDriver *driver;
+  size_t budget;
+  size_t usedBytes;
+  bool hasPinned;
+  ModularCardCacheKey pinned;
+  EntryList entries; // Front is most recently used
+  std::unordered_map<ModularCardCacheKey, EntryList::iterator,
+                     ModularCardCacheKeyHash>
+      index;
+
+  // Evicts from the back until incoming bytes fit, handing back one evicted
+  // texture of the wanted size for reuse if there was one.
+  irr::video::ITexture *EvictFor(size_t incoming,
+                                 const irr::core::dimension2du &size);
+};
+
+} // namespace ygo
+
+#endif // MODULAR_CARD_CACHE_H
@@ -0,0 +1,879 @@
+#include "modular_card_canvas.h"
+#include "CGUITTFont/CGUITTFont.h"
+#include "file_stream.h"
+#include "fmt.h"
+#include "game_config.h"
+#include "image_data.h"
+#include "utils.h"
+#include <IImage.h>
+#include <ITexture.h>
+#include <IVideoDriver.h>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace ygo {
+
+epro::path_stringview GetModularFacePath(ModularFace face) {
+  switch (face) {
+  case ModularFace::CARD_NAME:
+    return EPRO_TEXT("textures/modular/font/matrix_bold_small_caps.ttf");
+  case ModularFace::EFFECT:
+    return EPRO_TEXT("textures/modular/font/StoneSerifStd-Medium.ttf");
+  case ModularFace::EFFECT_ITALIC:
+    return EPRO_TEXT("textures/modular/font/StoneSerifITC-MediumItalic.ttf");
+  case ModularFace::STATS:
+    return EPRO_TEXT("textures/modular/font/MatrixRegular.ttf");
+  case ModularFace::TYPE_LINE:
+    return EPRO_TEXT("textures/modular/font/StoneSerifSmallCapsBold.ttf");
+  default:
+    return EPRO_TEXT("");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GPU canvas
+
+ModularGpuCanvas::ModularGpuCanvas(irr::video::IVideoDriver *driver,
+                                   irr::gui::IGUIEnvironment *env)
+    : driver(driver), env(env), art(nullptr), fontUses(0), assets(driver),
+      metrics(assets), atlas(driver, assets), atlasBuilt(false),
+      batchTexture(nullptr) {}
+
+ModularGpuCanvas::~ModularGpuCanvas() {
+  // Textures are managed by the driver, the fonts are ours
+  for (auto &font : fonts) {
+    if (font.second.font)
+      font.second.font->drop();
+  }
+}
+
+void ModularGpuCanvas::Begin(irr::video::ITexture *art) {
+  if (!atlasBuilt) {
+    atlas.Build("textures/modular/icon/");
+    atlasBuilt = true;
+  }
+  this->art = art;
+}
+
+void ModularGpuCanvas::End() {
+  Flush();
+  art = nullptr;
+}
+
+void ModularGpuCanvas::Flush() {
+  if (batchIndices.empty())
+    return;
+  // Same setup as Game::DrawTextureBilinear, the quads are already in clip
+  // space
+  const irr::core::matrix4 oldProjection =
+      driver->getTransform(irr::video::ETS_PROJECTION);
+  const irr::core::matrix4 oldView = driver->getTransform(irr::video::ETS_VIEW);
+  const irr::core::matrix4 oldWorld =
+      driver->getTransform(irr::video::ETS_WORLD);
+  driver->setTransform(irr::video::ETS_PROJECTION, irr::core::matrix4());
+  driver->setTransform(irr::video::ETS_VIEW, irr::core::matrix4());
+  driver->setTransform(irr::video::ETS_WORLD, irr::core::matrix4());
+
+  irr::video::SMaterial material;
+  material.Lighting = false;
+#if IRRLICHT_VERSION_MAJOR == 1 && IRRLICHT_VERSION_MINOR == 9
+  material.ZWriteEnable = irr::video::E_ZWRITE::EZW_OFF;
+#else
+  material.ZWriteEnable = false;
+#endif
+  material.ZBuffer = irr::video::ECFN_DISABLED;
+  material.BackfaceCulling = false;
+  material.TextureLayer[0].Texture = batchTexture;
+  material.TextureLayer[0].BilinearFilter = true;
+  material.TextureLayer[0].TextureWrapU = irr::video::ETC_CLAMP_TO_EDGE;
+  material.TextureLayer[0].TextureWrapV = irr::video::ETC_CLAMP_TO_EDGE;
+  material.MaterialType = irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL;
+  driver->setMaterial(material);
+  driver->drawIndexedTriangleList(
+      batchVertices.data(), static_cast<irr::u32>(batchVertices.size()),
+      batchIndices.data(), static_cast<irr::u32>(batchIndices.size() / 3));
+
+  driver->setTransform(irr::video::ETS_PROJECTION, oldProjection);
+  driver->setTransform(irr::video::ETS_VIEW, oldView);
+  driver->setTransform(irr::video::ETS_WORLD, oldWorld);
+  batchVertices.clear();
+  batchIndices.clear();
+  batchTexture = nullptr;
+}
+
+irr::video::ITexture *ModularGpuCanvas::GetTexture(const std::string &path) {
+  auto it = textures.find(path);
+  if (it != textures.end())
+    return it->second;
+  irr::video::ITexture *texture = driver->getTexture(path.c_str());
+  textures[path] = texture;
+  return texture;
+}
+
+irr::gui::CGUITTFont *ModularGpuCanvas::GetFont(const ModularFont &font) {
+  const auto key = std::make_pair(font.face, font.size);
+  auto it = fonts.find(key);
+  if (it != fonts.end()) {
+    it->second.lastUse = ++fontUses;
+    return it->second.font;
+  }
+  if (fonts.size() >= MAX_FONTS) {
+    auto oldest = fonts.begin();
+    for (auto cur = fonts.begin(); cur != fonts.end(); ++cur) {
+      if (cur->second.lastUse < oldest->second.lastUse)
+        oldest = cur;
+    }
+    if (oldest->second.font)
+      oldest->second.font->drop();
+    fonts.erase(oldest);
+  }
+  // Single font on purpose, the card fonts cover everything that is printed
+  static const GameConfig::FallbackFonts fallbackFonts;
+  irr::gui::CGUITTFont *newFont = irr::gui::CGUITTFont::createTTFont(
+      env, {GetModularFacePath(font.face), font.size}, fallbackFonts);
+  fonts[key] = {newFont, ++fontUses};
+  return newFont;
+}
+
+void ModularGpuCanvas::DrawImage(const std::string &path,
+                                 const irr::core::recti &dest,
+                                 const irr::core::recti *src) {
+  if (const auto *sprite = atlas.Find(path)) {
+    if (sprite->texture != batchTexture || batchVertices.size() + 4 > 0xffff)
+      Flush();
+    batchTexture = sprite->texture;
+    irr::core::recti rect = sprite->rect;
+    if (src)
+      rect = irr::core::recti(
+          sprite->rect.UpperLeftCorner + src->UpperLeftCorner,
+          sprite->rect.UpperLeftCorner + src->LowerRightCorner);
+    const auto &page = batchTexture->getSize();
+    const auto &target = driver->getCurrentRenderTargetSize();
+    const float left = dest.UpperLeftCorner.X * 2.0f / target.Width - 1.0f;
+    const float right = dest.LowerRightCorner.X * 2.0f / target.Width - 1.0f;
+    const float top = 1.0f - dest.UpperLeftCorner.Y * 2.0f / target.Height;
+    const float bottom =
+        1.0f - dest.LowerRightCorner.Y * 2.0f / target.Height;
+    const float u0 = static_cast<float>(rect.UpperLeftCorner.X) / page.Width;
+    const float u1 = static_cast<float>(rect.LowerRightCorner.X) / page.Width;
+    const float v0 = static_cast<float>(rect.UpperLeftCorner.Y) / page.Height;
+    const float v1 =
+        static_cast<float>(rect.LowerRightCorner.Y) / page.Height;
+    const irr::video::SColor white(255, 255, 255, 255);
+    const auto first = static_cast<irr::u16>(batchVertices.size());
+    batchVertices.emplace_back(left, top, 0, 0, 0, 1, white, u0, v0);
+    batchVertices.emplace_back(right, top, 0, 0, 0, 1, white, u1, v0);
+    batchVertices.emplace_back(left, bottom, 0, 0, 0, 1, white, u0, v1);
+    batchVertices.emplace_back(right, bottom, 0, 0, 0, 1, white, u1, v1);
+    for (irr::u16 index : {0, 1, 2, 3, 2, 1})
+      batchIndices.push_back(static_cast<irr::u16>(first + index));
+    return;
+  }
+  Flush();
+  irr::video::ITexture *texture = GetTexture(path);
+  if (!texture)
+    return;
+  const auto &size = texture->getOriginalSize();
+  driver->draw2DImage(texture, dest,
+                      src ? *src
+                          : irr::core::recti(0, 0, size.Width, size.Height),
+                      nullptr, nullptr, true);
+}
+
+void ModularGpuCanvas::DrawArt(const irr::core::recti &dest,
+                               const irr::core::recti &src) {
+  Flush();
+  if (art)
+    driver->draw2DImage(art, dest, src, nullptr, nullptr, true);
+}
+
+irr::core::dimension2du ModularGpuCanvas::GetArtSize() const {
+  return art ? art->getSize() : irr::core::dimension2du();
+}
+
+void ModularGpuCanvas::FillRect(irr::video::SColor color,
+                                const irr::core::recti &rect) {
+  Flush();
+  driver->draw2DRectangle(color, rect);
+}
+
+irr::core::dimension2du
+ModularGpuCanvas::GetTextDimension(const ModularFont &font,
+                                   const std::wstring &text) {
+  return metrics.GetTextDimension(font, text);
+}
+
+int ModularGpuCanvas::GetCharAdvance(const ModularFont &font, wchar_t ch,
+                                     wchar_t previous) {
+  return metrics.GetCharAdvance(font, ch, previous);
+}
+
+void ModularGpuCanvas::DrawText(const ModularFont &font,
+                                const std::wstring &text,
+                                const irr::core::recti &rect,
+                                irr::video::SColor color, bool hcenter,
+                                bool vcenter, float scaleX) {
+  irr::gui::CGUITTFont *f = GetFont(font);
+  if (!f)
+    return;
+  Flush();
+  if (scaleX >= 1.0f)
+    f->draw(text.c_str(), rect, color, hcenter, vcenter);
+  else
+    f->drawScaled(text.c_str(), rect, color, scaleX, hcenter, vcenter);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Texture atlas
+
+ModularTextureAtlas::ModularTextureAtlas(irr::video::IVideoDriver *driver,
+                                         ModularSoftwareAssets &assets)
+    : driver(driver), assets(assets) {}
+
+void ModularTextureAtlas::Build(const std::string &dir) {
+  struct Entry {
+    std::string path;
+    irr::video::IImage *image;
+  };
+  std::vector<Entry> entries;
+  for (const auto &file : Utils::FindFiles(Utils::ToPathString(dir),
+                                           {EPRO_TEXT("png")})) {
+    auto path = dir + Utils::ToUTF8IfNeeded(file);
+    irr::video::IImage *image = assets.GetImage(path);
+    if (!image)
+      continue;
+    const auto &size = image->getDimension();
+    if (size.Width > MAX_SPRITE_SIZE || size.Height > MAX_SPRITE_SIZE)
+      continue;
+    entries.push_back({std::move(path), image});
+  }
+  if (entries.empty())
+    return;
+  // Shelves of similar heights waste the least space
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) {
+              return a.image->getDimension().Height >
+                     b.image->getDimension().Height;
+            });
+
+  irr::video::IImage *page = nullptr;
+  std::vector<std::pair<std::string, irr::core::recti>> placed;
+  irr::u32 x = 0, y = 0, shelfHeight = 0;
+  auto upload = [&] {
+    const auto name = epro::format("ModularAtlas_{}", sprites.size());
+    const bool prevMipMap =
+        driver->getTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS);
+    // Lower levels would blend neighbouring sprites together
+    driver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS, false);
+    irr::video::ITexture *texture = driver->addTexture(
+        {name.data(), static_cast<irr::u32>(name.size())}, page);
+    driver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS,
+                                   prevMipMap);
+    page->drop();
+    page = nullptr;
+    if (texture) {
+      for (auto &sprite : placed)
+        sprites[std::move(sprite.first)] = Sprite{texture, sprite.second};
+    }
+    placed.clear();
+  };
+  for (const auto &entry : entries) {
+    const auto &size = entry.image->getDimension();
+    const irr::u32 w = size.Width + PADDING * 2;
+    const irr::u32 h = size.Height + PADDING * 2;
+    if (x + w > PAGE_SIZE) {
+      x = 0;
+      y += shelfHeight;
+      shelfHeight = 0;
+    }
+    if (page && y + h > PAGE_SIZE)
+      upload();
+    if (!page) {
+      page = driver->createImage(irr::video::ECF_A8R8G8B8,
+                                 {PAGE_SIZE, PAGE_SIZE});
+      page->fill(irr::video::SColor(0, 0, 0, 0));
+      x = y = shelfHeight = 0;
+    }
+    // Copy with the edge pixels repeated into the padding
+    const auto *in = static_cast<const uint32_t *>(GetData(entry.image));
+    auto *out = static_cast<uint32_t *>(GetData(page));
+    const irr::u32 inPitch = entry.image->getPitch() / 4;
+    const irr::u32 outPitch = page->getPitch() / 4;
+    for (irr::u32 row = 0; row < h; ++row) {
+      const irr::u32 sy = std::min(std::max(row, PADDING) - PADDING,
+                                   size.Height - 1);
+      for (irr::u32 col = 0; col < w; ++col) {
+        const irr::u32 sx = std::min(std::max(col, PADDING) - PADDING,
+                                     size.Width - 1);
+        out[(y + row) * outPitch + x + col] = in[sy * inPitch + sx];
+      }
+    }
+    Unlock(page);
+    Unlock(entry.image);
+    placed.emplace_back(
+        entry.path,
+        irr::core::recti(x + PADDING, y + PADDING, x + PADDING + size.Width,
+                         y + PADDING + size.Height));
+    x += w;
+    shelfHeight = std::max(shelfHeight, h);
+  }
+  if (page)
+    upload();
+}
+
+const ModularTextureAtlas::Sprite *
+ModularTextureAtlas::Find(const std::string &path) const {
+  auto it = sprites.find(path);
+  return it != sprites.end() ? &it->second : nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Software assets
+
+ModularSoftwareAssets::ModularSoftwareAssets(irr::video::IVideoDriver *driver)
+    : driver(driver) {}
+
+ModularSoftwareAssets::~ModularSoftwareAssets() {
+  for (auto &image : images) {
+    if (image.second)
+      image.second->drop();
+  }
+}
+
+irr::video::IImage *ModularSoftwareAssets::LoadImage(epro::path_stringview path) {
+  return ToA8R8G8B8(driver->createImageFromFile(
+      {path.data(), static_cast<irr::u32>(path.size())}));
+}
+
+irr::video::IImage *
+ModularSoftwareAssets::LoadImage(irr::io::IReadFile *file) {
+  return ToA8R8G8B8(driver->createImageFromFile(file));
+}
+
+irr::video::IImage *
+ModularSoftwareAssets::ToA8R8G8B8(irr::video::IImage *image) {
+  if (!image || image->getColorFormat() == irr::video::ECF_A8R8G8B8)
+    return image;
+  irr::video::IImage *converted =
+      driver->createImage(irr::video::ECF_A8R8G8B8, image->getDimension());
+  image->copyTo(converted);
+  image->drop();
+  return converted;
+}
+
+irr::video::IImage *ModularSoftwareAssets::GetImage(const std::string &path) {
+  std::lock_guard<epro::mutex> lck(mutex);
+  auto it = images.find(path);
+  if (it != images.end())
+    return it->second;
+  // Failures are remembered too, there's no point retrying a missing file
+  irr::video::IImage *image = LoadImage(Utils::ToPathString(path));
+  images[path] = image;
+  return image;
+}
+
+const std::vector<char> &ModularSoftwareAssets::GetFontData(ModularFace face) {
+  std::lock_guard<epro::mutex> lck(mutex);
+  auto &data = fontData[static_cast<size_t>(face)];
+  if (!data) {
+    data = std::make_unique<std::vector<char>>();
+    FileStream file{GetModularFacePath(face).data(),
+                    FileStream::in | FileStream::binary};
+    if (file.good())
+      data->assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+  }
+  return *data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Glyph rasterizer
+
+ModularGlyphRasterizer::ModularGlyphRasterizer(ModularSoftwareAssets &assets)
+    : assets(assets),
+      library(irr::gui::CGUITTFont::createFreeTypeLibrary()) {}
+
+ModularGlyphRasterizer::~ModularGlyphRasterizer() {
+  for (auto &face : faces) {
+    if (face.second.face)
+      FT_Done_Face(face.second.face);
+  }
+  if (library)
+    FT_Done_FreeType(library);
+}
+
+ModularGlyphRasterizer::SizedFace *
+ModularGlyphRasterizer::GetFace(const ModularFont &font) {
+  const auto key = std::make_pair(font.face, font.size);
+  auto it = faces.find(key);
+  if (it != faces.end())
+    return it->second.face ? &it->second : nullptr;
+
+  auto &sized = faces[key];
+  sized.face = nullptr;
+  if (!library || font.size == 0)
+    return nullptr;
+  const auto &data = assets.GetFontData(font.face);
+  if (data.empty())
+    return nullptr;
+  sized.face =
+      irr::gui::CGUITTFont::openMemoryFace(library, data.data(), data.size());
+  if (!sized.face)
+    return nullptr;
+  FT_Set_Pixel_Sizes(sized.face, font.size, 0);
+  sized.ascender = static_cast<int>(sized.face->size->metrics.ascender / 64);
+
+  // Same line height heuristic as CGUITTFont::load
+  auto height = [&](uint32_t ch) {
+    const Glyph &glyph = GetGlyph(sized, ch);
+    if (glyph.valid)
+      return sized.ascender - glyph.top + glyph.rows + 1;
+    return (ch >= 0x2000 ? sized.ascender : sized.ascender / 2) + 1;
+  };
+  sized.lineHeight = std::max({height('g'), height('j'), height(0x55B5)});
+  return &sized;
+}
+
+const ModularGlyphRasterizer::Glyph &
+ModularGlyphRasterizer::GetGlyph(SizedFace &face, uint32_t ch) {
+  auto it = face.glyphs.find(ch);
+  if (it != face.glyphs.end())
+    return it->second;
+
+  Glyph &glyph = face.glyphs[ch];
+  glyph = Glyph{};
+  glyph.index = FT_Get_Char_Index(face.face, ch);
+  if (glyph.index == 0)
+    glyph.index = FT_Get_Char_Index(face.face, 0xFFFD);
+  if (glyph.index == 0 ||
+      FT_Load_Glyph(face.face, glyph.index,
+                    FT_LOAD_DEFAULT | FT_LOAD_RENDER | FT_LOAD_TARGET_NORMAL) !=
+          FT_Err_Ok) {
+    glyph.advance = ch >= 0x2000 ? face.ascender : face.ascender / 2;
+    return glyph;
+  }
+
+  const FT_GlyphSlot slot = face.face->glyph;
+  const FT_Bitmap &bits = slot->bitmap;
+  glyph.valid = true;
+  glyph.left = slot->bitmap_left;
+  glyph.top = slot->bitmap_top;
+  glyph.advance = static_cast<int>(slot->advance.x / 64);
+  glyph.width = static_cast<int>(bits.width);
+  glyph.rows = static_cast<int>(bits.rows);
+  glyph.coverage.resize(static_cast<size_t>(glyph.width) * glyph.rows);
+  for (int y = 0; y < glyph.rows; ++y) {
+    const uint8_t *row = bits.buffer + y * bits.pitch;
+    uint8_t *out = glyph.coverage.data() + y * glyph.width;
+    if (bits.pixel_mode == FT_PIXEL_MODE_MONO) {
+      for (int x = 0; x < glyph.width; ++x)
+        out[x] = (row[x / 8] & (0x80 >> (x % 8))) ? 255 : 0;
+    } else {
+      std::copy(row, row + glyph.width, out);
+    }
+  }
+  return glyph;
+}
+
+uint32_t ModularGlyphRasterizer::GetIndex(SizedFace &face, uint32_t ch) {
+  auto it = face.glyphs.find(ch);
+  if (it != face.glyphs.end())
+    return it->second.index;
+  uint32_t index = FT_Get_Char_Index(face.face, ch);
+  if (index == 0)
+    index = FT_Get_Char_Index(face.face, 0xFFFD);
+  return index;
+}
+
+int ModularGlyphRasterizer::GetAdvance(SizedFace &face, uint32_t ch) {
+  auto glyph = face.glyphs.find(ch);
+  if (glyph != face.glyphs.end())
+    return glyph->second.advance;
+  auto it = face.advances.find(ch);
+  if (it != face.advances.end())
+    return it->second;
+  // Hinting is applied when loading, rendering doesn't change the advance
+  const uint32_t index = GetIndex(face, ch);
+  int advance = ch >= 0x2000 ? face.ascender : face.ascender / 2;
+  if (index != 0 &&
+      FT_Load_Glyph(face.face, index,
+                    FT_LOAD_DEFAULT | FT_LOAD_TARGET_NORMAL) == FT_Err_Ok)
+    advance = static_cast<int>(face.face->glyph->advance.x / 64);
+  face.advances.emplace(ch, advance);
+  return advance;
+}
+
+int ModularGlyphRasterizer::GetKerning(SizedFace &face, uint32_t ch,
+                                       uint32_t previous) {
+  if (ch == 0 || previous == 0 || !FT_HAS_KERNING(face.face))
+    return 0;
+  FT_Vector v;
+  FT_Get_Kerning(face.face, GetIndex(face, previous), GetIndex(face, ch),
+                 FT_KERNING_DEFAULT, &v);
+  return static_cast<int>(FT_IS_SCALABLE(face.face) ? v.x / 64 : v.x);
+}
+
+irr::core::dimension2du
+ModularGlyphRasterizer::GetTextDimension(const ModularFont &font,
+                                         const std::wstring &text) {
+  auto *face = GetFace(font);
+  if (!face)
+    return {};
+  irr::u32 width = 0;
+  irr::u32 height = face->lineHeight;
+  irr::u32 line = 0;
+  uint32_t previous = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    const uint32_t ch = text[i];
+    if (ch == L'\r' || ch == L'\n') {
+      if (ch == L'\r' && i + 1 < text.size() && text[i + 1] == L'\n')
+        ++i;
+      width = std::max(width, line);
+      height += face->lineHeight;
+      line = 0;
+      previous = 0;
+      continue;
+    }
+    line += GetKerning(*face, ch, previous);
+    line += GetAdvance(*face, ch);
+    previous = ch;
+  }
+  return {std::max(width, line), height};
+}
+
+int ModularGlyphRasterizer::GetCharAdvance(const ModularFont &font, wchar_t ch,
+                                           wchar_t previous) {
+  auto *face = GetFace(font);
+  if (!face)
+    return 0;
+  return GetKerning(*face, ch, previous) + GetAdvance(*face, ch);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Software canvas
+
+namespace {
+
+// Blends a premultiplied color (channels in 0..255) over a straight alpha
+// A8R8G8B8 pixel, the same result the driver gives for the render target
+inline void BlendPremultiplied(uint32_t &dst, float a, float r, float g,
+                               float b) {
+  if (a <= 0.0f)
+    return;
+  const float inv = 1.0f - a / 255.0f;
+  const float da = static_cast<float>(dst >> 24);
+  const float outA = a + da * inv;
+  if (outA <= 0.0f)
+    return;
+  const float dmul = da / 255.0f * inv;
+  auto channel = [&](float src, int shift) {
+    const float d = static_cast<float>((dst >> shift) & 0xff);
+    const float v = (src + d * dmul) * 255.0f / outA;
+    return static_cast<uint32_t>(std::min(v + 0.5f, 255.0f)) << shift;
+  };
+  dst = (static_cast<uint32_t>(std::min(outA + 0.5f, 255.0f)) << 24) |
+        channel(r, 16) | channel(g, 8) | channel(b, 0);
+}
+
+inline void BlendPixel(uint32_t &dst, uint32_t src) {
+  const uint32_t a = src >> 24;
+  if (a == 0)
+    return;
+  if (a == 255) {
+    dst = src;
+    return;
+  }
+  const float k = a / 255.0f;
+  BlendPremultiplied(dst, static_cast<float>(a), ((src >> 16) & 0xff) * k,
+                     ((src >> 8) & 0xff) * k, (src & 0xff) * k);
+}
+
+} // namespace
+
+ModularSoftwareCanvas::ModularSoftwareCanvas(irr::video::IImage *target,
+                                             irr::video::IImage *art,
+                                             ModularSoftwareAssets &assets,
+                                             ModularGlyphRasterizer &glyphs)
+    : target(target), art(art), assets(assets), glyphs(glyphs),
+      pixels(static_cast<uint32_t *>(GetData(target))),
+      pitch(target->getPitch() / 4), size(target->getDimension()) {}
+
+ModularSoftwareCanvas::~ModularSoftwareCanvas() { Unlock(target); }
+
+void ModularSoftwareCanvas::Blit(irr::video::IImage *image,
+                                 const irr::core::recti &dest,
+                                 const irr::core::recti &src) {
+  if (!image || dest.getWidth() <= 0 || dest.getHeight() <= 0 ||
+      src.getWidth() <= 0 || src.getHeight() <= 0)
+    return;
+  const auto *srcPixels = static_cast<const uint32_t *>(GetData(image));
+  const int srcPitch = static_cast<int>(image->getPitch() / 4);
+  const int x0 = std::max(dest.UpperLeftCorner.X, 0);
+  const int y0 = std::max(dest.UpperLeftCorner.Y, 0);
+  const int x1 = std::min(dest.LowerRightCorner.X, static_cast<int>(size.Width));
+  const int y1 =
+      std::min(dest.LowerRightCorner.Y, static_cast<int>(size.Height));
+
+  if (dest.getSize() == src.getSize()) {
+    // Unscaled, a straight blend of the overlapping pixels
+    const int dx = src.UpperLeftCorner.X - dest.UpperLeftCorner.X;
+    const int dy = src.UpperLeftCorner.Y - dest.UpperLeftCorner.Y;
+    for (int y = y0; y < y1; ++y) {
+      const uint32_t *in = srcPixels + (y + dy) * srcPitch + dx;
+      uint32_t *out = pixels + y * pitch;
+      for (int x = x0; x < x1; ++x)
+        BlendPixel(out[x], in[x]);
+    }
+    Unlock(image);
+    return;
+  }
+
+  // Bilinear filtering on premultiplied colors, like the texture sampler
+  const float scaleX = static_cast<float>(src.getWidth()) / dest.getWidth();
+  const float scaleY = static_cast<float>(src.getHeight()) / dest.getHeight();
+  struct Tap {
+    int i0, i1;
+    float f;
+  };
+  auto makeTap = [](float pos, int lo, int hi) {
+    pos = std::min(std::max(pos, static_cast<float>(lo)),
+                   static_cast<float>(hi - 1));
+    const int i0 = static_cast<int>(pos);
+    return Tap{i0, std::min(i0 + 1, hi - 1), pos - i0};
+  };
+  std::vector<Tap> columns;
+  columns.reserve(std::max(x1 - x0, 0));
+  for (int x = x0; x < x1; ++x)
+    columns.push_back(
+        makeTap(src.UpperLeftCorner.X +
+                    (x + 0.5f - dest.UpperLeftCorner.X) * scaleX - 0.5f,
+                src.UpperLeftCorner.X, src.LowerRightCorner.X));
+
+  for (int y = y0; y < y1; ++y) {
+    const Tap row = makeTap(src.UpperLeftCorner.Y +
+                                (y + 0.5f - dest.UpperLeftCorner.Y) * scaleY -
+                                0.5f,
+                            src.UpperLeftCorner.Y, src.LowerRightCorner.Y);
+    const uint32_t *top = srcPixels + row.i0 * srcPitch;
+    const uint32_t *bottom = srcPixels + row.i1 * srcPitch;
+    uint32_t *out = pixels + y * pitch;
+    for (int x = x0; x < x1; ++x) {
+      const Tap &col = columns[x - x0];
+      const uint32_t taps[4] = {top[col.i0], top[col.i1], bottom[col.i0],
+                                bottom[col.i1]};
+      const float weights[4] = {(1 - col.f) * (1 - row.f), col.f * (1 - row.f),
+                                (1 - col.f) * row.f, col.f * row.f};
+      float a = 0, r = 0, g = 0, b = 0;
+      for (int i = 0; i < 4; ++i) {
+        const float ta = static_cast<float>(taps[i] >> 24) * weights[i];
+        const float k = ta / 255.0f;
+        a += ta;
+        r += ((taps[i] >> 16) & 0xff) * k;
+        g += ((taps[i] >> 8) & 0xff) * k;
+        b += (taps[i] & 0xff) * k;
+      }
+      BlendPremultiplied(out[x], a, r, g, b);
+    }
+  }
+  Unlock(image);
+}
+
+void ModularSoftwareCanvas::DrawImage(const std::string &path,
+                                      const irr::core::recti &dest,
+                                      const irr::core::recti *src) {
+  irr::video::IImage *image = assets.GetImage(path);
+  if (!image)
+    return;
+  const auto &dim = image->getDimension();
+  Blit(image, dest,
+       src ? *src : irr::core::recti(0, 0, dim.Width, dim.Height));
+}
+
+void ModularSoftwareCanvas::DrawArt(const irr::core::recti &dest,
+                                    const irr::core::recti &src) {
+  Blit(art, dest, src);
+}
+
+irr::core::dimension2du ModularSoftwareCanvas::GetArtSize() const {
+  return art ? art->getDimension() : irr::core::dimension2du();
+}
+
+void ModularSoftwareCanvas::FillRect(irr::video::SColor color,
+                                     const irr::core::recti &rect) {
+  const int x0 = std::max(rect.UpperLeftCorner.X, 0);
+  const int y0 = std::max(rect.UpperLeftCorner.Y, 0);
+  const int x1 = std::min(rect.LowerRightCorner.X, static_cast<int>(size.Width));
+  const int y1 =
+      std::min(rect.LowerRightCorner.Y, static_cast<int>(size.Height));
+  for (int y = y0; y < y1; ++y) {
+    uint32_t *out = pixels + y * pitch;
+    for (int x = x0; x < x1; ++x)
+      BlendPixel(out[x], color.color);
+  }
+}
+
+irr::core::dimension2du
+ModularSoftwareCanvas::GetTextDimension(const ModularFont &font,
+                                        const std::wstring &text) {
+  return glyphs.GetTextDimension(font, text);
+}
+
+int ModularSoftwareCanvas::GetCharAdvance(const ModularFont &font, wchar_t ch,
+                                          wchar_t previous) {
+  return glyphs.GetCharAdvance(font, ch, previous);
+}
+
+void ModularSoftwareCanvas::BlendGlyph(
+    const ModularGlyphRasterizer::Glyph &glyph, float x, int y, float scaleX,
+    irr::video::SColor color) {
+  const float colorA = static_cast<float>(color.getAlpha());
+  const float k = colorA / 255.0f;
+  const float red = color.getRed() * k;
+  const float green = color.getGreen() * k;
+  const float blue = color.getBlue() * k;
+  const int firstX = std::max(static_cast<int>(std::floor(x)), 0);
+  const int lastX =
+      std::min(static_cast<int>(std::ceil(x + glyph.width * scaleX)),
+               static_cast<int>(size.Width));
+  const float invScale = 1.0f / scaleX;
+
+  for (int row = 0; row < glyph.rows; ++row) {
+    const int py = y + row;
+    if (py < 0 || py >= static_cast<int>(size.Height))
+      continue;
+    const uint8_t *coverage = glyph.coverage.data() + row * glyph.width;
+    uint32_t *out = pixels + py * pitch;
+    for (int px = firstX; px < lastX; ++px) {
+      // Box filter over the source span this pixel covers, which is exact
+      // for unscaled glyphs and keeps squeezed names smooth
+      const float s0 = std::max((px - x) * invScale, 0.0f);
+      const float s1 =
+          std::min((px + 1 - x) * invScale, static_cast<float>(glyph.width));
+      if (s1 <= s0)
+        continue;
+      float sum = 0.0f;
+      for (int s = static_cast<int>(s0); s < s1; ++s) {
+        const float lo = std::max(s0, static_cast<float>(s));
+        const float hi = std::min(s1, static_cast<float>(s + 1));
+        sum += coverage[s] * (hi - lo);
+      }
+      const float cov = sum * scaleX / 255.0f;
+      if (cov > 0.0f)
+        BlendPremultiplied(out[px], colorA * cov, red * cov, green * cov,
+                           blue * cov);
+    }
+  }
+}
+
+void ModularSoftwareCanvas::DrawText(const ModularFont &font,
+                                     const std::wstring &text,
+                                     const irr::core::recti &rect,
+                                     irr::video::SColor color, bool hcenter,
+                                     bool vcenter, float scaleX) {
+  auto *face = glyphs.GetFace(font);
+  if (!face || text.empty())
+    return;
+  scaleX = std::min(scaleX, 1.0f);
+
+  // Same placement rules as CGUITTFont::drawustring
+  float startX = static_cast<float>(rect.UpperLeftCorner.X);
+  int y = rect.UpperLeftCorner.Y;
+  if (hcenter || vcenter) {
+    const auto dim = GetTextDimension(font, text);
+    if (hcenter)
+      startX += (rect.getWidth() - static_cast<int>(dim.Width * scaleX)) >> 1;
+    if (vcenter)
+      y += (rect.getHeight() - static_cast<int>(dim.Height)) >> 1;
+  }
+
+  int pen = 0;
+  uint32_t previous = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    const uint32_t ch = text[i];
+    if (ch == L'\r' || ch == L'\n') {
+      if (ch == L'\r' && i + 1 < text.size() && text[i + 1] == L'\n')
+        ++i;
+      y += face->lineHeight;
+      pen = 0;
+      previous = 0;
+      continue;
+    }
+    pen += glyphs.GetKerning(*face, ch, previous);
+    const auto &glyph = glyphs.GetGlyph(*face, ch);
+    if (glyph.valid && ch != L' ')
+      BlendGlyph(glyph, startX + (pen + glyph.left) * scaleX,
+                 y + face->ascender - glyph.top, scaleX, color);
+    pen += glyph.advance;
+    previous = ch;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Scaled canvas
+
+ModularScaledCanvas::ModularScaledCanvas(ModularCanvas &canvas, float scaleX,
+                                         float scaleY)
+    : canvas(canvas), scaleX(scaleX), scaleY(scaleY) {}
+
+irr::core::recti
+ModularScaledCanvas::Scale(const irr::core::recti &rect) const {
+  // Both corners are rounded, so boxes sharing an edge still share it
+  return {static_cast<int>(std::lround(rect.UpperLeftCorner.X * scaleX)),
+          static_cast<int>(std::lround(rect.UpperLeftCorner.Y * scaleY)),
+          static_cast<int>(std::lround(rect.LowerRightCorner.X * scaleX)),
+          static_cast<int>(std::lround(rect.LowerRightCorner.Y * scaleY))};
+}
+
+void ModularScaledCanvas::DrawImage(const std::string &path,
+                                    const irr::core::recti &dest,
+                                    const irr::core::recti *src) {
+  canvas.DrawImage(path, Scale(dest), src);
+}
+
+void ModularScaledCanvas::DrawArt(const irr::core::recti &dest,
+                                  const irr::core::recti &src) {
+  canvas.DrawArt(Scale(dest), src);
+}
+
+irr::core::dimension2du ModularScaledCanvas::GetArtSize() const {
+  return canvas.GetArtSize();
+}
+
+void ModularScaledCanvas::FillRect(irr::video::SColor color,
+                                   const irr::core::recti &rect) {
+  canvas.FillRect(color, Scale(rect));
+}
+
+irr::core::dimension2du
+ModularScaledCanvas::GetTextDimension(const ModularFont &font,
+                                      const std::wstring &text) {
+  return canvas.GetTextDimension(font, text);
+}
+
+int ModularScaledCanvas::GetCharAdvance(const ModularFont &font, wchar_t ch,
+                                        wchar_t previous) {
+  return canvas.GetCharAdvance(font, ch, previous);
+}
+
+void ModularScaledCanvas::DrawText(const ModularFont &font,
+                                   const std::wstring &text,
+                                   const irr::core::recti &rect,
+                                   irr::video::SColor color, bool hcenter,
+                                   bool vcenter, float scaleX) {
+  const ModularFont scaled{
+      font.face,
+      std::max<uint32_t>(
+          static_cast<uint32_t>(std::lround(font.size * scaleY)), 1)};
+  // Hinting rounds every advance, so the small font can come out wider than
+  // the layout measured. Squeeze it back into the scaled width.
+  const float layoutWidth =
+      canvas.GetTextDimension(font, text).Width * this->scaleX * scaleX;
+  const float drawnWidth =
+      static_cast<float>(canvas.GetTextDimension(scaled, text).Width);
+  if (drawnWidth * scaleX > layoutWidth && drawnWidth > 0.0f)
+    scaleX = layoutWidth / drawnWidth;
+  canvas.DrawText(scaled, text, Scale(rect), color, hcenter, vcenter, scaleX);
+}
+
+} // namespace ygo
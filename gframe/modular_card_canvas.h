@@ -0,0 +1,328 @@
+#ifndef MODULAR_CARD_CANVAS_H
+#define MODULAR_CARD_CANVAS_H
+
+#include "config.h"
+#include "epro_mutex.h"
+#include "text_types.h"
+#include <array>
+#include <irrlicht.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+typedef struct FT_LibraryRec_ *FT_Library;
+typedef struct FT_FaceRec_ *FT_Face;
+
+namespace irr {
+namespace gui {
+class CGUITTFont;
+} // namespace gui
+namespace io {
+class IReadFile;
+} // namespace io
+} // namespace irr
+
+namespace ygo {
+
+// Font faces used on modular cards. A face can be requested at any pixel size,
+// canvases create the sized font the first time it is used.
+enum class ModularFace : uint8_t {
+  CARD_NAME,     // matrix_bold_small_caps.ttf
+  EFFECT,        // StoneSerifStd-Medium.ttf
+  EFFECT_ITALIC, // StoneSerifITC-MediumItalic.ttf
+  STATS,         // MatrixRegular.ttf
+  TYPE_LINE,     // StoneSerifSmallCapsBold.ttf
+  COUNT
+};
+
+struct ModularFont {
+  ModularFace face;
+  uint32_t size;
+};
+
+epro::path_stringview GetModularFacePath(ModularFace face);
+
+// Drawing surface for ModularCardRenderer. The layout code only goes through
+// this interface, so the same card can be composited by the GPU into a render
+// target or in software into an IImage on any thread.
+class ModularCanvas {
+public:
+  virtual ~ModularCanvas() = default;
+
+  // Draws src of the image at path (all of it if src is null) scaled into
+  // dest, blending with the image's alpha channel
+  virtual void DrawImage(const std::string &path,
+                         const irr::core::recti &dest,
+                         const irr::core::recti *src = nullptr) = 0;
+
+  // Same as DrawImage for the card art given to the canvas, if any
+  virtual void DrawArt(const irr::core::recti &dest,
+                       const irr::core::recti &src) = 0;
+  virtual irr::core::dimension2du GetArtSize() const = 0;
+
+  virtual void FillRect(irr::video::SColor color,
+                        const irr::core::recti &rect) = 0;
+
+  // Text is measured and drawn with the same rules as CGUITTFont, so layouts
+  // match between canvases. A scaleX below 1 squeezes the text horizontally
+  // towards the left edge of rect.
+  virtual irr::core::dimension2du GetTextDimension(const ModularFont &font,
+                                                   const std::wstring &text) = 0;
+  // Advance of ch plus its kerning against previous (0 at the start of a
+  // line), the amounts GetTextDimension adds up for every character
+  virtual int GetCharAdvance(const ModularFont &font, wchar_t ch,
+                             wchar_t previous) = 0;
+  virtual void DrawText(const ModularFont &font, const std::wstring &text,
+                        const irr::core::recti &rect, irr::video::SColor color,
+                        bool hcenter = false, bool vcenter = false,
+                        float scaleX = 1.0f) = 0;
+};
+
+// Frame and icon images plus font files shared by the software canvases.
+// Everything is loaded on first use under a lock and never modified after,
+// so the returned data can be read from any thread.
+class ModularSoftwareAssets {
+public:
+  explicit ModularSoftwareAssets(irr::video::IVideoDriver *driver);
+  ~ModularSoftwareAssets();
+
+  // The image at path converted to A8R8G8B8, or nullptr if it can't be loaded
+  irr::video::IImage *GetImage(const std::string &path);
+
+  // The raw font file of face, empty if it can't be read
+  const std::vector<char> &GetFontData(ModularFace face);
+
+  // Decodes the file at path into a new A8R8G8B8 image the caller must drop
+  irr::video::IImage *LoadImage(epro::path_stringview path);
+  irr::video::IImage *LoadImage(irr::io::IReadFile *file);
+
+private:
+  irr::video::IVideoDriver *driver;
+  epro::mutex mutex;
+  std::map<std::string, irr::video::IImage *> images;
+  std::array<std::unique_ptr<std::vector<char>>,
+             static_cast<size_t>(ModularFace::COUNT)>
+      fontData;
+
+  // Takes over image, returning it or a converted copy
+  irr::video::IImage *ToA8R8G8B8(irr::video::IImage *image);
+};
+
+// FreeType rasterizer with its own library and faces, so every worker thread
+// can draw text without touching the fonts of the GUI. Not thread safe, use
+// one per thread.
+class ModularGlyphRasterizer {
+public:
+  struct Glyph {
+    uint32_t index; // FreeType glyph index, 0 if the face lacks the glyph
+    int left;    // Bitmap offset from the pen position
+    int top;     // Bitmap rows above the baseline
+    int width;
+    int rows;
+    int advance; // Whole pixels, like CGUITTFont
+    bool valid;
+    std::vector<uint8_t> coverage;
+  };
+  struct SizedFace {
+    FT_Face face;
+    int ascender;
+    int lineHeight;
+    std::unordered_map<uint32_t, Glyph> glyphs;
+    std::unordered_map<uint32_t, int> advances;
+  };
+
+  explicit ModularGlyphRasterizer(ModularSoftwareAssets &assets);
+  ~ModularGlyphRasterizer();
+
+  // The face at the given size, or nullptr if its font can't be loaded
+  SizedFace *GetFace(const ModularFont &font);
+  const Glyph &GetGlyph(SizedFace &face, uint32_t ch);
+  // Same as GetGlyph(face, ch).advance, without rasterizing the glyph when
+  // it isn't already
+  int GetAdvance(SizedFace &face, uint32_t ch);
+  int GetKerning(SizedFace &face, uint32_t ch, uint32_t previous);
+
+  // Text metrics for the canvases, see ModularCanvas
+  irr::core::dimension2du GetTextDimension(const ModularFont &font,
+                                           const std::wstring &text);
+  int GetCharAdvance(const ModularFont &font, wchar_t ch, wchar_t previous);
+
+private:
+  ModularSoftwareAssets &assets;
+  FT_Library library;
+  std::map<std::pair<ModularFace, uint32_t>, SizedFace> faces;
+
+  static uint32_t GetIndex(SizedFace &face, uint32_t ch);
+};
+
+// The small sprites of the modular cards (attribute, type and spell/trap
+// icons, level and rank stars, link arrows) packed into a few textures, so
+// the GPU canvas can draw all the sprites of a card in one batch instead of
+// switching textures for every one of them. Frames are left out, they're as
+// large as the card and drawn once per card anyway.
+class ModularTextureAtlas {
+public:
+  struct Sprite {
+    irr::video::ITexture *texture;
+    irr::core::recti rect; // Position in texture
+  };
+
+  ModularTextureAtlas(irr::video::IVideoDriver *driver,
+                      ModularSoftwareAssets &assets);
+
+  // Packs every png under dir no larger than MAX_SPRITE_SIZE, keyed by its
+  // path as the renderer spells it (dir + file name)
+  void Build(const std::string &dir);
+  const Sprite *Find(const std::string &path) const;
+
+private:
+  static constexpr irr::u32 PAGE_SIZE = 1024;
+  static constexpr irr::u32 MAX_SPRITE_SIZE = 256;
+  // Every sprite is surrounded by a copy of its edge pixels, so bilinear
+  // filtering never samples its neighbours
+  static constexpr irr::u32 PADDING = 1;
+
+  irr::video::IVideoDriver *driver;
+  ModularSoftwareAssets &assets;
+  std::unordered_map<std::string, Sprite> sprites;
+};
+
+// Canvas drawing with the video driver into a render target. Main thread only.
+// Text is measured with a rasterizer of its own, so trying out sizes never
+// creates a TrueType font, those are only made for the sizes that get drawn.
+// Sprites from the atlas are queued and drawn together, as one triangle list
+// per atlas page, whenever something else has to be drawn over them.
+class ModularGpuCanvas final : public ModularCanvas {
+public:
+  ModularGpuCanvas(irr::video::IVideoDriver *driver,
+                   irr::gui::IGUIEnvironment *env);
+  ~ModularGpuCanvas() override;
+
+  // Sets the art of the card being drawn into the current render target
+  void Begin(irr::video::ITexture *art);
+  // Draws the queued sprites, to be called before the render target changes
+  void End();
+
+  void DrawImage(const std::string &path, const irr::core::recti &dest,
+                 const irr::core::recti *src = nullptr) override;
+  void DrawArt(const irr::core::recti &dest,
+               const irr::core::recti &src) override;
+  irr::core::dimension2du GetArtSize() const override;
+  void FillRect(irr::video::SColor color,
+                const irr::core::recti &rect) override;
+  irr::core::dimension2du GetTextDimension(const ModularFont &font,
+                                           const std::wstring &text) override;
+  int GetCharAdvance(const ModularFont &font, wchar_t ch,
+                     wchar_t previous) override;
+  void DrawText(const ModularFont &font, const std::wstring &text,
+                const irr::core::recti &rect, irr::video::SColor color,
+                bool hcenter = false, bool vcenter = false,
+                float scaleX = 1.0f) override;
+
+private:
+  irr::video::IVideoDriver *driver;
+  irr::gui::IGUIEnvironment *env;
+  irr::video::ITexture *art;
+
+  std::map<std::string, irr::video::ITexture *> textures;
+  // Fonts by face and pixel size. The sizes follow the size cards are
+  // rendered at, so past MAX_FONTS the least recently used one is dropped.
+  struct CachedFont {
+    irr::gui::CGUITTFont *font;
+    uint64_t lastUse;
+  };
+  static constexpr size_t MAX_FONTS = 24;
+  std::map<std::pair<ModularFace, uint32_t>, CachedFont> fonts;
+  uint64_t fontUses;
+  ModularSoftwareAssets assets;
+  ModularGlyphRasterizer metrics;
+  ModularTextureAtlas atlas;
+  bool atlasBuilt;
+
+  // Sprites waiting to be drawn, all from batchTexture
+  irr::video::ITexture *batchTexture;
+  std::vector<irr::video::S3DVertex> batchVertices;
+  std::vector<irr::u16> batchIndices;
+
+  irr::video::ITexture *GetTexture(const std::string &path);
+  irr::gui::CGUITTFont *GetFont(const ModularFont &font);
+  void Flush();
+};
+
+// Canvas compositing into an A8R8G8B8 IImage on the calling thread.
+class ModularSoftwareCanvas final : public ModularCanvas {
+public:
+  ModularSoftwareCanvas(irr::video::IImage *target, irr::video::IImage *art,
+                        ModularSoftwareAssets &assets,
+                        ModularGlyphRasterizer &glyphs);
+  ~ModularSoftwareCanvas() override;
+
+  void DrawImage(const std::string &path, const irr::core::recti &dest,
+                 const irr::core::recti *src = nullptr) override;
+  void DrawArt(const irr::core::recti &dest,
+               const irr::core::recti &src) override;
+  irr::core::dimension2du GetArtSize() const override;
+  void FillRect(irr::video::SColor color,
+                const irr::core::recti &rect) override;
+  irr::core::dimension2du GetTextDimension(const ModularFont &font,
+                                           const std::wstring &text) override;
+  int GetCharAdvance(const ModularFont &font, wchar_t ch,
+                     wchar_t previous) override;
+  void DrawText(const ModularFont &font, const std::wstring &text,
+                const irr::core::recti &rect, irr::video::SColor color,
+                bool hcenter = false, bool vcenter = false,
+                float scaleX = 1.0f) override;
+
+private:
+  irr::video::IImage *target;
+  irr::video::IImage *art;
+  ModularSoftwareAssets &assets;
+  ModularGlyphRasterizer &glyphs;
+  uint32_t *pixels;
+  uint32_t pitch; // In pixels
+  irr::core::dimension2du size;
+
+  void Blit(irr::video::IImage *image, const irr::core::recti &dest,
+            const irr::core::recti &src);
+  void BlendGlyph(const ModularGlyphRasterizer::Glyph &glyph, float x, int y,
+                  float scaleX, irr::video::SColor color);
+};
+
+// Canvas drawing the base layout scaled by (scaleX, scaleY) into another
+// canvas, so a card can be rendered straight at the size it is displayed at.
+// Text is still measured at the base sizes, so lines break the same way at
+// every resolution, and drawn with fonts rasterized at the scaled size.
+class ModularScaledCanvas final : public ModularCanvas {
+public:
+  ModularScaledCanvas(ModularCanvas &canvas, float scaleX, float scaleY);
+
+  void DrawImage(const std::string &path, const irr::core::recti &dest,
+                 const irr::core::recti *src = nullptr) override;
+  void DrawArt(const irr::core::recti &dest,
+               const irr::core::recti &src) override;
+  irr::core::dimension2du GetArtSize() const override;
+  void FillRect(irr::video::SColor color,
+                const irr::core::recti &rect) override;
+  irr::core::dimension2du GetTextDimension(const ModularFont &font,
+                                           const std::wstring &text) override;
+  int GetCharAdvance(const ModularFont &font, wchar_t ch,
+                     wchar_t previous) override;
+  void DrawText(const ModularFont &font, const std::wstring &text,
+                const irr::core::recti &rect, irr::video::SColor color,
+                bool hcenter = false, bool vcenter = false,
+                float scaleX = 1.0f) override;
+
+private:
+  ModularCanvas &canvas;
+  float scaleX;
+  float scaleY;
+
+  irr::core::recti Scale(const irr::core::recti &rect) const;
+};
+
+} // namespace ygo
+
+#endif // MODULAR_CARD_CANVAS_H
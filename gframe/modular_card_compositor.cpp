@@ -0,0 +1,181 @@
+#include "modular_card_compositor.h"
+#include "fmt.h"
+#include "game_config.h"
+#include "logging.h"
+#include "utils.h"
+#include <IImage.h>
+#include <ITexture.h>
+#include <IVideoDriver.h>
+#include <algorithm>
+
+namespace ygo {
+
+ModularCardCompositor::ModularCardCompositor(
+    irr::IrrlichtDevice *device, const ModularCardRenderer *renderer,
+    ModularCardCache *cache, const ModularArtManager *artManager)
+    : driver(device->getVideoDriver()), renderer(renderer), cache(cache),
+      artManager(artManager), assets(driver), diskCache(driver, artManager),
+      uploadCount(0), generation(0), stopThreads(false) {
+  const int count = std::max<int>(gGameConfig->imageLoadThreads, 1);
+  threads.reserve(count);
+  for (int i = 0; i < count; ++i)
+    threads.emplace_back(&ModularCardCompositor::ComposeThread, this);
+}
+
+ModularCardCompositor::~ModularCardCompositor() {
+  {
+    std::lock_guard<epro::mutex> lck(mutex);
+    stopThreads = true;
+    cv.notify_all();
+  }
+  for (auto &thread : threads)
+    thread.join();
+  for (auto &result : results)
+    result.image->drop();
+}
+
+void ModularCardCompositor::ComposeAsync(const ModularCardCacheKey &key,
+                                         CardPtr card,
+                                         epro::path_string artPath,
+                                         const irr::core::dimension2du &size,
+                                         Callback callback, bool prefetch) {
+  if (callback)
+    pendingCallbacks[key].push_back(std::move(callback));
+  std::lock_guard<epro::mutex> lck(mutex);
+  if (!inFlight.insert(key).second) {
+    if (prefetch)
+      return;
+    // Someone is waiting for a prefetched card now, bump it if it's still
+    // queued
+    auto it = std::find_if(jobs.begin(), jobs.end(),
+                           [&key](const Job &job) { return job.key == key; });
+    if (it != jobs.end() && it != jobs.begin()) {
+      Job job = std::move(*it);
+      jobs.erase(it);
+      jobs.push_front(std::move(job));
+    }
+    return;
+  }
+  Job job{key, std::move(card), std::move(artPath), size, generation};
+  if (prefetch)
+    jobs.push_back(std::move(job));
+  else
+    jobs.push_front(std::move(job));
+  cv.notify_one();
+}
+
+bool ModularCardCompositor::IsComposing(const ModularCardCacheKey &key) {
+  std::lock_guard<epro::mutex> lck(mutex);
+  return inFlight.find(key) != inFlight.end();
+}
+
+size_t ModularCardCompositor::GetQueuedCount() {
+  std::lock_guard<epro::mutex> lck(mutex);
+  return jobs.size();
+}
+
+void ModularCardCompositor::Update() {
+  std::deque<Result> done;
+  {
+    std::lock_guard<epro::mutex> lck(mutex);
+    if (results.empty())
+      return;
+    done.swap(results);
+  }
+  // Same mipmap setup as the render targets, so the uploaded cards scale
+  // down just as smoothly
+  const bool prevMipMap =
+      driver->getTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS);
+  driver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS, true);
+  for (auto &result : done) {
+    if (result.generation != generation) {
+      // Cleared while it was being composited
+      result.image->drop();
+      continue;
+    }
+    const auto name =
+        epro::format("ModularCard_{}_{}", result.key.code, uploadCount++);
+    irr::video::ITexture *texture;
+    {
+      ModularRenderStats::Timer timer(renderer->GetStats(),
+                                      ModularRenderStats::UPLOAD);
+      texture = driver->addTexture(
+          {name.data(), static_cast<irr::u32>(name.size())}, result.image);
+    }
+    result.image->drop();
+    if (texture)
+      cache->Insert(result.key, texture);
+    auto it = pendingCallbacks.find(result.key);
+    if (it == pendingCallbacks.end())
+      continue;
+    auto callbacks = std::move(it->second);
+    pendingCallbacks.erase(it);
+    for (auto &callback : callbacks)
+      callback(texture);
+  }
+  driver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS, prevMipMap);
+}
+
+void ModularCardCompositor::Clear() {
+  std::lock_guard<epro::mutex> lck(mutex);
+  ++generation;
+  jobs.clear();
+  inFlight.clear();
+  pendingCallbacks.clear();
+}
+
+void ModularCardCompositor::ComposeThread() {
+  Utils::SetThreadName("ModularCompose");
+  // FreeType faces can't be shared between threads, each worker rasterizes
+  // with its own
+  ModularGlyphRasterizer glyphs(assets);
+  std::unique_lock<epro::mutex> lck(mutex);
+  while (true) {
+    while (jobs.empty() && !stopThreads)
+      cv.wait(lck);
+    if (stopThreads)
+      return;
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+    lck.unlock();
+
+    const irr::core::dimension2du &size = job.size;
+    const bool useDiskCache = gGameConfig->modularDiskCache;
+    uint64_t fingerprint = 0;
+    irr::video::IImage *image = nullptr;
+    if (useDiskCache) {
+      fingerprint = diskCache.GetFingerprint(*job.card, job.artPath, size);
+      image = diskCache.Load(job.key.code, fingerprint);
+      if (image && image->getDimension() != size) {
+        image->drop();
+        image = nullptr;
+      }
+    }
+    if (!image) {
+      irr::video::IImage *art = nullptr;
+      if (!job.artPath.empty())
+        art = artManager->LoadFittedArt(job.key.code, job.artPath,
+                                        job.card->isPendulum);
+      image = driver->createImage(irr::video::ECF_A8R8G8B8, size);
+      image->fill(irr::video::SColor(0, 0, 0, 0));
+      {
+        ModularSoftwareCanvas canvas(image, art, assets, glyphs);
+        renderer->Compose(canvas, *job.card, size);
+      }
+      if (art)
+        art->drop();
+      if (useDiskCache)
+        diskCache.Store(job.key.code, fingerprint, image);
+    }
+
+    lck.lock();
+    if (job.generation == generation) {
+      inFlight.erase(job.key);
+      results.push_back(Result{job.key, image, job.generation});
+    } else {
+      image->drop();
+    }
+  }
+}
+
+} // namespace ygo
@@ -0,0 +1,106 @@
+#ifndef MODULAR_CARD_COMPOSITOR_H
+#define MODULAR_CARD_COMPOSITOR_H
+
+#include "config.h"
+#include "epro_condition_variable.h"
+#include "epro_mutex.h"
+#include "epro_thread.h"
+#include "modular_art_manager.h"
+#include "modular_card_cache.h"
+#include "modular_card_canvas.h"
+#include "modular_card_disk_cache.h"
+#include "modular_card_renderer.h"
+#include "text_types.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <irrlicht.h>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ygo {
+
+// Composites modular cards in software on a pool of worker threads. The art
+// is decoded and the card drawn into an IImage off the main thread, Update
+// then only has to upload the finished images and store them in the cache.
+class ModularCardCompositor {
+public:
+  using Callback = std::function<void(irr::video::ITexture *)>;
+  using CardPtr = std::shared_ptr<const ModularCardData>;
+
+  // The art paths given to ComposeAsync are opened through artManager
+  ModularCardCompositor(irr::IrrlichtDevice *device,
+                        const ModularCardRenderer *renderer,
+                        ModularCardCache *cache,
+                        const ModularArtManager *artManager);
+  ~ModularCardCompositor();
+
+  // Queues card to be composited at size with the art at artPath (empty for
+  // the placeholder). Once it's done, Update stores it in the cache under key
+  // and calls callback with the texture. The key must identify the size too.
+  // Requests for a key already queued or being composited share the same job.
+  // Prefetches wait behind every other job, the rest go to the front of the
+  // queue.
+  void ComposeAsync(const ModularCardCacheKey &key, CardPtr card,
+                    epro::path_string artPath,
+                    const irr::core::dimension2du &size,
+                    Callback callback = nullptr, bool prefetch = false);
+
+  bool IsComposing(const ModularCardCacheKey &key);
+
+  // Jobs waiting for a worker
+  size_t GetQueuedCount();
+  size_t GetThreadCount() const { return threads.size(); }
+
+  // Main thread: upload finished cards and run their callbacks
+  void Update();
+
+  // Drops queued jobs and discards the ones in progress, to be called when
+  // the card data or strings they were built from change
+  void Clear();
+
+private:
+  struct Job {
+    ModularCardCacheKey key;
+    CardPtr card;
+    epro::path_string artPath;
+    irr::core::dimension2du size;
+    int generation;
+  };
+  struct Result {
+    ModularCardCacheKey key;
+    irr::video::IImage *image;
+    int generation;
+  };
+
+  irr::video::IVideoDriver *driver;
+  const ModularCardRenderer *renderer;
+  ModularCardCache *cache;
+  const ModularArtManager *artManager;
+  ModularSoftwareAssets assets;
+  ModularCardDiskCache diskCache;
+
+  // Main thread only
+  std::unordered_map<ModularCardCacheKey, std::vector<Callback>,
+                     ModularCardCacheKeyHash>
+      pendingCallbacks;
+  uint32_t uploadCount;
+
+  // Shared with the workers, guarded by mutex
+  std::unordered_set<ModularCardCacheKey, ModularCardCacheKeyHash> inFlight;
+  std::deque<Job> jobs;
+  std::deque<Result> results;
+  epro::mutex mutex;
+  epro::condition_variable cv;
+  std::atomic<int> generation;
+  bool stopThreads;
+  std::vector<epro::thread> threads;
+
+  void ComposeThread();
+};
+
+} // namespace ygo
+
+#endif // MODULAR_CARD_COMPOSITOR_H
@@ -0,0 +1,175 @@
+#include "modular_card_disk_cache.h"
+#include "epro_thread.h"
+#include "file_stream.h"
+#include "fmt.h"
+#include "modular_art_manager.h"
+#include "utils.h"
+#include <IImage.h>
+#include <IVideoDriver.h>
+#include <functional>
+#include <string>
+
+namespace ygo {
+
+namespace {
+
+// FNV-1a, stable across runs and platforms unlike std::hash
+class Fingerprint {
+public:
+  void Add(const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      value ^= bytes[i];
+      value *= 0x100000001b3ULL;
+    }
+  }
+  template <typename T> void Add(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "use AddString for strings");
+    Add(&value, sizeof(value));
+  }
+  // Fixed width characters, wchar_t is 2 bytes on Windows and 4 elsewhere
+  template <typename C> void AddString(epro::basic_string_view<C> text) {
+    Add(static_cast<uint64_t>(text.size()));
+    for (auto c : text)
+      Add(static_cast<uint32_t>(c));
+  }
+  uint64_t Get() const { return value; }
+
+private:
+  uint64_t value = 0xcbf29ce484222325ULL;
+};
+
+int64_t GetFileSize(epro::path_stringview path) {
+  FileStream file{epro::path_string{path}, FileStream::in | FileStream::binary};
+  if (!file.is_open())
+    return -1;
+  file.seekg(0, std::ios::end);
+  return static_cast<int64_t>(file.tellg());
+}
+
+} // namespace
+
+ModularCardDiskCache::ModularCardDiskCache(
+    irr::video::IVideoDriver *driver, const ModularArtManager *artManager)
+    : driver(driver), artManager(artManager), dir(EPRO_TEXT("./pics_modular/rendered/")),
+      assetsHashed(false), assetsHash(0) {
+  Utils::MakeDirectory(EPRO_TEXT("./pics_modular/"));
+  Utils::MakeDirectory(dir);
+}
+
+uint64_t ModularCardDiskCache::GetAssetsHash() {
+  std::lock_guard<epro::mutex> lck(assetsMutex);
+  if (assetsHashed)
+    return assetsHash;
+  // Names and sizes are enough to notice replaced frames, icons or fonts
+  // without reading every file on startup
+  Fingerprint hash;
+  const epro::path_stringview root = EPRO_TEXT("./textures/modular/");
+  for (const auto &file : Utils::FindFiles(root, {}, 4)) {
+    hash.AddString<epro::path_char>(file);
+    hash.Add(GetFileSize(epro::format(EPRO_TEXT("{}{}"), root, file)));
+  }
+  assetsHash = hash.Get();
+  assetsHashed = true;
+  return assetsHash;
+}
+
+uint64_t ModularCardDiskCache::GetFingerprint(
+    const ModularCardData &card, epro::path_stringview artPath,
+    const irr::core::dimension2du &size) {
+  Fingerprint hash;
+  hash.Add(RENDERER_VERSION);
+  hash.Add(GetAssetsHash());
+  hash.Add(size.Width);
+  hash.Add(size.Height);
+  // Art in the pack has no file of its own, its place in the pack changes
+  // when it's replaced instead of the write time
+  hash.AddString(artPath);
+  ModularArtManager::ArtStat artStat{};
+  const bool hasArt =
+      !artPath.empty() && artManager->GetArtStat(artPath, artStat);
+  hash.Add(hasArt);
+  hash.Add(artStat.size);
+  hash.Add(artStat.mtime);
+  hash.Add(artStat.offset);
+
+  // Everything the renderer reads from the card
+  hash.AddString<wchar_t>(card.cardName);
+  hash.Add(card.cardType);
+  hash.Add(card.cardSubtype);
+  hash.AddString<wchar_t>(card.cardEffect);
+  hash.Add(card.cardId);
+  hash.Add(card.monsterAttribute);
+  hash.AddString<wchar_t>(card.monsterType);
+  hash.AddString<wchar_t>(card.monsterTypeLine);
+  hash.Add(card.monsterLevelRankLink);
+  hash.Add(card.monsterATK);
+  hash.Add(card.monsterDEF);
+  hash.AddString<wchar_t>(card.monsterATKStr);
+  hash.AddString<wchar_t>(card.monsterDEFStr);
+  hash.Add(static_cast<uint64_t>(card.monsterAbilities.size()));
+  for (const auto &ability : card.monsterAbilities)
+    hash.AddString<wchar_t>(ability);
+  hash.Add(static_cast<uint64_t>(card.linkArrows.size()));
+  for (auto arrow : card.linkArrows)
+    hash.Add(arrow);
+  hash.Add(card.isPendulum);
+  hash.Add(card.pendulumScale);
+  hash.AddString<wchar_t>(card.pendulumEffect);
+  hash.Add(card.isNormalMonster);
+  return hash.Get();
+}
+
+epro::path_string ModularCardDiskCache::GetPath(uint32_t code,
+                                                epro::path_stringview ext) const {
+  return epro::format(EPRO_TEXT("{}{}{}"), dir, code, ext);
+}
+
+irr::video::IImage *ModularCardDiskCache::Load(uint32_t code,
+                                               uint64_t fingerprint) {
+  std::lock_guard<epro::mutex> lck(codeMutexes[code % codeMutexes.size()]);
+  {
+    FileStream key{GetPath(code, EPRO_TEXT(".key")), FileStream::in};
+    std::string stored;
+    if (!key.is_open() || !(key >> stored) ||
+        stored != epro::format("{:016x}", fingerprint))
+      return nullptr;
+  }
+  const auto path = GetPath(code, EPRO_TEXT(".png"));
+  irr::video::IImage *image = driver->createImageFromFile(
+      {path.data(), static_cast<irr::u32>(path.size())});
+  if (!image || image->getColorFormat() == irr::video::ECF_A8R8G8B8)
+    return image;
+  irr::video::IImage *converted =
+      driver->createImage(irr::video::ECF_A8R8G8B8, image->getDimension());
+  image->copyTo(converted);
+  image->drop();
+  return converted;
+}
+
+void ModularCardDiskCache::Store(uint32_t code, uint64_t fingerprint,
+                                 irr::video::IImage *image) {
+  // The key goes last, a card interrupted halfway is never loaded
+  const auto keyPath = GetPath(code, EPRO_TEXT(".key"));
+  // Written under a name of this thread's own, like the other caches do
+  const auto tmpPath = GetPath(
+      code, epro::format(EPRO_TEXT(".{}.tmp.png"),
+                         std::hash<epro::thread::id>{}(
+                             epro::this_thread::get_id())));
+  const auto path = GetPath(code, EPRO_TEXT(".png"));
+  std::lock_guard<epro::mutex> lck(codeMutexes[code % codeMutexes.size()]);
+  Utils::FileDelete(keyPath);
+  // FileMove doesn't replace an existing file on Windows
+  Utils::FileDelete(path);
+  if (!driver->writeImageToFile(
+          image, {tmpPath.data(), static_cast<irr::u32>(tmpPath.size())}) ||
+      !Utils::FileMove(tmpPath, path)) {
+    Utils::FileDelete(tmpPath);
+    return;
+  }
+  FileStream key{keyPath, FileStream::out | FileStream::trunc};
+  key << epro::format("{:016x}", fingerprint);
+}
+
+} // namespace ygo
@@ -0,0 +1,60 @@
+#ifndef MODULAR_CARD_DISK_CACHE_H
+#define MODULAR_CARD_DISK_CACHE_H
+
+#include "config.h"
+#include "epro_mutex.h"
+#include "modular_card_renderer.h"
+#include "text_types.h"
+#include <array>
+#include <cstdint>
+#include <irrlicht.h>
+
+namespace ygo {
+
+class ModularArtManager;
+
+// Finished modular cards saved under pics_modular/rendered/, so a card
+// composited in an earlier session only needs to be decoded. Every card is
+// stored as {code}.png next to {code}.key, a fingerprint of everything the
+// pixels depend on besides the code: the card data built from the database
+// row and strings, the art file, the output size, the renderer version and
+// the files under textures/modular/. A card whose fingerprint changed is
+// composited again and overwrites the stale files. Thread safe, loads and
+// stores of the same code are serialized so a card and its key always match.
+class ModularCardDiskCache {
+public:
+  // Bump whenever the layout changes in a way the fingerprint can't see
+  static constexpr uint32_t RENDERER_VERSION = 2;
+
+  // Art paths given to GetFingerprint are looked up through artManager
+  ModularCardDiskCache(irr::video::IVideoDriver *driver,
+                       const ModularArtManager *artManager);
+
+  uint64_t GetFingerprint(const ModularCardData &card,
+                          epro::path_stringview artPath,
+                          const irr::core::dimension2du &size);
+
+  // The stored image of code if its fingerprint matches, nullptr otherwise.
+  // The caller must drop the image.
+  irr::video::IImage *Load(uint32_t code, uint64_t fingerprint);
+  void Store(uint32_t code, uint64_t fingerprint, irr::video::IImage *image);
+
+private:
+  irr::video::IVideoDriver *driver;
+  const ModularArtManager *artManager;
+  const epro::path_string dir;
+
+  epro::mutex assetsMutex;
+  bool assetsHashed;
+  uint64_t assetsHash;
+
+  // Striped by code, the same card can be finished at two sizes at once
+  std::array<epro::mutex, 16> codeMutexes;
+
+  uint64_t GetAssetsHash();
+  epro::path_string GetPath(uint32_t code, epro::path_stringview ext) const;
+};
+
+} // namespace ygo
+
+#endif // MODULAR_CARD_DISK_CACHE_H
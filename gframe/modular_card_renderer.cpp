@@ -1,5 +1,6 @@
 #include "modular_card_renderer.h"
 #include "CGUITTFont/CGUITTFont.h"
+#include "common.h"
 #include "data_manager.h"
 #include "game_config.h"
 #include "image_manager.h"
@@ -9,6 +10,7 @@
 #include <IVideoDriver.h>
 
 #include <cmath>
+#include <cwchar>
 
 namespace ygo {
 
@@ -21,10 +23,293 @@ ModularCardData::ModularCardData()
       monsterATKStr(L"0"), monsterDEFStr(L"0"), isPendulum(false),
       pendulumScale(0), pendulumEffect(L""), isNormalMonster(false) {}
 
+ModularCardData ConvertToModularData(uint32_t code) {
+  ModularCardData data;
+
+  const CardDataC *cardData = gDataManager->GetCardData(code);
+  if (!cardData) {
+    return data;
+  }
+
+  // Basic info
+  data.cardName = std::wstring(gDataManager->GetName(code));
+  data.cardEffect = std::wstring(gDataManager->GetText(code));
+  data.cardId = code; // Store card ID for display
+
+  // Note: StoneSerifStd-Medium.ttf is used for effect text.
+  // Converting Black Circle (● U+25CF) to Bullet (• U+2022) as permitted by
+  // font.
+  std::wstring &effect = data.cardEffect;
+  size_t pos = 0;
+  while ((pos = effect.find(L'\u25CF', pos)) != std::wstring::npos) {
+    effect.replace(pos, 1, L"\u2022");
+    pos += 1;
+  }
+  // std::wstring &effect = data.cardEffect;
+  // size_t pos = 0;
+
+  // Strip unofficial OCG disclaimer text that EDOPro adds
+  // e.g., "* The above text is unofficial and describes the card's
+  // functionality in the OCG"
+  const std::wstring unofficialMarker = L"* The above text is unofficial";
+  pos = effect.find(unofficialMarker);
+  if (pos != std::wstring::npos) {
+    // Remove everything from the marker to the end, including any preceding
+    // newlines
+    while (pos > 0 && (effect[pos - 1] == L'\n' || effect[pos - 1] == L'\r')) {
+      pos--;
+    }
+    effect = effect.substr(0, pos);
+  }
+
+  // Determine card type
+  if (cardData->type & TYPE_MONSTER) {
+    data.cardType = CardType::MONSTER;
+
+    // Determine subtype
+    if (cardData->type & TYPE_LINK) {
+      data.cardSubtype = CardSubtype::MONSTER_LINK;
+    } else if (cardData->type & TYPE_XYZ) {
+      data.cardSubtype = CardSubtype::MONSTER_XYZ;
+    } else if (cardData->type & TYPE_SYNCHRO) {
+      data.cardSubtype = CardSubtype::MONSTER_SYNCHRO;
+    } else if (cardData->type & TYPE_FUSION) {
+      data.cardSubtype = CardSubtype::MONSTER_FUSION;
+    } else if (cardData->type & TYPE_RITUAL) {
+      data.cardSubtype = CardSubtype::MONSTER_RITUAL;
+    } else if (cardData->type & TYPE_EFFECT) {
+      data.cardSubtype = CardSubtype::MONSTER_EFFECT;
+    } else {
+      data.cardSubtype = CardSubtype::MONSTER_NORMAL;
+    }
+    // Monster stats
+    data.monsterLevelRankLink = cardData->level & 0xff;
+
+    // Check if this is a Normal Monster (for italic flavor text)
+    data.isNormalMonster = (cardData->type & TYPE_NORMAL) != 0;
+    data.monsterATK = cardData->attack;
+    data.monsterDEF = cardData->defense;
+    data.monsterATKStr =
+        (cardData->attack < 0) ? L"?" : std::to_wstring(cardData->attack);
+    data.monsterDEFStr =
+        (cardData->defense < 0) ? L"?" : std::to_wstring(cardData->defense);
+
+    // Attribute
+    switch (cardData->attribute) {
+    case ATTRIBUTE_DARK:
+      data.monsterAttribute = MonsterAttribute::DARK;
+      break;
+    case ATTRIBUTE_LIGHT:
+      data.monsterAttribute = MonsterAttribute::LIGHT;
+      break;
+    case ATTRIBUTE_EARTH:
+      data.monsterAttribute = MonsterAttribute::EARTH;
+      break;
+    case ATTRIBUTE_WATER:
+      data.monsterAttribute = MonsterAttribute::WATER;
+      break;
+    case ATTRIBUTE_FIRE:
+      data.monsterAttribute = MonsterAttribute::FIRE;
+      break;
+    case ATTRIBUTE_WIND:
+      data.monsterAttribute = MonsterAttribute::WIND;
+      break;
+    case ATTRIBUTE_DIVINE:
+      data.monsterAttribute = MonsterAttribute::DIVINE;
+      break;
+    default:
+      data.monsterAttribute = MonsterAttribute::DARK;
+      break;
+    }
+
+    // Pendulum
+    if (cardData->type & TYPE_PENDULUM) {
+      data.isPendulum = true;
+      data.pendulumScale = cardData->lscale;
+
+      // Split pendulum effect from monster effect in the text
+      // EDOPro text format: "[ Pendulum Effect ]\n...\n[ Monster Effect ]\n..."
+      // or similar
+      std::wstring fullText = data.cardEffect;
+
+      // Look for common separators
+      const wchar_t *pendulumMarkers[] = {
+          L"[ Pendulum Effect ]",
+          L"[Pendulum Effect]",
+          L"----------------------------------------\n",
+          L"──────────────────────────────────────",
+      };
+      const wchar_t *monsterMarkers[] = {
+          L"[ Monster Effect ]",
+          L"[Monster Effect]",
+          L"[ Flavor Text ]",
+          L"[Flavor Text]",
+      };
+
+      size_t pendulumStart = std::wstring::npos;
+      size_t monsterStart = std::wstring::npos;
+
+      // Find monster effect marker
+      for (const wchar_t *marker : monsterMarkers) {
+        size_t pos = fullText.find(marker);
+        if (pos != std::wstring::npos) {
+          monsterStart = pos + wcslen(marker);
+          break;
+        }
+      }
+
+      // Find pendulum effect marker
+      for (const wchar_t *marker : pendulumMarkers) {
+        size_t pos = fullText.find(marker);
+        if (pos != std::wstring::npos) {
+          pendulumStart = pos + wcslen(marker);
+          break;
+        }
+      }
+
+      if (pendulumStart != std::wstring::npos &&
+          monsterStart != std::wstring::npos) {
+        // Both markers found - extract each effect
+        if (pendulumStart < monsterStart) {
+          // Pendulum effect comes first
+          size_t pendulumEnd = fullText.find(L"[", pendulumStart);
+          if (pendulumEnd == std::wstring::npos)
+            pendulumEnd = monsterStart;
+          data.pendulumEffect =
+              fullText.substr(pendulumStart, pendulumEnd - pendulumStart);
+          data.cardEffect = fullText.substr(monsterStart);
+        } else {
+          // Monster effect comes first (unusual but handle it)
+          data.cardEffect = fullText.substr(monsterStart);
+          data.pendulumEffect = fullText.substr(pendulumStart);
+        }
+        // Trim leading whitespace (including \r, \n, space, tab)
+        while (!data.pendulumEffect.empty() &&
+               (data.pendulumEffect[0] == L'\n' ||
+                data.pendulumEffect[0] == L'\r' ||
+                data.pendulumEffect[0] == L' ' ||
+                data.pendulumEffect[0] == L'\t'))
+          data.pendulumEffect.erase(0, 1);
+        while (!data.cardEffect.empty() &&
+               (data.cardEffect[0] == L'\n' || data.cardEffect[0] == L'\r' ||
+                data.cardEffect[0] == L' ' || data.cardEffect[0] == L'\t'))
+          data.cardEffect.erase(0, 1);
+        // Trim trailing whitespace, dashes, and separator lines from pendulum
+        // effect (including various Unicode dash characters)
+        while (!data.pendulumEffect.empty()) {
+          wchar_t c = data.pendulumEffect.back();
+          if (c == L'\n' || c == L'\r' || c == L' ' || c == L'-' ||
+              c == L'\u2500' || c == L'\u2014' || c == L'\u2013' ||
+              c == L'\u2012' || c == L'_' || c == L'\u2015')
+            data.pendulumEffect.pop_back();
+          else
+            break;
+        }
+        // Also trim leading dashes/lines from monster effect
+        while (!data.cardEffect.empty()) {
+          wchar_t c = data.cardEffect[0];
+          if (c == L'\n' || c == L'\r' || c == L' ' || c == L'-' ||
+              c == L'\u2500' || c == L'\u2014' || c == L'\u2013' ||
+              c == L'\u2012' || c == L'_' || c == L'\u2015')
+            data.cardEffect.erase(0, 1);
+          else
+            break;
+        }
+      }
+    }
+
+    // Link arrows
+    if (cardData->type & TYPE_LINK) {
+      if (cardData->link_marker & LINK_MARKER_TOP_LEFT)
+        data.linkArrows.push_back(LinkArrow::UP_LEFT);
+      if (cardData->link_marker & LINK_MARKER_TOP)
+        data.linkArrows.push_back(LinkArrow::UP);
+      if (cardData->link_marker & LINK_MARKER_TOP_RIGHT)
+        data.linkArrows.push_back(LinkArrow::UP_RIGHT);
+      if (cardData->link_marker & LINK_MARKER_LEFT)
+        data.linkArrows.push_back(LinkArrow::LEFT);
+      if (cardData->link_marker & LINK_MARKER_RIGHT)
+        data.linkArrows.push_back(LinkArrow::RIGHT);
+      if (cardData->link_marker & LINK_MARKER_BOTTOM_LEFT)
+        data.linkArrows.push_back(LinkArrow::DOWN_LEFT);
+      if (cardData->link_marker & LINK_MARKER_BOTTOM)
+        data.linkArrows.push_back(LinkArrow::DOWN);
+      if (cardData->link_marker & LINK_MARKER_BOTTOM_RIGHT)
+        data.linkArrows.push_back(LinkArrow::DOWN_RIGHT);
+    }
+
+    // Monster type line like "[Dragon/Flip/Effect]"
+    // Get race name and type abilities
+    std::wstring race = gDataManager->FormatRace(cardData->race);
+    std::wstring typeStr = gDataManager->FormatType(cardData->type);
+
+    // Helper to trim whitespace
+    auto trim = [](std::wstring s) {
+      size_t start = s.find_first_not_of(L" \t");
+      if (start == std::wstring::npos)
+        return std::wstring();
+      size_t end = s.find_last_not_of(L" \t");
+      return s.substr(start, end - start + 1);
+    };
+
+    // Split by | and filter out "Monster", then join with /
+    std::wstring abilities;
+    size_t pos = 0, prev = 0;
+    while ((pos = typeStr.find(L'|', prev)) != std::wstring::npos) {
+      std::wstring part = trim(typeStr.substr(prev, pos - prev));
+      if (!part.empty() && part != L"Monster") {
+        if (!abilities.empty())
+          abilities += L"/";
+        abilities += part;
+      }
+      prev = pos + 1;
+    }
+    // Last part
+    std::wstring part = trim(typeStr.substr(prev));
+    if (!part.empty() && part != L"Monster") {
+      if (!abilities.empty())
+        abilities += L"/";
+      abilities += part;
+    }
+
+    // Build type line: [Race/Ability1/Ability2]
+    data.monsterTypeLine = L"[" + trim(race) + L"/" + abilities + L"]";
+
+  } else if (cardData->type & TYPE_SPELL) {
+    data.cardType = CardType::SPELL;
+    if (cardData->type & TYPE_QUICKPLAY) {
+      data.cardSubtype = CardSubtype::SPELL_QUICKPLAY;
+    } else if (cardData->type & TYPE_CONTINUOUS) {
+      data.cardSubtype = CardSubtype::SPELL_CONTINUOUS;
+    } else if (cardData->type & TYPE_FIELD) {
+      data.cardSubtype = CardSubtype::SPELL_FIELD;
+    } else if (cardData->type & TYPE_EQUIP) {
+      data.cardSubtype = CardSubtype::SPELL_EQUIP;
+    } else if (cardData->type & TYPE_RITUAL) {
+      data.cardSubtype = CardSubtype::SPELL_RITUAL;
+    } else {
+      data.cardSubtype = CardSubtype::SPELL_NORMAL;
+    }
+  } else if (cardData->type & TYPE_TRAP) {
+    data.cardType = CardType::TRAP;
+    if (cardData->type & TYPE_COUNTER) {
+      data.cardSubtype = CardSubtype::TRAP_COUNTER;
+    } else if (cardData->type & TYPE_CONTINUOUS) {
+      data.cardSubtype = CardSubtype::TRAP_CONTINUOUS;
+    } else {
+      data.cardSubtype = CardSubtype::TRAP_NORMAL;
+    }
+  } else if (cardData->type & TYPE_TOKEN) {
+    data.cardType = CardType::TOKEN;
+  }
+
+  return data;
+}
+
 ModularCardRenderer::ModularCardRenderer(irr::IrrlichtDevice *device)
     : device(device), driver(device->getVideoDriver()),
       env(device->getGUIEnvironment()), renderTarget(nullptr),
-      fontCardName(nullptr), fontEffect(nullptr), fontStats(nullptr) {
+      gpuCanvas(std::make_unique<ModularGpuCanvas>(driver, env)) {
   // Enable mipmaps for the render target to ensure smooth scaling
   bool prevMipMap =
       driver->getTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS);
@@ -38,130 +323,26 @@ ModularCardRenderer::ModularCardRenderer(irr::IrrlichtDevice *device)
   // Restore previous mipmap setting
   driver->setTextureCreationFlag(irr::video::ETCF_CREATE_MIP_MAPS, prevMipMap);
 
-  // Load fonts using CGUITTFont - proper EDOPro font loading
-  // Font files from reference CSS:
-  // fontCardName: YGOSmallCaps.ttf - for card name
+  // Fonts (see ModularFace) and textures are created by the canvases the
+  // first time a card uses them. Font files from reference CSS:
   // fontCardName: matrix_bold_small_caps.ttf - for card name (small caps style)
   // fontCardType: StoneSerifSmallCapsBold.ttf - for monster type line
   // fontATKValue: MatrixRegular.ttf - for ATK/DEF values
-  GameConfig::TextFont nameFont{
-      EPRO_TEXT("textures/modular/font/matrix_bold_small_caps.ttf"), 114};
-  GameConfig::TextFont effectFont{
-      EPRO_TEXT("textures/modular/font/StoneSerifStd-Medium.ttf"), 42};
-  GameConfig::TextFont effectFontMedium{
-      EPRO_TEXT("textures/modular/font/StoneSerifStd-Medium.ttf"),
-      38}; // Between 42 and 32
-  GameConfig::TextFont effectFontSmall{
-      EPRO_TEXT("textures/modular/font/StoneSerifStd-Medium.ttf"), 32};
-  GameConfig::TextFont effectFontSmaller{
-      EPRO_TEXT("textures/modular/font/StoneSerifStd-Medium.ttf"),
-      28}; // Between 32 and 24
-  GameConfig::TextFont effectFontTiny{
-      EPRO_TEXT("textures/modular/font/StoneSerifStd-Medium.ttf"), 24};
-  // Italic font for normal monster flavor text
-  GameConfig::TextFont effectFontItalic{
-      EPRO_TEXT("textures/modular/font/StoneSerifITC-MediumItalic.ttf"), 42};
-  GameConfig::TextFont statsFont{
-      EPRO_TEXT("textures/modular/font/MatrixRegular.ttf"), 64};
-  GameConfig::TextFont typeLineFont{
-      EPRO_TEXT("textures/modular/font/StoneSerifSmallCapsBold.ttf"), 38};
-  GameConfig::TextFont cardIdFont{
-      EPRO_TEXT("textures/modular/font/StoneSerifStd-Medium.ttf"),
-      32}; // Slightly larger than 26px box to look good
-
-  // Fallback fonts removed as per user request to use single font
-  // (StoneSerifStd)
-  static GameConfig::FallbackFonts fallbackFonts;
-  // if (fallbackFonts.empty()) {
-  //    fallbackFonts.push_back({EPRO_TEXT("C:/Windows/Fonts/arial.ttf"), 0});
-  // }
-
-  fontCardName =
-      irr::gui::CGUITTFont::createTTFont(env, nameFont, fallbackFonts);
-  fontEffect = irr::gui::CGUITTFont::createTTFont(
-      env, effectFont, fallbackFonts); // StoneSerifStd
-  fontEffectMedium =
-      irr::gui::CGUITTFont::createTTFont(env, effectFontMedium, fallbackFonts);
-  fontEffectSmall =
-      irr::gui::CGUITTFont::createTTFont(env, effectFontSmall, fallbackFonts);
-  fontEffectSmaller =
-      irr::gui::CGUITTFont::createTTFont(env, effectFontSmaller, fallbackFonts);
-  fontEffectTiny =
-      irr::gui::CGUITTFont::createTTFont(env, effectFontTiny, fallbackFonts);
-  fontEffectItalic =
-      irr::gui::CGUITTFont::createTTFont(env, effectFontItalic, fallbackFonts);
-  fontStats = irr::gui::CGUITTFont::createTTFont(env, statsFont, fallbackFonts);
-  fontTypeLine =
-      irr::gui::CGUITTFont::createTTFont(env, typeLineFont, fallbackFonts);
-  fontCardId =
-      irr::gui::CGUITTFont::createTTFont(env, cardIdFont, fallbackFonts);
-
-  // Load level/rank star textures
-  levelStarTexture =
-      driver->getTexture("textures/modular/icon/GUI_T_Icon1_Other_Level.png");
-  rankStarTexture =
-      driver->getTexture("textures/modular/icon/GUI_T_Icon1_Other_Rank.png");
-
-  // Load link arrow textures
-  linkArrowTextures[LinkArrow::UP] =
-      driver->getTexture("textures/modular/icon/L_U.png");
-  linkArrowTextures[LinkArrow::DOWN] =
-      driver->getTexture("textures/modular/icon/L_D.png");
-  linkArrowTextures[LinkArrow::LEFT] =
-      driver->getTexture("textures/modular/icon/L_L.png");
-  linkArrowTextures[LinkArrow::RIGHT] =
-      driver->getTexture("textures/modular/icon/L_R.png");
-  linkArrowTextures[LinkArrow::UP_LEFT] =
-      driver->getTexture("textures/modular/icon/L_UL.png");
-  linkArrowTextures[LinkArrow::UP_RIGHT] =
-      driver->getTexture("textures/modular/icon/L_UR.png");
-  linkArrowTextures[LinkArrow::DOWN_LEFT] =
-      driver->getTexture("textures/modular/icon/L_DL.png");
-  linkArrowTextures[LinkArrow::DOWN_RIGHT] =
-      driver->getTexture("textures/modular/icon/L_DR.png");
 }
 
 ModularCardRenderer::~ModularCardRenderer() {
-  // Fonts are managed by Irrlicht environment, no need to drop them explicitly
   // The render target will be cleaned up by the driver
-
-  // Clean up cached textures (Irrlicht manages these, but clear our maps)
-  frameTextures.clear();
-  iconTextures.clear();
-  nameFontCache.clear();
-}
-
-irr::gui::IGUIFont *ModularCardRenderer::GetNameFontForSize(int sizeHalfPx) {
-  // Check cache first
-  auto it = nameFontCache.find(sizeHalfPx);
-  if (it != nameFontCache.end()) {
-    return it->second;
-  }
-
-  // Create new font at this size (convert half-pixels to pixels)
-  int sizePx = sizeHalfPx / 2;
-  if (sizePx < 20)
-    sizePx = 20; // Minimum readable size
-
-  GameConfig::TextFont nameFont{
-      EPRO_TEXT("textures/modular/font/YGO_Card_NA.ttf"), sizePx};
-  GameConfig::FallbackFonts fallbackFonts;
-
-  irr::gui::IGUIFont *newFont =
-      irr::gui::CGUITTFont::createTTFont(env, nameFont, fallbackFonts);
-
-  // Cache and return
-  nameFontCache[sizeHalfPx] = newFont;
-  return newFont;
 }
 
 irr::video::ITexture *
 ModularCardRenderer::RenderCard(const ModularCardData &card,
-                                irr::video::ITexture *artTexture) {
-  ErrorLog("ModularCardRenderer::RenderCard called for card: {}",
+                                irr::video::ITexture *artTexture,
+                                irr::video::ITexture *target) {
+  DebugLog("ModularCardRenderer::RenderCard called for card: {}",
            Utils::ToUTF8IfNeeded(card.cardName));
 
-  if (!renderTarget) {
+  irr::video::ITexture *currentTarget = target ? target : renderTarget;
+  if (!currentTarget) {
     ErrorLog("ModularCardRenderer: renderTarget is null!");
     return nullptr;
   }
@@ -171,74 +352,163 @@ ModularCardRenderer::RenderCard(const ModularCardData &card,
     return nullptr;
   }
 
-  ErrorLog("ModularCardRenderer: Setting render target...");
+  DebugLog("ModularCardRenderer: Setting render target...");
 
   // Set render target
   driver->setRenderTarget(
-      renderTarget, true, true,
+      currentTarget, true, true,
       irr::video::SColor(0, 0, 0, 0)); // Transparent background for layering
 
-  ErrorLog("ModularCardRenderer: Rendering components...");
+  DebugLog("ModularCardRenderer: Rendering components...");
 
-  // Render individual components (matching daominah-card-engine order)
-  // Draw Art FIRST, then partial Frame on top (to mask edges)
-  RenderCardArt(artTexture, card);
-  RenderCardFrame(card);
-  RenderCardAttribute(card);
-  RenderCardTypeLevelRank(card);
-  RenderLinkArrow(card);
-  RenderCardName(card);
-  RenderMonsterTypeLine(card); // [Dragon/Effect] type line
-  RenderCardEffect(card);
-  RenderPendulum(card);
-  RenderStats(card); // ATK/DEF or LINK rating
-  RenderCardId(card);
-
-  if (card.cardType == CardType::SPELL || card.cardType == CardType::TRAP) {
-    RenderSpellTrapTypeLine(card);
-  }
+  gpuCanvas->Begin(artTexture);
+  Compose(*gpuCanvas, card, currentTarget->getSize());
+  gpuCanvas->End();
 
   // Reset render target
   driver->setRenderTarget(0, true, true);
 
   // Regenerate mipmaps now that rendering is complete
-  renderTarget->regenerateMipMapLevels();
+  {
+    ModularRenderStats::Timer timer(stats, ModularRenderStats::MIPMAPS);
+    currentTarget->regenerateMipMapLevels();
+  }
+
+  return currentTarget;
+}
+
+uint32_t
+ModularCardRenderer::GetLodLevel(const irr::core::dimension2du &displaySize) {
+  if (displaySize.Width == 0 || displaySize.Height == 0)
+    return 0;
+  uint32_t level = 0;
+  while (level < MAX_LOD_LEVEL) {
+    const auto next = GetLodSize(level + 1);
+    if (next.Width < displaySize.Width || next.Height < displaySize.Height)
+      break;
+    ++level;
+  }
+  return level;
+}
+
+irr::core::dimension2du ModularCardRenderer::GetLodSize(uint32_t level) {
+  return {static_cast<irr::u32>(BASE_WIDTH) >> level,
+          static_cast<irr::u32>(BASE_HEIGHT) >> level};
+}
+
+irr::core::recti ModularCardRenderer::GetArtBox(bool pendulum) {
+  // Art regions from reference CSS
+  if (pendulum) // left:82, top:310, width:1018, height:762
+    return irr::core::recti(82, 310, 82 + 1018, 310 + 762);
+  // left:146, top:318, width:890, height:890
+  return irr::core::recti(146, 318, 146 + 890, 318 + 890);
+}
+
+irr::core::recti
+ModularCardRenderer::GetArtCrop(const irr::core::dimension2du &artSize,
+                                bool pendulum) {
+  const int artWidth = artSize.Width;
+  const int artHeight = artSize.Height;
+  const auto box = GetArtBox(pendulum);
+  const int targetWidth = box.getWidth();
+  const int targetHeight = box.getHeight();
+  // Regular cards stretch the whole art into the box
+  if (!pendulum || (artWidth == targetWidth && artHeight == targetHeight))
+    return irr::core::recti(0, 0, artWidth, artHeight);
+
+  // Pendulum cards: scale to fit width while preserving aspect ratio
+  const float aspectRatio = (float)artWidth / (float)artHeight;
+  const int scaledHeight = (int)(targetWidth / aspectRatio);
+  if (scaledHeight <= targetHeight) {
+    // Image is wider than or equal to target - scale to height and crop
+    // the source horizontally to center
+    const int scaledWidth = (int)(targetHeight * aspectRatio);
+    const int xOffset = (scaledWidth - targetWidth) / 2;
+    const int srcCropX = (int)((float)xOffset / scaledWidth * artWidth);
+    const int srcWidth = (int)((float)targetWidth / scaledWidth * artWidth);
+    return irr::core::recti(srcCropX, 0, srcCropX + srcWidth, artHeight);
+  }
+  // Image is taller - scale to width and only show the top portion of the
+  // source that fits in the aspect ratio
+  const int srcHeight = (int)((float)targetHeight / scaledHeight * artHeight);
+  return irr::core::recti(0, 0, artWidth, srcHeight);
+}
 
-  return renderTarget;
+void ModularCardRenderer::Compose(ModularCanvas &canvas,
+                                  const ModularCardData &card,
+                                  const irr::core::dimension2du &size) const {
+  if (size.Width == static_cast<irr::u32>(BASE_WIDTH) &&
+      size.Height == static_cast<irr::u32>(BASE_HEIGHT)) {
+    Compose(canvas, card);
+    return;
+  }
+  ModularScaledCanvas scaled(canvas,
+                             static_cast<float>(size.Width) / BASE_WIDTH,
+                             static_cast<float>(size.Height) / BASE_HEIGHT);
+  Compose(scaled, card);
 }
 
-const wchar_t *ModularCardRenderer::GetSpellTrapIconPath(CardSubtype subtype) {
+void ModularCardRenderer::Compose(ModularCanvas &canvas,
+                                  const ModularCardData &card) const {
+  using Stage = ModularRenderStats::Stage;
+  ModularRenderStats::Timer total(stats, Stage::COMPOSE);
+  using Render = void (ModularCardRenderer::*)(ModularCanvas &,
+                                               const ModularCardData &) const;
+  auto timed = [&](Stage stage, Render render) {
+    ModularRenderStats::Timer timer(stats, stage);
+    (this->*render)(canvas, card);
+  };
+  // Render individual components (matching daominah-card-engine order)
+  // Draw Art FIRST, then partial Frame on top (to mask edges)
+  timed(Stage::ART, &ModularCardRenderer::RenderCardArt);
+  timed(Stage::FRAME, &ModularCardRenderer::RenderCardFrame);
+  timed(Stage::ATTRIBUTE, &ModularCardRenderer::RenderCardAttribute);
+  timed(Stage::TYPE_LEVEL_RANK, &ModularCardRenderer::RenderCardTypeLevelRank);
+  timed(Stage::LINK_ARROW, &ModularCardRenderer::RenderLinkArrow);
+  timed(Stage::NAME, &ModularCardRenderer::RenderCardName);
+  // [Dragon/Effect] type line
+  timed(Stage::TYPE_LINE, &ModularCardRenderer::RenderMonsterTypeLine);
+  timed(Stage::EFFECT, &ModularCardRenderer::RenderCardEffect);
+  timed(Stage::PENDULUM, &ModularCardRenderer::RenderPendulum);
+  timed(Stage::STATS, &ModularCardRenderer::RenderStats); // ATK/DEF or LINK
+  timed(Stage::CARD_ID, &ModularCardRenderer::RenderCardId);
+
+  if (card.cardType == CardType::SPELL || card.cardType == CardType::TRAP) {
+    timed(Stage::SPELL_TRAP_TYPE,
+          &ModularCardRenderer::RenderSpellTrapTypeLine);
+  }
+}
+
+const char *ModularCardRenderer::GetSpellTrapIconPath(CardSubtype subtype) {
   switch (subtype) {
   case CardSubtype::SPELL_NORMAL:
-    return L"textures/modular/icon/attr_SPELL.png"; // Fallback? Logic says no
+    return "textures/modular/icon/attr_SPELL.png"; // Fallback? Logic says no
                                                     // icon.
   case CardSubtype::TRAP_NORMAL:
-    return L"textures/modular/icon/attr_TRAP.png"; // Fallback? Logic says no
+    return "textures/modular/icon/attr_TRAP.png"; // Fallback? Logic says no
                                                    // icon.
 
   // Mapped from MapImg in index.js and file list
   case CardSubtype::TRAP_COUNTER:
-    return L"textures/modular/icon/GUI_T_Icon1_Icon01.png";
+    return "textures/modular/icon/GUI_T_Icon1_Icon01.png";
   case CardSubtype::SPELL_FIELD:
-    return L"textures/modular/icon/GUI_T_Icon1_Icon02.png";
+    return "textures/modular/icon/GUI_T_Icon1_Icon02.png";
   case CardSubtype::SPELL_EQUIP:
-    return L"textures/modular/icon/GUI_T_Icon1_Icon03.png";
+    return "textures/modular/icon/GUI_T_Icon1_Icon03.png";
   case CardSubtype::SPELL_CONTINUOUS:
   case CardSubtype::TRAP_CONTINUOUS:
-    return L"textures/modular/icon/GUI_T_Icon1_Icon04.png";
+    return "textures/modular/icon/GUI_T_Icon1_Icon04.png";
   case CardSubtype::SPELL_QUICKPLAY:
-    return L"textures/modular/icon/GUI_T_Icon1_Icon05.png";
+    return "textures/modular/icon/GUI_T_Icon1_Icon05.png";
   case CardSubtype::SPELL_RITUAL:
-    return L"textures/modular/icon/GUI_T_Icon1_Icon06.png";
+    return "textures/modular/icon/GUI_T_Icon1_Icon06.png";
   default:
     return nullptr;
   }
 }
 
-void ModularCardRenderer::RenderSpellTrapTypeLine(const ModularCardData &card) {
-  if (!fontTypeLine)
-    return;
-
+void ModularCardRenderer::RenderSpellTrapTypeLine(
+    ModularCanvas &canvas, const ModularCardData &card) const {
   // CSS: .cRenderCardType right: 110px, top: 210px.
   // Canvas Width 1180.
   // Right 110 => Right Edge = 1070.
@@ -253,7 +523,7 @@ void ModularCardRenderer::RenderSpellTrapTypeLine(const ModularCardData &card) {
 
   std::wstring typeText;
   bool hasIcon = false;
-  const wchar_t *iconPath = nullptr;
+  const char *iconPath = nullptr;
 
   // Logic from index.js:
   // If Normal: "[Spell Card]" or "[Trap Card]"
@@ -288,7 +558,7 @@ void ModularCardRenderer::RenderSpellTrapTypeLine(const ModularCardData &card) {
   // fontTypeLine->draw does not support alignment param other than center?
   // We need to measure text and adjust X.
   irr::core::dimension2d<irr::u32> textDim =
-      fontTypeLine->getDimension(typeText.c_str());
+      canvas.GetTextDimension(fontTypeLine, typeText);
   int textX = 1070 - textDim.Width;
   irr::core::rect<irr::s32> drawRect(textX, 210, 1070, 290);
 
@@ -309,30 +579,24 @@ void ModularCardRenderer::RenderSpellTrapTypeLine(const ModularCardData &card) {
 
   textColor = irr::video::SColor(255, 0, 0, 0); // Black
 
-  fontTypeLine->draw(typeText.c_str(), drawRect, textColor, false, true);
+  canvas.DrawText(fontTypeLine, typeText, drawRect, textColor, false, true);
 
   // Render Icon if needed
   if (hasIcon && iconPath) {
-    irr::video::ITexture *iconTex = driver->getTexture(iconPath);
-    if (iconTex) {
-      // Icon Rect: Right 136 -> X 972. Width 72.
-      // X: 1044 (Right Edge) - 72 = 972.
-      // Y: 210.
-      // W: 72, H: 72.
-      irr::core::rect<irr::s32> iconRect(972, 210, 972 + 72, 210 + 72);
-
-      // Draw with alpha channel
-      driver->draw2DImage(
-          iconTex, iconRect,
-          irr::core::rect<irr::s32>(0, 0, iconTex->getOriginalSize().Width,
-                                    iconTex->getOriginalSize().Height),
-          nullptr, nullptr, true);
-    }
+    // Icon Rect: Right 136 -> X 972. Width 72.
+    // X: 1044 (Right Edge) - 72 = 972.
+    // Y: 210.
+    // W: 72, H: 72.
+    irr::core::rect<irr::s32> iconRect(972, 210, 972 + 72, 210 + 72);
+
+    // Draw with alpha channel
+    canvas.DrawImage(iconPath, iconRect);
   }
 }
 
-void ModularCardRenderer::RenderCardId(const ModularCardData &card) {
-  if (!fontCardId || card.cardId == 0)
+void ModularCardRenderer::RenderCardId(ModularCanvas &canvas,
+                                       const ModularCardData &card) const {
+  if (card.cardId == 0)
     return;
 
   // CSS: .cRenderKonamiCardID { left:70, top:1640, width:500, height:26 }
@@ -346,76 +610,33 @@ void ModularCardRenderer::RenderCardId(const ModularCardData &card) {
   }
 
   irr::video::SColor textColor(255, 0, 0, 0); // Black text
-  fontCardId->draw(idStr.c_str(), idRect, textColor, false,
-                   true); // Centered vertically
+  canvas.DrawText(fontCardId, idStr, idRect, textColor, false,
+                  true); // Centered vertically
 }
-void ModularCardRenderer::RenderCardFrame(const ModularCardData &card) {
-  irr::video::ITexture *frameTexture = LoadFrameTexture(card);
-
-  if (frameTexture) {
-    // Draw the frame at full size (1180x1720)
-    driver->draw2DImage(
-        frameTexture, irr::core::rect<irr::s32>(0, 0, BASE_WIDTH, BASE_HEIGHT),
-        irr::core::rect<irr::s32>(0, 0, frameTexture->getSize().Width,
-                                  frameTexture->getSize().Height),
-        nullptr, nullptr, true);
-  }
+void ModularCardRenderer::RenderCardFrame(ModularCanvas &canvas,
+                                          const ModularCardData &card) const {
+  // Draw the frame at full size (1180x1720)
+  canvas.DrawImage(GetFramePath(card),
+                   irr::core::rect<irr::s32>(0, 0, BASE_WIDTH, BASE_HEIGHT));
 }
 
-void ModularCardRenderer::RenderCardArt(irr::video::ITexture *artTexture,
-                                        const ModularCardData &card) {
-  if (!artTexture)
+void ModularCardRenderer::RenderCardArt(ModularCanvas &canvas,
+                                        const ModularCardData &card) const {
+  const auto artBox = GetArtBox(card.isPendulum);
+  const auto artSize = canvas.GetArtSize();
+  if (artSize.Width == 0 || artSize.Height == 0) {
+    // Art still downloading (or unavailable): fill the art window with a
+    // neutral tone so the frame reads as a finished card in the meantime
+    canvas.FillRect(irr::video::SColor(255, 58, 58, 64), artBox);
     return;
-
-  // Art regions from reference CSS
-  irr::core::rect<irr::s32> artRegion;
-  irr::core::rect<irr::s32> srcRect;
-
-  int artWidth = artTexture->getSize().Width;
-  int artHeight = artTexture->getSize().Height;
-
-  if (card.isPendulum) {
-    // Pendulum cards: left:82, top:310, width:1018, height:762
-    // Scale to fit width while preserving aspect ratio
-    int targetWidth = 1018;
-    int targetHeight = 762;
-
-    // Calculate scaled height based on target width
-    float aspectRatio = (float)artWidth / (float)artHeight;
-    int scaledHeight = (int)(targetWidth / aspectRatio);
-
-    if (scaledHeight <= targetHeight) {
-      // Image is wider than or equal to target - scale to height and center
-      // horizontally
-      int scaledWidth = (int)(targetHeight * aspectRatio);
-      int xOffset = (scaledWidth - targetWidth) / 2;
-      artRegion = irr::core::rect<irr::s32>(82, 310, 82 + targetWidth,
-                                            310 + targetHeight);
-      // Crop source horizontally to center
-      int srcCropX = (int)((float)xOffset / scaledWidth * artWidth);
-      int srcWidth = (int)((float)targetWidth / scaledWidth * artWidth);
-      srcRect = irr::core::rect<irr::s32>(srcCropX, 0, srcCropX + srcWidth,
-                                          artHeight);
-    } else {
-      // Image is taller - scale to width and crop bottom
-      artRegion = irr::core::rect<irr::s32>(82, 310, 82 + targetWidth,
-                                            310 + targetHeight);
-      // Only show top portion of source that fits in aspect ratio
-      int srcHeight = (int)((float)targetHeight / scaledHeight * artHeight);
-      srcRect = irr::core::rect<irr::s32>(0, 0, artWidth, srcHeight);
-    }
-  } else {
-    // Regular cards: left:146, top:318, width:890, height:890
-    artRegion = irr::core::rect<irr::s32>(146, 318, 146 + 890, 318 + 890);
-    srcRect = irr::core::rect<irr::s32>(0, 0, artWidth, artHeight);
   }
-
-  // Draw the art texture with bilinear filtering
-  driver->draw2DImage(artTexture, artRegion, srcRect, nullptr, nullptr, true);
+  // Art from the art manager is already fitted to the box and drawn 1:1
+  canvas.DrawArt(artBox, GetArtCrop(artSize, card.isPendulum));
 }
 
-void ModularCardRenderer::RenderCardName(const ModularCardData &card) {
-  if (card.cardName.empty() || !fontCardName)
+void ModularCardRenderer::RenderCardName(ModularCanvas &canvas,
+                                         const ModularCardData &card) const {
+  if (card.cardName.empty())
     return;
 
   // Name region from CSS: left:88, top:96, width:880, height:76
@@ -434,67 +655,36 @@ void ModularCardRenderer::RenderCardName(const ModularCardData &card) {
     textColor = irr::video::SColor(255, 255, 255, 255); // White
   }
 
-  // Measure text at full size
+  // Names are squeezed to fit (like CSS transform: scaleX), very long ones
+  // also get a smaller font so they don't turn illegible
+  const ModularFont font{
+      fontCardName.face,
+      ModularTextLayout::FitLine(
+          canvas, fontCardName.face, MIN_NAME_SIZE, fontCardName.size,
+          card.cardName, static_cast<int>(nameWidth / MIN_NAME_SCALE))};
   irr::core::dimension2d<irr::u32> textDim =
-      fontCardName->getDimension(card.cardName.c_str());
+      canvas.GetTextDimension(font, card.cardName);
   int textWidth = textDim.Width;
   int textHeight = textDim.Height;
 
-  // Calculate horizontal scale factor (like CSS transform: scaleX)
+  // Calculate horizontal scale factor
   float scaleX = 1.0f;
   if (textWidth > nameWidth) {
     scaleX = (float)nameWidth / (float)textWidth;
   }
 
-  // Scaled destination width
-  int destWidth = (int)(textWidth * scaleX);
-  int destHeight = textHeight;
-
   // Center vertically within the name box
-  int destY = nameY + (nameHeight - destHeight) / 2;
-
-  // Draw text directly - for horizontal compression we use a scaled destination
-  // rect Since Irrlicht's font draw doesn't support scaling, we draw normally
-  // if fits For overflow, we render to temp texture then scale
-
-  if (scaleX >= 1.0f) {
-    // Text fits - draw normally
-    irr::core::rect<irr::s32> nameRect(nameX, destY, nameX + nameWidth,
-                                       destY + textHeight);
-    fontCardName->draw(card.cardName.c_str(), nameRect, textColor, false,
-                       false);
-  } else {
-    // Text needs horizontal compression
-    // Create temporary render target for the text
-    irr::video::ITexture *tempTarget = driver->addRenderTargetTexture(
-        irr::core::dimension2d<irr::u32>(textWidth, textHeight + 20),
-        "TempNameText", irr::video::ECF_A8R8G8B8);
-
-    if (tempTarget) {
-      // Render text to temp texture
-      driver->setRenderTarget(tempTarget, true, true,
-                              irr::video::SColor(0, 0, 0, 0));
-      irr::core::rect<irr::s32> tempRect(0, 0, textWidth, textHeight + 20);
-      fontCardName->draw(card.cardName.c_str(), tempRect, textColor, false,
-                         false);
-
-      // Switch back to main render target
-      driver->setRenderTarget(renderTarget, false, false);
-
-      // Draw scaled text to final destination
-      irr::core::rect<irr::s32> srcRect(0, 0, textWidth, textHeight);
-      irr::core::rect<irr::s32> destRect(nameX, destY, nameX + destWidth,
-                                         destY + destHeight);
-      driver->draw2DImage(tempTarget, destRect, srcRect, nullptr, nullptr,
-                          true);
-
-      // Clean up temp texture
-      driver->removeTexture(tempTarget);
-    }
-  }
+  int destY = nameY + (nameHeight - textHeight) / 2;
+
+  // Overflowing names are squeezed horizontally by the canvas
+  irr::core::rect<irr::s32> nameRect(nameX, destY, nameX + nameWidth,
+                                     destY + textHeight);
+  canvas.DrawText(font, card.cardName, nameRect, textColor, false, false,
+                  scaleX);
 }
 
-void ModularCardRenderer::RenderCardAttribute(const ModularCardData &card) {
+void ModularCardRenderer::RenderCardAttribute(
+    ModularCanvas &canvas, const ModularCardData &card) const {
   // Load attribute icon
   std::string iconName;
 
@@ -529,19 +719,13 @@ void ModularCardRenderer::RenderCardAttribute(const ModularCardData &card) {
     }
   }
 
-  irr::video::ITexture *attrIcon = LoadIconTexture(iconName);
-  if (attrIcon) {
-    // Attribute icon from CSS: left:974, top:78, width:122, height:122
-    irr::core::rect<irr::s32> iconRect(974, 78, 974 + 122, 78 + 122);
-    driver->draw2DImage(attrIcon, iconRect,
-                        irr::core::rect<irr::s32>(0, 0,
-                                                  attrIcon->getSize().Width,
-                                                  attrIcon->getSize().Height),
-                        nullptr, nullptr, true);
-  }
+  // Attribute icon from CSS: left:974, top:78, width:122, height:122
+  irr::core::rect<irr::s32> iconRect(974, 78, 974 + 122, 78 + 122);
+  canvas.DrawImage("textures/modular/icon/" + iconName + ".png", iconRect);
 }
 
-void ModularCardRenderer::RenderCardTypeLevelRank(const ModularCardData &card) {
+void ModularCardRenderer::RenderCardTypeLevelRank(
+    ModularCanvas &canvas, const ModularCardData &card) const {
   // Only render for monsters (not spell/trap)
   if (card.cardType != CardType::MONSTER && card.cardType != CardType::TOKEN)
     return;
@@ -555,18 +739,17 @@ void ModularCardRenderer::RenderCardTypeLevelRank(const ModularCardData &card) {
     return;
 
   // Determine which star texture to use
-  irr::video::ITexture *starTexture = nullptr;
+  const char *starTexture = nullptr;
   bool isXyz = (card.cardSubtype == CardSubtype::MONSTER_XYZ);
 
   if (isXyz) {
-    starTexture = rankStarTexture; // Black stars for XYZ
+    // Black stars for XYZ
+    starTexture = "textures/modular/icon/GUI_T_Icon1_Other_Rank.png";
   } else {
-    starTexture = levelStarTexture; // Red stars for level
+    // Red stars for level
+    starTexture = "textures/modular/icon/GUI_T_Icon1_Other_Level.png";
   }
 
-  if (!starTexture)
-    return;
-
   // Star sizing from reference: starWidth = Math.floor(levelsRanksWidth / 12 -
   // 2) levelsRanksWidth = 988 (from CSS), so starWidth = floor(988/12 - 2) =
   // floor(82.3 - 2) = 80
@@ -597,15 +780,12 @@ void ModularCardRenderer::RenderCardTypeLevelRank(const ModularCardData &card) {
 
     irr::core::rect<irr::s32> starRect(x, starY, x + starSize,
                                        starY + starSize);
-    driver->draw2DImage(
-        starTexture, starRect,
-        irr::core::rect<irr::s32>(0, 0, starTexture->getSize().Width,
-                                  starTexture->getSize().Height),
-        nullptr, nullptr, true);
+    canvas.DrawImage(starTexture, starRect);
   }
 }
 
-void ModularCardRenderer::RenderLinkArrow(const ModularCardData &card) {
+void ModularCardRenderer::RenderLinkArrow(ModularCanvas &canvas,
+                                          const ModularCardData &card) const {
   // Only render for Link monsters
   if (card.cardSubtype != CardSubtype::MONSTER_LINK)
     return;
@@ -646,22 +826,16 @@ void ModularCardRenderer::RenderLinkArrow(const ModularCardData &card) {
     }
 
     if (isActive) {
-      auto it = linkArrowTextures.find(pos.arrow);
-      if (it != linkArrowTextures.end() && it->second) {
-        irr::core::rect<irr::s32> arrowRect(pos.x, pos.y, pos.x + pos.w,
-                                            pos.y + pos.h);
-        driver->draw2DImage(
-            it->second, arrowRect,
-            irr::core::rect<irr::s32>(0, 0, it->second->getSize().Width,
-                                      it->second->getSize().Height),
-            nullptr, nullptr, true);
-      }
+      irr::core::rect<irr::s32> arrowRect(pos.x, pos.y, pos.x + pos.w,
+                                          pos.y + pos.h);
+      canvas.DrawImage(GetLinkArrowPath(pos.arrow), arrowRect);
     }
   }
 }
 
-void ModularCardRenderer::RenderCardEffect(const ModularCardData &card) {
-  if (!fontEffect || card.cardEffect.empty())
+void ModularCardRenderer::RenderCardEffect(ModularCanvas &canvas,
+                                           const ModularCardData &card) const {
+  if (card.cardEffect.empty())
     return;
 
   // Effect text region - varies by card type
@@ -692,96 +866,35 @@ void ModularCardRenderer::RenderCardEffect(const ModularCardData &card) {
   }
 
   irr::video::SColor textColor(255, 0, 0, 0);
-  std::wstring text = card.cardEffect;
-  int maxWidth = effectRect.getWidth();
-
-  // Helper lambda to calculate lines for a given font
-  auto calculateLines = [&](irr::gui::IGUIFont *font) {
-    std::vector<std::wstring> lines;
-    std::wstring currentLine;
-    std::wstring word;
-
-    for (size_t i = 0; i <= text.length(); i++) {
-      wchar_t c = (i < text.length()) ? text[i] : L' ';
-
-      if (c == L' ' || c == L'\n' || i == text.length()) {
-        std::wstring testLine =
-            currentLine + (currentLine.empty() ? L"" : L" ") + word;
-        irr::core::dimension2d<irr::u32> dim =
-            font->getDimension(testLine.c_str());
-
-        if (dim.Width > (irr::u32)maxWidth && !currentLine.empty()) {
-          lines.push_back(currentLine);
-          currentLine = word;
-        } else {
-          currentLine = testLine;
-        }
-        word.clear();
-
-        if (c == L'\n') {
-          lines.push_back(currentLine);
-          currentLine.clear();
-        }
-      } else {
-        word += c;
-      }
-    }
-    if (!currentLine.empty()) {
-      lines.push_back(currentLine);
-    }
-    return lines;
-  };
 
   // For normal monsters, use italic font for flavor text
-  irr::gui::IGUIFont *baseFont = fontEffect;
-  if (card.isNormalMonster && fontEffectItalic) {
-    baseFont = fontEffectItalic;
-  }
-
-  // Font tier cascade: 42px → 38px → 32px → 28px → 24px
-  irr::gui::IGUIFont *selectedFont = baseFont;
-  int lineHeight = 42;
-  std::vector<std::wstring> lines = calculateLines(baseFont);
+  const ModularFace face =
+      card.isNormalMonster ? ModularFace::EFFECT_ITALIC : ModularFace::EFFECT;
 
-  // Tier 2: 38px
-  if (fontEffectMedium && (int)lines.size() * lineHeight > boxHeight) {
-    lines = calculateLines(fontEffectMedium);
-    selectedFont = fontEffectMedium;
-    lineHeight = 38;
-  }
-  // Tier 3: 32px
-  if (fontEffectSmall && (int)lines.size() * lineHeight > boxHeight) {
-    lines = calculateLines(fontEffectSmall);
-    selectedFont = fontEffectSmall;
-    lineHeight = 32;
-  }
-  // Tier 4: 28px
-  if (fontEffectSmaller && (int)lines.size() * lineHeight > boxHeight) {
-    lines = calculateLines(fontEffectSmaller);
-    selectedFont = fontEffectSmaller;
-    lineHeight = 28;
-  }
-  // Tier 5: 24px
-  if (fontEffectTiny && (int)lines.size() * lineHeight > boxHeight) {
-    lines = calculateLines(fontEffectTiny);
-    selectedFont = fontEffectTiny;
-    lineHeight = 24;
-  }
+  // Largest size from 42px down to 24px that fits, lines as tall as the size
+  const ModularTextLayout::FitRange range{
+      face, MIN_EFFECT_SIZE, MAX_EFFECT_SIZE,
+      [](const ModularFont &font) { return static_cast<int>(font.size); }};
+  const auto layout =
+      textLayout.Layout(canvas, card.cardId, {effectRect.getWidth(), boxHeight},
+                        card.cardEffect, range);
 
   // Draw lines
+  const int lineHeight = layout.lineHeight;
   int currentY = effectRect.UpperLeftCorner.Y;
-  for (const auto &line : lines) {
+  for (const auto &line : layout.lines) {
     if (currentY + lineHeight > effectRect.LowerRightCorner.Y)
       break;
     irr::core::rect<irr::s32> lineRect(effectRect.UpperLeftCorner.X, currentY,
                                        effectRect.LowerRightCorner.X,
                                        currentY + lineHeight);
-    selectedFont->draw(line.c_str(), lineRect, textColor, false, false);
+    canvas.DrawText(layout.font, line, lineRect, textColor, false, false);
     currentY += lineHeight;
   }
 }
 
-void ModularCardRenderer::RenderPendulum(const ModularCardData &card) {
+void ModularCardRenderer::RenderPendulum(ModularCanvas &canvas,
+                                         const ModularCardData &card) const {
   if (!card.isPendulum)
     return;
 
@@ -789,119 +902,67 @@ void ModularCardRenderer::RenderPendulum(const ModularCardData &card) {
   // CSS: .cRenderPScaleLeft: left:98, bottom:480, 56x72
   // CSS: .cRenderPScaleRight: right:98, bottom:480, 56x72
   // Bottom 480 on 1720 canvas = Y = 1720 - 480 - 72 = 1168
-  if (fontStats) {
+  {
     std::wstring scaleStr = std::to_wstring(card.pendulumScale);
     irr::video::SColor scaleColor(255, 0, 0, 0);
 
     // Left scale position from CSS: left:98, bottom:480, 56x72
     irr::core::rect<irr::s32> leftScaleRect(98, 1168, 98 + 56, 1168 + 72);
-    fontStats->draw(scaleStr.c_str(), leftScaleRect, scaleColor, true, true);
+    canvas.DrawText(fontStats, scaleStr, leftScaleRect, scaleColor, true, true);
 
     // Right scale position from CSS: right:98 = 1180-98-56 = 1026
     irr::core::rect<irr::s32> rightScaleRect(1026, 1168, 1026 + 56, 1168 + 72);
-    fontStats->draw(scaleStr.c_str(), rightScaleRect, scaleColor, true, true);
+    canvas.DrawText(fontStats, scaleStr, rightScaleRect, scaleColor, true,
+                    true);
   }
 
   // Pendulum effect from CSS: left:184, top:1086, 816x188
   // Small 4px top padding for breathing room
-  if (fontEffectSmall && !card.pendulumEffect.empty()) {
+  if (!card.pendulumEffect.empty()) {
     const int TOP_PADDING = 4;
     irr::core::rect<irr::s32> pEffectRect(184, 1086 + TOP_PADDING, 184 + 816,
                                           1086 + 188);
     int boxHeight = 188 - TOP_PADDING;
-    int maxWidth = pEffectRect.getWidth();
     irr::video::SColor textColor(255, 0, 0, 0);
-    std::wstring text = card.pendulumEffect;
-
-    ErrorLog("RenderPendulum: Text length={}, boxHeight={}, startY={}",
-             text.length(), boxHeight, pEffectRect.UpperLeftCorner.Y);
-
-    // Word wrap helper - same as RenderCardEffect
-    auto wrapText = [&](irr::gui::IGUIFont *font) {
-      std::vector<std::wstring> lines;
-      std::wstring currentLine, word;
-      for (size_t i = 0; i <= text.length(); i++) {
-        wchar_t c = (i < text.length()) ? text[i] : L' ';
-        if (c == L' ' || c == L'\n' || i == text.length()) {
-          std::wstring testLine =
-              currentLine + (currentLine.empty() ? L"" : L" ") + word;
-          if (font->getDimension(testLine.c_str()).Width > (irr::u32)maxWidth &&
-              !currentLine.empty()) {
-            lines.push_back(currentLine);
-            currentLine = word;
-          } else {
-            currentLine = testLine;
-          }
-          word.clear();
-          if (c == L'\n') {
-            lines.push_back(currentLine);
-            currentLine.clear();
-          }
-        } else {
-          word += c;
-        }
-      }
-      if (!currentLine.empty())
-        lines.push_back(currentLine);
-      return lines;
-    };
 
-    // Helper to get actual font height
-    auto getFontHeight = [](irr::gui::IGUIFont *font) -> int {
-      return font->getDimension(L"Ag").Height;
-    };
-
-    // Pendulum effect font cascade: 32px → 28px → 24px
-    irr::gui::IGUIFont *selectedFont = fontEffectSmall;
-    std::vector<std::wstring> lines = wrapText(fontEffectSmall);
-    int lineHeight = getFontHeight(fontEffectSmall);
-    int tier = 1;
-
-    // Tier 2: 28px
-    if (fontEffectSmaller && (int)lines.size() * lineHeight > boxHeight) {
-      lines = wrapText(fontEffectSmaller);
-      selectedFont = fontEffectSmaller;
-      lineHeight = getFontHeight(fontEffectSmaller);
-      tier = 2;
-    }
-    // Tier 3: 24px
-    if (fontEffectTiny && (int)lines.size() * lineHeight > boxHeight) {
-      lines = wrapText(fontEffectTiny);
-      selectedFont = fontEffectTiny;
-      lineHeight = getFontHeight(fontEffectTiny);
-      tier = 3;
-    }
-
-    ErrorLog("RenderPendulum: Using tier {}, lineHeight={}, lines={}, "
-             "startY={}, rectTop={}, rectBottom={}",
-             tier, lineHeight, lines.size(), pEffectRect.UpperLeftCorner.Y,
-             pEffectRect.UpperLeftCorner.Y, pEffectRect.LowerRightCorner.Y);
+    // Largest size from 32px down to 24px that fits, spaced by the actual
+    // font height
+    const ModularTextLayout::FitRange range{
+        ModularFace::EFFECT, MIN_EFFECT_SIZE, MAX_PENDULUM_EFFECT_SIZE,
+        [&canvas](const ModularFont &font) {
+          return static_cast<int>(canvas.GetTextDimension(font, L"Ag").Height);
+        }};
+    const auto layout = textLayout.Layout(
+        canvas, card.cardId, {pEffectRect.getWidth(), boxHeight},
+        card.pendulumEffect, range);
+    const int lineHeight = layout.lineHeight;
 
     // Draw lines - start from the TOP of the effect box (after padding)
     // Use vcenter=false to draw text at the top of each line rect
     int currentY = pEffectRect.UpperLeftCorner.Y;
-    for (const auto &line : lines) {
+    for (const auto &line : layout.lines) {
       if (currentY + lineHeight > pEffectRect.LowerRightCorner.Y)
         break;
       irr::core::rect<irr::s32> lineRect(
           pEffectRect.UpperLeftCorner.X, currentY,
           pEffectRect.LowerRightCorner.X, currentY + lineHeight);
       // vcenter=false draws from top of rect, not centered
-      selectedFont->draw(line.c_str(), lineRect, textColor, false, false);
+      canvas.DrawText(layout.font, line, lineRect, textColor, false, false);
       currentY += lineHeight;
     }
 
-    ErrorLog("RenderPendulum: Drew {} lines, final Y={}", lines.size(),
+    DebugLog("RenderPendulum: Drew {} lines, final Y={}", layout.lines.size(),
              currentY);
   }
 }
 
-void ModularCardRenderer::RenderMonsterTypeLine(const ModularCardData &card) {
+void ModularCardRenderer::RenderMonsterTypeLine(
+    ModularCanvas &canvas, const ModularCardData &card) const {
   // Only render for monsters (not spell/trap)
   if (card.cardType != CardType::MONSTER && card.cardType != CardType::TOKEN)
     return;
 
-  if (!fontTypeLine || card.monsterTypeLine.empty())
+  if (card.monsterTypeLine.empty())
     return;
 
   // CSS: .cRenderMonsterAbilities: left:100, top:1292, width:980, height:42
@@ -909,25 +970,28 @@ void ModularCardRenderer::RenderMonsterTypeLine(const ModularCardData &card) {
   irr::video::SColor textColor(255, 0, 0, 0); // Black text
 
   // Type line text like "[Dragon / Effect]" - uses bold StoneSerifSmallCaps
-  // font
-  fontTypeLine->draw(card.monsterTypeLine.c_str(), typeRect, textColor, false,
-                     true);
+  // font, squeezed like the name when a long list of abilities overflows
+  const auto textWidth =
+      canvas.GetTextDimension(fontTypeLine, card.monsterTypeLine).Width;
+  float scaleX = 1.0f;
+  if (textWidth > static_cast<irr::u32>(typeRect.getWidth()))
+    scaleX = (float)typeRect.getWidth() / (float)textWidth;
+  canvas.DrawText(fontTypeLine, card.monsterTypeLine, typeRect, textColor,
+                  false, true, scaleX);
 }
 
-void ModularCardRenderer::RenderStats(const ModularCardData &card) {
+void ModularCardRenderer::RenderStats(ModularCanvas &canvas,
+                                      const ModularCardData &card) const {
   // Only render for monsters
   if (card.cardType != CardType::MONSTER)
     return;
 
-  if (!fontStats)
-    return;
-
   // Draw horizontal separator line above ATK/DEF
   // CSS: .cRenderMonsterSplitLine: left:92, bottom:152, width:996, height:4
   // y = 1720 - 152 - 4 = 1564
   irr::video::SColor lineColor(255, 0, 0, 0); // Black
-  driver->draw2DRectangle(
-      lineColor, irr::core::rect<irr::s32>(92, 1564, 92 + 996, 1564 + 4));
+  canvas.FillRect(lineColor,
+                  irr::core::rect<irr::s32>(92, 1564, 92 + 996, 1564 + 4));
 
   irr::video::SColor textColor(255, 0, 0, 0); // Black text
 
@@ -942,9 +1006,9 @@ void ModularCardRenderer::RenderStats(const ModularCardData &card) {
   std::wstring atkStr =
       (card.monsterATK >= 0) ? std::to_wstring(card.monsterATK) : L"?";
   irr::core::dimension2d<irr::u32> atkLabelDim =
-      fontStats->getDimension(atkLabel.c_str());
+      canvas.GetTextDimension(fontStats, atkLabel);
   irr::core::dimension2d<irr::u32> atkDim =
-      fontStats->getDimension(atkStr.c_str());
+      canvas.GetTextDimension(fontStats, atkStr);
 
   std::wstring defLabel, defStr;
   irr::core::dimension2d<irr::u32> defLabelDim, defDim;
@@ -956,8 +1020,8 @@ void ModularCardRenderer::RenderStats(const ModularCardData &card) {
     defLabel = L"DEF/";
     defStr = (card.monsterDEF >= 0) ? std::to_wstring(card.monsterDEF) : L"?";
   }
-  defLabelDim = fontStats->getDimension(defLabel.c_str());
-  defDim = fontStats->getDimension(defStr.c_str());
+  defLabelDim = canvas.GetTextDimension(fontStats, defLabel);
+  defDim = canvas.GetTextDimension(fontStats, defStr);
 
   // Calculate total width of the block
   int totalWidth = atkLabelDim.Width + LABEL_VALUE_GAP + atkDim.Width +
@@ -971,23 +1035,23 @@ void ModularCardRenderer::RenderStats(const ModularCardData &card) {
   int currentX = startX;
   irr::core::rect<irr::s32> atkLabelRect(currentX, 1570,
                                          currentX + atkLabelDim.Width, 1614);
-  fontStats->draw(atkLabel.c_str(), atkLabelRect, textColor, false, true);
+  canvas.DrawText(fontStats, atkLabel, atkLabelRect, textColor, false, true);
   currentX += atkLabelDim.Width + LABEL_VALUE_GAP;
 
   irr::core::rect<irr::s32> atkValueRect(currentX, 1570,
                                          currentX + atkDim.Width, 1614);
-  fontStats->draw(atkStr.c_str(), atkValueRect, textColor, false, true);
+  canvas.DrawText(fontStats, atkStr, atkValueRect, textColor, false, true);
   currentX += atkDim.Width + SECTION_GAP;
 
   // Draw DEF/LINK section
   irr::core::rect<irr::s32> defLabelRect(currentX, 1570,
                                          currentX + defLabelDim.Width, 1614);
-  fontStats->draw(defLabel.c_str(), defLabelRect, textColor, false, true);
+  canvas.DrawText(fontStats, defLabel, defLabelRect, textColor, false, true);
   currentX += defLabelDim.Width + LABEL_VALUE_GAP;
 
   irr::core::rect<irr::s32> defValueRect(currentX, 1570,
                                          currentX + defDim.Width, 1614);
-  fontStats->draw(defStr.c_str(), defValueRect, textColor, false, true);
+  canvas.DrawText(fontStats, defStr, defValueRect, textColor, false, true);
 }
 
 std::string
@@ -1041,61 +1105,25 @@ ModularCardRenderer::GetFramePath(const ModularCardData &card) const {
   }
 }
 
-irr::video::ITexture *
-ModularCardRenderer::LoadFrameTexture(const ModularCardData &card) {
-  std::string framePath = GetFramePath(card);
-
-  // Check cache first
-  auto it = frameTextures.find(framePath);
-  if (it != frameTextures.end()) {
-    return it->second;
-  }
-
-  // Load and cache
-  irr::video::ITexture *texture = driver->getTexture(framePath.c_str());
-  if (texture) {
-    frameTextures[framePath] = texture;
-  }
-
-  return texture;
-}
-
-irr::video::ITexture *
-ModularCardRenderer::LoadIconTexture(const std::string &iconName) {
-  std::string iconPath = "textures/modular/icon/" + iconName + ".png";
-
-  // Check cache first
-  auto it = iconTextures.find(iconPath);
-  if (it != iconTextures.end()) {
-    return it->second;
-  }
-
-  // Load and cache
-  irr::video::ITexture *texture = driver->getTexture(iconPath.c_str());
-  if (texture) {
-    iconTextures[iconPath] = texture;
-  }
-
-  return texture;
-}
-
-float ModularCardRenderer::ChooseFontSize(const std::wstring &text, int width,
-                                          int height,
-                                          irr::gui::IGUIFont *font) {
-  // Simple implementation - start at 42 and reduce if needed
-  // Full implementation would measure text and iterate
-  return 42.0f;
-}
-
-void ModularCardRenderer::FitTextOneLine(const std::wstring &text,
-                                         irr::core::rect<irr::s32> rect,
-                                         irr::gui::IGUIFont *font,
-                                         float scaleFont) {
-  // Simple implementation - just draw the text
-  // Full implementation would scale horizontally if text is too wide
-  if (font) {
-    font->draw(text.c_str(), rect, irr::video::SColor(255, 0, 0, 0), true,
-               true);
+const char *ModularCardRenderer::GetLinkArrowPath(LinkArrow arrow) {
+  switch (arrow) {
+  case LinkArrow::UP:
+    return "textures/modular/icon/L_U.png";
+  case LinkArrow::DOWN:
+    return "textures/modular/icon/L_D.png";
+  case LinkArrow::LEFT:
+    return "textures/modular/icon/L_L.png";
+  case LinkArrow::RIGHT:
+    return "textures/modular/icon/L_R.png";
+  case LinkArrow::UP_LEFT:
+    return "textures/modular/icon/L_UL.png";
+  case LinkArrow::UP_RIGHT:
+    return "textures/modular/icon/L_UR.png";
+  case LinkArrow::DOWN_LEFT:
+    return "textures/modular/icon/L_DL.png";
+  case LinkArrow::DOWN_RIGHT:
+  default:
+    return "textures/modular/icon/L_DR.png";
   }
 }
 
@@ -2,8 +2,12 @@
 #define MODULAR_CARD_RENDERER_H
 
 #include "config.h"
+#include "modular_card_canvas.h"
+#include "modular_render_stats.h"
+#include "modular_text_layout.h"
 #include <irrlicht.h>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -73,38 +77,78 @@ struct ModularCardData {
   ModularCardData();
 };
 
-// Main renderer class
+// Builds the modular data of code from its database entry and the loaded
+// strings. Reads gDataManager only, so it can run on any thread once the
+// databases are loaded.
+ModularCardData ConvertToModularData(uint32_t code);
+
+// Main renderer class. The layout is drawn through a ModularCanvas, either
+// on the GPU with RenderCard or on any thread with Compose and a software
+// canvas.
 class ModularCardRenderer {
 public:
   // Base resolution constants (1180x1720)
   static constexpr int BASE_WIDTH = 1180;
   static constexpr int BASE_HEIGHT = 1720;
 
+  // Cards are output at the base resolution halved up to this many times
+  static constexpr uint32_t MAX_LOD_LEVEL = 3;
+
   ModularCardRenderer(irr::IrrlichtDevice *device);
   ~ModularCardRenderer();
 
-  // Main rendering function
+  // Level of detail for a card displayed at displaySize: the most times the
+  // base resolution can be halved while still covering it, so the card is
+  // only ever scaled down on screen. An empty size gives level 0, the full
+  // resolution used for exports.
+  static uint32_t GetLodLevel(const irr::core::dimension2du &displaySize);
+  static irr::core::dimension2du GetLodSize(uint32_t level);
+
+  // Where the art goes on a regular or pendulum card, in base coordinates
+  static irr::core::recti GetArtBox(bool pendulum);
+  // Part of art of artSize shown in the art box: all of it on regular cards,
+  // the centered (or top) part with the aspect ratio of the box on
+  // pendulums. Art already fitted to the box is shown whole.
+  static irr::core::recti GetArtCrop(const irr::core::dimension2du &artSize,
+                                     bool pendulum);
+
+  // Main rendering function. Renders into target if given, laid out for its
+  // size, otherwise into the shared full resolution render target that is
+  // overwritten by the next call.
   irr::video::ITexture *RenderCard(const ModularCardData &card,
-                                   irr::video::ITexture *artTexture = nullptr);
+                                   irr::video::ITexture *artTexture = nullptr,
+                                   irr::video::ITexture *target = nullptr);
 
-  // Individual rendering components (matching daominah-card-engine)
-  void RenderCardFrame(const ModularCardData &card);
-  void RenderCardArt(irr::video::ITexture *artTexture,
-                     const ModularCardData &card);
-  void RenderCardName(const ModularCardData &card);
-  void RenderCardAttribute(const ModularCardData &card);
-  void RenderCardTypeLevelRank(const ModularCardData &card);
-  void RenderLinkArrow(const ModularCardData &card);
-  void RenderCardEffect(const ModularCardData &card);
-  void RenderPendulum(const ModularCardData &card);
-  void RenderMonsterTypeLine(const ModularCardData &card);
-  void RenderStats(const ModularCardData &card);
+  // Draws the whole card on canvas. Doesn't touch any renderer state, so it
+  // can run on several threads at once, each with its own canvas.
+  void Compose(ModularCanvas &canvas, const ModularCardData &card) const;
+  // Same, scaled from the base layout to a canvas of the given size
+  void Compose(ModularCanvas &canvas, const ModularCardData &card,
+               const irr::core::dimension2du &size) const;
 
-  // Helper functions
-  float ChooseFontSize(const std::wstring &text, int width, int height,
-                       irr::gui::IGUIFont *font);
-  void FitTextOneLine(const std::wstring &text, irr::core::rect<irr::s32> rect,
-                      irr::gui::IGUIFont *font, float scaleFont = 1.0f);
+  // Individual rendering components (matching daominah-card-engine)
+  void RenderCardFrame(ModularCanvas &canvas,
+                       const ModularCardData &card) const;
+  void RenderCardArt(ModularCanvas &canvas, const ModularCardData &card) const;
+  void RenderCardName(ModularCanvas &canvas,
+                      const ModularCardData &card) const;
+  void RenderCardAttribute(ModularCanvas &canvas,
+                           const ModularCardData &card) const;
+  void RenderCardTypeLevelRank(ModularCanvas &canvas,
+                               const ModularCardData &card) const;
+  void RenderLinkArrow(ModularCanvas &canvas,
+                       const ModularCardData &card) const;
+  void RenderCardEffect(ModularCanvas &canvas,
+                        const ModularCardData &card) const;
+  void RenderPendulum(ModularCanvas &canvas,
+                      const ModularCardData &card) const;
+  void RenderMonsterTypeLine(ModularCanvas &canvas,
+                             const ModularCardData &card) const;
+  void RenderStats(ModularCanvas &canvas, const ModularCardData &card) const;
+
+  // Timings of every stage of the cards composed so far, on any canvas. On
+  // the GPU path they measure the time spent issuing the draws.
+  ModularRenderStats &GetStats() const { return stats; }
 
 private:
   irr::IrrlichtDevice *device;
@@ -114,43 +158,35 @@ private:
   // Render target for the card
   irr::video::ITexture *renderTarget;
 
-  // Font cache
-  irr::gui::IGUIFont *fontCardName;
-  irr::gui::IGUIFont *fontEffect;        // 42px tier 1
-  irr::gui::IGUIFont *fontEffectMedium;  // 38px tier 2
-  irr::gui::IGUIFont *fontEffectSmall;   // 32px tier 3
-  irr::gui::IGUIFont *fontEffectSmaller; // 28px tier 4
-  irr::gui::IGUIFont *fontEffectTiny;    // 24px tier 5
-  irr::gui::IGUIFont *fontEffectItalic;  // 42px italic for normal monsters
-  irr::gui::IGUIFont *fontStats;
-  irr::gui::IGUIFont *fontTypeLine;
-  irr::gui::IGUIFont *fontCardId; // Font for 8-digit card ID
-
-  void RenderCardId(const ModularCardData &card);
-
-  // Name font cache for dynamic sizing (keyed by size in half-pixels)
-  std::map<int, irr::gui::IGUIFont *> nameFontCache;
-
-  // Get or create name font at specific size
-  irr::gui::IGUIFont *GetNameFontForSize(int sizeHalfPx);
-
-  // Level/Rank star textures
-  irr::video::ITexture *levelStarTexture;
-  irr::video::ITexture *rankStarTexture;
-
-  void RenderSpellTrapTypeLine(const ModularCardData &card);
-  const wchar_t *GetSpellTrapIconPath(CardSubtype subtype);
-
-  // Link arrow textures
-  std::map<LinkArrow, irr::video::ITexture *> linkArrowTextures;
-
-  // Frame texture cache
-  std::map<std::string, irr::video::ITexture *> frameTextures;
-  std::map<std::string, irr::video::ITexture *> iconTextures;
+  // Canvas used by RenderCard, owns the fonts and textures of the GPU path
+  std::unique_ptr<ModularGpuCanvas> gpuCanvas;
+
+  // Line breaks of the effect boxes, shared by every canvas composing cards
+  mutable ModularTextLayout textLayout;
+
+  mutable ModularRenderStats stats;
+
+  // Fonts
+  static constexpr ModularFont fontCardName{ModularFace::CARD_NAME, 114};
+  // Long names are squeezed down to this scale before the font shrinks
+  static constexpr float MIN_NAME_SCALE = 0.6f;
+  static constexpr uint32_t MIN_NAME_SIZE = 76;
+  // Effect boxes take the largest size that fits between these
+  static constexpr uint32_t MAX_EFFECT_SIZE = 42;
+  static constexpr uint32_t MIN_EFFECT_SIZE = 24;
+  static constexpr uint32_t MAX_PENDULUM_EFFECT_SIZE = 32;
+  static constexpr ModularFont fontStats{ModularFace::STATS, 64};
+  static constexpr ModularFont fontTypeLine{ModularFace::TYPE_LINE, 38};
+  // 8-digit card ID, slightly larger than its 26px box to look good
+  static constexpr ModularFont fontCardId{ModularFace::EFFECT, 32};
+
+  void RenderCardId(ModularCanvas &canvas, const ModularCardData &card) const;
+  void RenderSpellTrapTypeLine(ModularCanvas &canvas,
+                               const ModularCardData &card) const;
+  static const char *GetSpellTrapIconPath(CardSubtype subtype);
+  static const char *GetLinkArrowPath(LinkArrow arrow);
 
   // Helper functions
-  irr::video::ITexture *LoadFrameTexture(const ModularCardData &card);
-  irr::video::ITexture *LoadIconTexture(const std::string &iconName);
   std::string GetFramePath(const ModularCardData &card) const;
 };
 
@@ -0,0 +1,20 @@
+#include "modular_card_table.h"
+#include "data_manager.h"
+#include "modular_card_renderer.h"
+
+namespace ygo {
+
+std::shared_ptr<const ModularCardData> ModularCardTable::Get(uint32_t code) {
+  std::lock_guard<epro::mutex> lck(mutex);
+  const uint32_t current = gDataManager->GetRevision();
+  if (revision != current) {
+    cards.clear();
+    revision = current;
+  }
+  auto &card = cards[code];
+  if (!card)
+    card = std::make_shared<const ModularCardData>(ConvertToModularData(code));
+  return card;
+}
+
+} // namespace ygo
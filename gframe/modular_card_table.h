@@ -0,0 +1,34 @@
+#ifndef MODULAR_CARD_TABLE_H
+#define MODULAR_CARD_TABLE_H
+
+#include "config.h"
+#include "epro_mutex.h"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+namespace ygo {
+
+struct ModularCardData;
+
+// ModularCardData of every card shown so far, built once per card from the
+// loaded databases and strings. Callers share the same immutable data, so
+// showing a card again doesn't touch its strings. The whole table is dropped
+// whenever gDataManager reports new cards or strings, like after a locale
+// change.
+class ModularCardTable {
+public:
+  // The data of code, converted on first use
+  std::shared_ptr<const ModularCardData> Get(uint32_t code);
+
+private:
+  epro::mutex mutex;
+  uint32_t revision = 0;
+  std::unordered_map<uint32_t, std::shared_ptr<const ModularCardData>> cards;
+};
+
+extern ModularCardTable *gModularCardTable;
+
+} // namespace ygo
+
+#endif // MODULAR_CARD_TABLE_H
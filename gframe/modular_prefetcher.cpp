@@ -0,0 +1,72 @@
+#include "modular_prefetcher.h"
+#include "data_manager.h"
+#include <algorithm>
+
+namespace ygo {
+
+void ModularPrefetcher::Queue(uint32_t code, bool visible) {
+  if (code == 0)
+    return;
+  std::lock_guard<epro::mutex> lck(mutex);
+  if (!queued.insert(code).second) {
+    if (!visible)
+      return;
+    // Already waiting in the background, move it up
+    auto it = std::find(background.begin(), background.end(), code);
+    if (it == background.end())
+      return;
+    background.erase(it);
+  }
+  if (visible)
+    this->visible.push_back(code);
+  else
+    background.push_back(code);
+}
+
+void ModularPrefetcher::QueueDeck(const Deck &deck) {
+  for (const auto *list : {&deck.main, &deck.extra, &deck.side}) {
+    for (const auto *card : *list) {
+      if (card)
+        Queue(card->code);
+    }
+  }
+}
+
+void ModularPrefetcher::QueueCodes(const std::vector<uint32_t> &codes) {
+  for (auto code : codes)
+    Queue(code);
+}
+
+void ModularPrefetcher::Update(const Prefetch &prefetch) {
+  const auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start < FRAME_BUDGET) {
+    uint32_t code;
+    bool wasVisible;
+    {
+      std::lock_guard<epro::mutex> lck(mutex);
+      wasVisible = !visible.empty();
+      auto &queue = wasVisible ? visible : background;
+      if (queue.empty())
+        return;
+      code = queue.front();
+      queue.pop_front();
+      queued.erase(code);
+    }
+    if (!prefetch(code)) {
+      // Busy, try again next frame from the same spot
+      std::lock_guard<epro::mutex> lck(mutex);
+      if (queued.insert(code).second)
+        (wasVisible ? visible : background).push_front(code);
+      return;
+    }
+  }
+}
+
+void ModularPrefetcher::Clear() {
+  std::lock_guard<epro::mutex> lck(mutex);
+  visible.clear();
+  background.clear();
+  queued.clear();
+}
+
+} // namespace ygo
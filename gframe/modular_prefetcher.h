@@ -0,0 +1,49 @@
+#ifndef MODULAR_PREFETCHER_H
+#define MODULAR_PREFETCHER_H
+
+#include "config.h"
+#include "deck.h"
+#include "epro_mutex.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+namespace ygo {
+
+// Queue of modular cards the player is likely to inspect soon: the deck being
+// edited, the decks of a duel or replay and the cards revealed on the field.
+// Codes can be queued from any thread. Update hands them out on the main
+// thread a few at a time, within a per-frame time budget, so the cards are
+// composited in the background before they're hovered.
+class ModularPrefetcher {
+public:
+  // Prefetches one card. Returns false if there's no room for more work right
+  // now, the card then stays queued for a later frame.
+  using Prefetch = std::function<bool(uint32_t code)>;
+
+  // Time Update may spend per frame
+  static constexpr std::chrono::microseconds FRAME_BUDGET{2000};
+
+  // Visible cards are prefetched before everything queued normally
+  void Queue(uint32_t code, bool visible = false);
+  void QueueDeck(const Deck &deck);
+  void QueueCodes(const std::vector<uint32_t> &codes);
+
+  // Main thread, once per frame
+  void Update(const Prefetch &prefetch);
+
+  void Clear();
+
+private:
+  epro::mutex mutex;
+  std::deque<uint32_t> visible;
+  std::deque<uint32_t> background;
+  std::unordered_set<uint32_t> queued;
+};
+
+} // namespace ygo
+
+#endif // MODULAR_PREFETCHER_H
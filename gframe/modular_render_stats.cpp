@@ -0,0 +1,117 @@
+#include "modular_render_stats.h"
+#include "fmt.h"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace ygo {
+
+const char *ModularRenderStats::GetStageName(Stage stage) {
+  switch (stage) {
+  case ART:
+    return "art";
+  case FRAME:
+    return "frame";
+  case ATTRIBUTE:
+    return "attribute";
+  case TYPE_LEVEL_RANK:
+    return "level/rank";
+  case LINK_ARROW:
+    return "link arrows";
+  case NAME:
+    return "name";
+  case TYPE_LINE:
+    return "type line";
+  case EFFECT:
+    return "effect";
+  case PENDULUM:
+    return "pendulum";
+  case STATS:
+    return "ATK/DEF";
+  case CARD_ID:
+    return "card id";
+  case SPELL_TRAP_TYPE:
+    return "spell/trap type";
+  case COMPOSE:
+    return "compose";
+  case MIPMAPS:
+    return "mipmaps";
+  case UPLOAD:
+    return "upload";
+  default:
+    return "";
+  }
+}
+
+void ModularRenderStats::Record(Stage stage, Clock::duration time) {
+  const float ms = std::chrono::duration<float, std::milli>(time).count();
+  std::lock_guard<epro::mutex> lck(mutex);
+  auto &samples = stages[stage];
+  samples.values[samples.next] = ms;
+  samples.next = (samples.next + 1) % WINDOW;
+  samples.count = std::min(samples.count + 1, WINDOW);
+}
+
+ModularRenderStats::Summary ModularRenderStats::GetSummary(Stage stage) {
+  std::vector<float> values;
+  {
+    std::lock_guard<epro::mutex> lck(mutex);
+    const auto &samples = stages[stage];
+    values.assign(samples.values.begin(),
+                  samples.values.begin() + samples.count);
+  }
+  if (values.empty())
+    return {0, 0.0, 0.0, 0.0};
+  const double sum = std::accumulate(values.begin(), values.end(), 0.0);
+  const double max = *std::max_element(values.begin(), values.end());
+  auto p95 = values.begin() + (values.size() * 95) / 100;
+  if (p95 == values.end())
+    --p95;
+  std::nth_element(values.begin(), p95, values.end());
+  return {values.size(), sum / values.size(), *p95, max};
+}
+
+void ModularRenderStats::Reset() {
+  std::lock_guard<epro::mutex> lck(mutex);
+  stages = {};
+}
+
+std::wstring ModularRenderStats::FormatOverlay() {
+  const auto total = GetSummary(COMPOSE);
+  if (total.count == 0)
+    return {};
+  // Whichever stage of the layout costs the most on average
+  Stage slowest = ART;
+  double slowestMean = -1.0;
+  for (int i = ART; i < COMPOSE; ++i) {
+    const auto summary = GetSummary(static_cast<Stage>(i));
+    if (summary.count > 0 && summary.mean > slowestMean) {
+      slowest = static_cast<Stage>(i);
+      slowestMean = summary.mean;
+    }
+  }
+  // Stage names are plain ASCII
+  const std::string name = GetStageName(slowest);
+  return epro::format(
+      L"Card {:.1f}ms (p95 {:.1f}, max {:.1f}), {} {:.1f}ms", total.mean,
+      total.p95, total.max, std::wstring(name.begin(), name.end()),
+      slowestMean);
+}
+
+std::string ModularRenderStats::FormatTable() {
+  std::string table =
+      epro::format("{:<16}{:>8}{:>10}{:>10}{:>10}\n", "stage", "samples",
+                   "mean ms", "p95 ms", "max ms");
+  for (int i = 0; i < COUNT; ++i) {
+    const auto stage = static_cast<Stage>(i);
+    const auto summary = GetSummary(stage);
+    if (summary.count == 0)
+      continue;
+    table += epro::format("{:<16}{:>8}{:>10.2f}{:>10.2f}{:>10.2f}\n",
+                          GetStageName(stage), summary.count, summary.mean,
+                          summary.p95, summary.max);
+  }
+  return table;
+}
+
+} // namespace ygo
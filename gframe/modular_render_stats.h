@@ -0,0 +1,84 @@
+#ifndef MODULAR_RENDER_STATS_H
+#define MODULAR_RENDER_STATS_H
+
+#include "config.h"
+#include "epro_mutex.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace ygo {
+
+// Rolling timings of the stages of a modular card render, kept over the last
+// WINDOW samples of each stage. Samples can be recorded from any thread.
+class ModularRenderStats {
+public:
+  enum Stage : uint8_t {
+    ART,
+    FRAME,
+    ATTRIBUTE,
+    TYPE_LEVEL_RANK,
+    LINK_ARROW,
+    NAME,
+    TYPE_LINE,
+    EFFECT,
+    PENDULUM,
+    STATS,
+    CARD_ID,
+    SPELL_TRAP_TYPE,
+    COMPOSE, // The whole layout, every stage above
+    MIPMAPS, // regenerateMipMapLevels after a GPU render
+    UPLOAD,  // addTexture of a software composited card, mipmaps included
+    COUNT
+  };
+  static constexpr size_t WINDOW = 256;
+
+  using Clock = std::chrono::steady_clock;
+
+  // In milliseconds
+  struct Summary {
+    size_t count;
+    double mean;
+    double p95;
+    double max;
+  };
+
+  // Records the time from its creation to its destruction
+  class Timer {
+  public:
+    Timer(ModularRenderStats &stats, Stage stage)
+        : stats(stats), stage(stage), start(Clock::now()) {}
+    ~Timer() { stats.Record(stage, Clock::now() - start); }
+
+  private:
+    ModularRenderStats &stats;
+    Stage stage;
+    Clock::time_point start;
+  };
+
+  static const char *GetStageName(Stage stage);
+
+  void Record(Stage stage, Clock::duration time);
+  Summary GetSummary(Stage stage);
+  void Reset();
+
+  // One line for the FPS counter, empty until a card was rendered
+  std::wstring FormatOverlay();
+  // Table of every stage that has samples, for the log
+  std::string FormatTable();
+
+private:
+  struct Samples {
+    std::array<float, WINDOW> values{};
+    size_t next = 0;
+    size_t count = 0;
+  };
+
+  epro::mutex mutex;
+  std::array<Samples, COUNT> stages;
+};
+
+} // namespace ygo
+
+#endif // MODULAR_RENDER_STATS_H
@@ -0,0 +1,185 @@
+#include "modular_text_layout.h"
+#include <algorithm>
+#include <limits>
+
+namespace ygo {
+
+std::vector<ModularTextLayout::Word>
+ModularTextLayout::SplitWords(const std::wstring &text) {
+  std::vector<Word> words;
+  size_t start = 0;
+  for (size_t i = 0; i <= text.size(); ++i) {
+    if (i < text.size() && text[i] != L' ' && text[i] != L'\n')
+      continue;
+    words.push_back(
+        Word{start, i - start, i < text.size() && text[i] == L'\n'});
+    start = i + 1;
+  }
+  return words;
+}
+
+bool ModularTextLayout::BreakLines(ModularCanvas &canvas,
+                                   const ModularFont &font,
+                                   const std::wstring &text,
+                                   const std::vector<Word> &words,
+                                   int maxWidth, size_t maxLines,
+                                   std::vector<LineRange> &lines) {
+  lines.clear();
+  size_t lineStart = 0;
+  int lineWidth = 0;
+  bool lineHasText = false;
+  wchar_t last = 0;
+  auto pushLine = [&](size_t end) {
+    lines.emplace_back(lineStart, end);
+    lineStart = end;
+    return lines.size() <= maxLines;
+  };
+  for (size_t i = 0; i < words.size(); ++i) {
+    const Word &word = words[i];
+    const wchar_t *chars = text.data() + word.start;
+
+    // Width of the word at the start of a line, plus how much the kerning
+    // against a preceding space changes it
+    int width = 0;
+    int kernSpace = 0;
+    for (size_t j = 0; j < word.length; ++j)
+      width += canvas.GetCharAdvance(font, chars[j], j ? chars[j - 1] : 0);
+    if (word.length)
+      kernSpace = canvas.GetCharAdvance(font, chars[0], L' ') -
+                  canvas.GetCharAdvance(font, chars[0], 0);
+
+    // Words without text only add their separating space, and only once the
+    // line has some text, like joining the line with spaces would
+    int joined = width;
+    if (lineHasText) {
+      joined = lineWidth + canvas.GetCharAdvance(font, L' ', last);
+      if (word.length)
+        joined += width + kernSpace;
+    }
+    if (joined > maxWidth && lineHasText) {
+      if (!pushLine(i))
+        return false;
+      lineWidth = width;
+      lineHasText = word.length > 0;
+      last = word.length ? chars[word.length - 1] : 0;
+    } else {
+      lineWidth = joined;
+      if (word.length) {
+        lineHasText = true;
+        last = chars[word.length - 1];
+      } else if (lineHasText) {
+        last = L' ';
+      }
+    }
+    if (word.breakAfter) {
+      if (!pushLine(i + 1))
+        return false;
+      lineWidth = 0;
+      lineHasText = false;
+      last = 0;
+    }
+  }
+  if (lineHasText)
+    return pushLine(words.size());
+  return true;
+}
+
+ModularTextLayout::Lines
+ModularTextLayout::Layout(ModularCanvas &canvas, uint32_t code,
+                          const irr::core::dimension2di &box,
+                          const std::wstring &text,
+                          const FitRange &range) {
+  const Key key{code, box.Width, box.Height};
+  {
+    std::lock_guard<epro::mutex> lck(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end() && it->second.text == text)
+      return it->second.lines;
+  }
+
+  const auto words = SplitWords(text);
+  std::vector<LineRange> ranges;
+  uint32_t broken = 0; // Size whose lines are in ranges
+  auto tryFit = [&](uint32_t size, bool force) {
+    const ModularFont font{range.face, size};
+    const int lineHeight = range.lineHeight(font);
+    const size_t maxLines =
+        force || lineHeight <= 0
+            ? std::numeric_limits<size_t>::max()
+            : static_cast<size_t>(std::max(box.Height, 0) / lineHeight);
+    const bool fits =
+        BreakLines(canvas, font, text, words, box.Width, maxLines, ranges);
+    broken = fits ? size : 0;
+    return fits;
+  };
+
+  // Short texts fit at the largest size right away, otherwise search for the
+  // largest size that fits, or settle for the smallest one
+  const uint32_t maxSize = std::max(range.maxSize, range.minSize);
+  uint32_t size = maxSize;
+  if (!tryFit(maxSize, false)) {
+    uint32_t low = range.minSize;
+    uint32_t high = maxSize - 1;
+    while (low < high) {
+      const uint32_t mid = low + (high - low + 1) / 2;
+      if (tryFit(mid, false))
+        low = mid;
+      else
+        high = mid - 1;
+    }
+    size = low;
+  }
+  if (broken != size)
+    tryFit(size, true);
+
+  Lines result{};
+  result.font = ModularFont{range.face, size};
+  result.lineHeight = range.lineHeight(result.font);
+  result.lines.reserve(ranges.size());
+  for (const auto &span : ranges) {
+    std::wstring line;
+    for (size_t i = span.first; i < span.second; ++i) {
+      const Word &word = words[i];
+      if (!line.empty())
+        line += L' ';
+      line.append(text, word.start, word.length);
+    }
+    result.lines.push_back(std::move(line));
+  }
+
+  std::lock_guard<epro::mutex> lck(mutex);
+  // The layouts are tiny, dropping them all now and then is enough to keep
+  // the cache bounded
+  if (cache.size() >= MAX_ENTRIES)
+    cache.clear();
+  cache[key] = Entry{text, result};
+  return result;
+}
+
+uint32_t ModularTextLayout::FitLine(ModularCanvas &canvas, ModularFace face,
+                                    uint32_t minSize, uint32_t maxSize,
+                                    const std::wstring &text, int maxWidth) {
+  auto fits = [&](uint32_t size) {
+    return canvas.GetTextDimension({face, size}, text).Width <=
+           static_cast<irr::u32>(std::max(maxWidth, 0));
+  };
+  if (maxSize <= minSize || fits(maxSize))
+    return std::max(maxSize, minSize);
+  uint32_t low = minSize;
+  uint32_t high = maxSize - 1;
+  while (low < high) {
+    const uint32_t mid = low + (high - low + 1) / 2;
+    if (fits(mid))
+      low = mid;
+    else
+      high = mid - 1;
+  }
+  return low;
+}
+
+void ModularTextLayout::Clear() {
+  std::lock_guard<epro::mutex> lck(mutex);
+  cache.clear();
+}
+
+} // namespace ygo
@@ -0,0 +1,101 @@
+#ifndef MODULAR_TEXT_LAYOUT_H
+#define MODULAR_TEXT_LAYOUT_H
+
+#include "config.h"
+#include "epro_mutex.h"
+#include "modular_card_canvas.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ygo {
+
+// Word wrapping for the text boxes of modular cards. The text is split into
+// words once, each word is measured once per font size from the character
+// advances, and lines are packed from those widths instead of measuring the
+// growing line again for every word. The font size is the largest one that
+// fits the box, found with a binary search, and a size is abandoned as soon as
+// its lines overflow. Finished layouts are cached per card and box, as the
+// same card is composited again whenever its art arrives or its texture is
+// evicted. Thread safe, cards composited on several threads share one layout.
+class ModularTextLayout {
+public:
+  // Pixel sizes a box may use, and the line spacing for a font of the face
+  struct FitRange {
+    ModularFace face;
+    uint32_t minSize;
+    uint32_t maxSize;
+    std::function<int(const ModularFont &)> lineHeight;
+  };
+  struct Lines {
+    ModularFont font;
+    int lineHeight;
+    std::vector<std::wstring> lines;
+  };
+
+  // Wraps text to box.Width with the largest size of range whose lines fit
+  // in box.Height, or the smallest one if none does. code and box identify
+  // the cached layout, which is only reused while the text stays the same, so
+  // a locale or database change lays the card out again.
+  Lines Layout(ModularCanvas &canvas, uint32_t code,
+               const irr::core::dimension2di &box, const std::wstring &text,
+               const FitRange &range);
+
+  // Largest size of face between minSize and maxSize at which text is at
+  // most maxWidth wide on one line, minSize if none is
+  static uint32_t FitLine(ModularCanvas &canvas, ModularFace face,
+                          uint32_t minSize, uint32_t maxSize,
+                          const std::wstring &text, int maxWidth);
+
+  void Clear();
+
+private:
+  struct Key {
+    uint32_t code;
+    int width;
+    int height;
+    bool operator==(const Key &other) const {
+      return code == other.code && width == other.width &&
+             height == other.height;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      return key.code ^ (static_cast<size_t>(key.width) << 20) ^
+             (static_cast<size_t>(key.height) << 8);
+    }
+  };
+  struct Entry {
+    std::wstring text;
+    Lines lines;
+  };
+
+  // Span of the text up to a space or line break
+  struct Word {
+    size_t start;
+    size_t length;
+    bool breakAfter; // Followed by a line break instead of a space
+  };
+  // Range of words [first, last) on one line
+  using LineRange = std::pair<size_t, size_t>;
+
+  static constexpr size_t MAX_ENTRIES = 1024;
+
+  epro::mutex mutex;
+  std::unordered_map<Key, Entry, KeyHash> cache;
+
+  static std::vector<Word> SplitWords(const std::wstring &text);
+  // Breaks the words into lines of at most maxWidth, returning false as soon
+  // as there are more than maxLines
+  static bool BreakLines(ModularCanvas &canvas, const ModularFont &font,
+                         const std::wstring &text,
+                         const std::vector<Word> &words, int maxWidth,
+                         size_t maxLines, std::vector<LineRange> &lines);
+};
+
+} // namespace ygo
+
+#endif // MODULAR_TEXT_LAYOUT_H
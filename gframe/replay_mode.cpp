@@ -6,6 +6,7 @@
 #include "game.h"
 #include "single_mode.h"
 #include "sound_manager.h"
+#include "modular_prefetcher.h"
 
 namespace ygo {
 
@@ -48,6 +49,10 @@ bool ReplayMode::StartReplay(int skipturn, bool is_yrp) {
 		replay_thread = epro::thread(OldReplayThread);
 	} else
 		replay_thread = epro::thread(ReplayThread);
+	for(const auto& deck : cur_replay.GetPlayerDecks()) {
+		mainGame->modularPrefetcher->QueueCodes(deck.main_deck);
+		mainGame->modularPrefetcher->QueueCodes(deck.extra_deck);
+	}
 	return true;
 }
 void ReplayMode::StopReplay(bool is_exiting) {
@@ -0,0 +1,224 @@
+#include "scaled_image_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <zlib.h>
+#include <IImage.h>
+#include <IVideoDriver.h>
+#include "epro_thread.h"
+#include "file_stream.h"
+#include "fmt.h"
+#include "image_data.h"
+#include "utils.h"
+
+#define BASE_PATH EPRO_TEXT("./pics/scaled/")
+
+namespace ygo {
+
+namespace {
+
+constexpr uint32_t FILE_MAGIC = 0x43535045; //"EPSC"
+
+struct file_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t path_hash;
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	uint32_t data_size;
+};
+static_assert(sizeof(file_header) == 48, "file_header must have no padding");
+
+//FNV-1a, stable across runs unlike std::hash
+uint64_t hashPath(epro::path_stringview path) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for(auto c : path) {
+		const auto value = static_cast<uint32_t>(c);
+		for(int i = 0; i < 4; ++i) {
+			hash ^= (value >> (i * 8)) & 0xff;
+			hash *= 0x100000001b3ULL;
+		}
+	}
+	return hash;
+}
+
+uint32_t bytesPerPixel(irr::video::ECOLOR_FORMAT format) {
+	switch(format) {
+		case irr::video::ECF_R8G8B8:
+			return 3;
+		case irr::video::ECF_A8R8G8B8:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+file_header makeHeader(const ScaledImageCache::source_file& source, const irr::core::dimension2du& size, uint32_t format) {
+	file_header header{};
+	header.magic = FILE_MAGIC;
+	header.version = ScaledImageCache::SCALER_VERSION;
+	header.path_hash = hashPath(source.path);
+	header.source_size = source.size;
+	header.source_mtime = source.mtime;
+	header.width = size.Width;
+	header.height = size.Height;
+	header.format = format;
+	return header;
+}
+
+}
+
+ScaledImageCache::ScaledImageCache(irr::video::IVideoDriver* driver, uint64_t budget_bytes) :
+	driver(driver), budget(budget_bytes), indexed(false), used_bytes(0) {
+	Utils::MakeDirectory(EPRO_TEXT("./pics/"));
+	Utils::MakeDirectory(BASE_PATH);
+	Utils::MakeDirectory(BASE_PATH EPRO_TEXT("cover/"));
+}
+
+epro::path_string ScaledImageCache::GetPath(uint32_t code, bool cover, const irr::core::dimension2du& size) const {
+	return epro::format(EPRO_TEXT("{}{}{}_{}x{}.bin"), BASE_PATH, cover ? EPRO_TEXT("cover/") : EPRO_TEXT(""), code, size.Width, size.Height);
+}
+
+void ScaledImageCache::Index() {
+	for(auto dir : { BASE_PATH, BASE_PATH EPRO_TEXT("cover/") }) {
+		for(const auto& name : Utils::FindFiles(dir, { EPRO_TEXT("bin") })) {
+			auto path = epro::format(EPRO_TEXT("{}{}"), dir, name);
+			entry file;
+			if(!Utils::GetFileStat(path, file.size, file.last_use))
+				continue;
+			used_bytes += file.size;
+			entries.emplace(std::move(path), file);
+		}
+	}
+	indexed = true;
+}
+
+std::vector<epro::path_string> ScaledImageCache::Insert(const epro::path_string& path, uint64_t size) {
+	std::lock_guard<epro::mutex> lck(mutex);
+	//the new entry is already on disk, the index picks it up as well
+	if(!indexed)
+		Index();
+	auto& file = entries[path];
+	used_bytes = used_bytes - file.size + size;
+	file.size = size;
+	file.last_use = std::time(nullptr);
+	std::vector<epro::path_string> stale;
+	if(used_bytes <= budget)
+		return stale;
+	//down to 7/8 of the budget, so that the next stores don't have to sort again
+	std::vector<decltype(entries)::iterator> order;
+	order.reserve(entries.size());
+	for(auto it = entries.begin(); it != entries.end(); ++it)
+		order.push_back(it);
+	std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a->second.last_use < b->second.last_use; });
+	const auto target = budget / 8 * 7;
+	for(auto it : order) {
+		if(used_bytes <= target)
+			break;
+		if(it->first == path)
+			continue;
+		used_bytes -= it->second.size;
+		stale.push_back(it->first);
+		entries.erase(it);
+	}
+	return stale;
+}
+
+irr::video::IImage* ScaledImageCache::Load(uint32_t code, bool cover, const source_file& source, const irr::core::dimension2du& size) {
+	const auto path = GetPath(code, cover, size);
+	FileStream file{ path, FileStream::in | FileStream::binary };
+	if(!file.is_open())
+		return nullptr;
+	{
+		std::lock_guard<epro::mutex> lck(mutex);
+		auto it = entries.find(path);
+		if(it != entries.end())
+			it->second.last_use = std::time(nullptr);
+	}
+	file_header header;
+	if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return nullptr;
+	auto expected = makeHeader(source, size, header.format);
+	expected.data_size = header.data_size;
+	const auto format = static_cast<irr::video::ECOLOR_FORMAT>(header.format);
+	const auto bpp = bytesPerPixel(format);
+	if(bpp == 0 || std::memcmp(&header, &expected, sizeof(header)) != 0)
+		return nullptr;
+	const size_t row = size.Width * bpp;
+	//Store never writes more than this, a larger size is a damaged entry
+	if(header.data_size > compressBound(static_cast<uLong>(row * size.Height)))
+		return nullptr;
+	std::vector<uint8_t> compressed(header.data_size);
+	if(!file.read(reinterpret_cast<char*>(compressed.data()), compressed.size()))
+		return nullptr;
+	std::vector<uint8_t> pixels(row * size.Height);
+	uLongf length = static_cast<uLongf>(pixels.size());
+	if(uncompress(pixels.data(), &length, compressed.data(), static_cast<uLong>(compressed.size())) != Z_OK || length != pixels.size())
+		return nullptr;
+	auto* image = driver->createImage(format, size);
+	auto* out = static_cast<uint8_t*>(GetData(image));
+	const auto pitch = image->getPitch();
+	for(uint32_t y = 0; y < size.Height; ++y) {
+		const auto* src = &pixels[y * row];
+		auto* dst = out + y * pitch;
+		std::memcpy(dst, src, bpp);
+		for(size_t x = bpp; x < row; ++x)
+			dst[x] = static_cast<uint8_t>(src[x] + dst[x - bpp]);
+	}
+	Unlock(image);
+	return image;
+}
+
+void ScaledImageCache::Store(uint32_t code, bool cover, const source_file& source, irr::video::IImage* image) {
+	const auto format = image->getColorFormat();
+	const auto bpp = bytesPerPixel(format);
+	if(bpp == 0)
+		return;
+	const auto& size = image->getDimension();
+	//every byte is stored as the difference from the same channel of the pixel
+	//on its left, which deflate packs much better than the pixels themselves
+	const size_t row = size.Width * bpp;
+	std::vector<uint8_t> pixels(row * size.Height);
+	const auto* in = static_cast<const uint8_t*>(GetData(image));
+	const auto pitch = image->getPitch();
+	for(uint32_t y = 0; y < size.Height; ++y) {
+		const auto* src = in + y * pitch;
+		auto* dst = &pixels[y * row];
+		std::memcpy(dst, src, bpp);
+		for(size_t x = bpp; x < row; ++x)
+			dst[x] = static_cast<uint8_t>(src[x] - src[x - bpp]);
+	}
+	Unlock(image);
+	std::vector<uint8_t> compressed(compressBound(static_cast<uLong>(pixels.size())));
+	uLongf length = static_cast<uLongf>(compressed.size());
+	if(compress2(compressed.data(), &length, pixels.data(), static_cast<uLong>(pixels.size()), Z_BEST_SPEED) != Z_OK)
+		return;
+	auto header = makeHeader(source, size, format);
+	header.data_size = static_cast<uint32_t>(length);
+	const auto path = GetPath(code, cover, size);
+	//written under a name of this thread's own, as the loader threads can store the same picture at once
+	const auto tmp_path = epro::format(EPRO_TEXT("{}.{}.tmp"), path, std::hash<epro::thread::id>{}(epro::this_thread::get_id()));
+	bool written;
+	{
+		FileStream file{ tmp_path, FileStream::out | FileStream::binary | FileStream::trunc };
+		if(!file.is_open())
+			return;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(compressed.data()), length);
+		written = !!file;
+	}
+	//FileMove doesn't replace an existing file on Windows
+	Utils::FileDelete(path);
+	if(!written || !Utils::FileMove(tmp_path, path)) {
+		Utils::FileDelete(tmp_path);
+		return;
+	}
+	for(const auto& stale : Insert(path, sizeof(header) + length))
+		Utils::FileDelete(stale);
+}
+
+}
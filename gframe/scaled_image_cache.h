@@ -0,0 +1,70 @@
+#ifndef SCALED_IMAGE_CACHE_H
+#define SCALED_IMAGE_CACHE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <dimension2d.h>
+#include "epro_mutex.h"
+#include "text_types.h"
+
+namespace irr {
+namespace video {
+class IImage;
+class IVideoDriver;
+}
+}
+
+namespace ygo {
+
+//Card pictures already scaled to the sizes ImageManager shows them at, kept under
+//./pics/scaled/ so that later launches read them back instead of decoding and
+//scaling the original again. Every entry is {code}_{width}x{height}.bin: a header
+//with the path, size and last write time of the file it was scaled from and the
+//scaler version, followed by the pixels, delta coded and deflated. An entry
+//whose header doesn't match the current file is a miss and is overwritten.
+//A picture can be stored at several sizes, and a new window size brings new
+//ones, so once the entries take more than the budget the least recently used
+//are deleted. Thread safe.
+class ScaledImageCache {
+public:
+	//Bump whenever ResampleImage's output changes
+	static constexpr uint32_t SCALER_VERSION = 1;
+
+	struct source_file {
+		epro::path_string path;
+		uint64_t size;
+		int64_t mtime;
+	};
+
+	ScaledImageCache(irr::video::IVideoDriver* driver, uint64_t budget_bytes);
+
+	//The picture of code scaled to size from source if it's stored, nullptr
+	//otherwise. The caller must drop the image.
+	irr::video::IImage* Load(uint32_t code, bool cover, const source_file& source, const irr::core::dimension2du& size);
+	void Store(uint32_t code, bool cover, const source_file& source, irr::video::IImage* image);
+
+private:
+	struct entry {
+		uint64_t size;
+		int64_t last_use; //seconds since the epoch, the write time for entries of earlier runs
+	};
+
+	irr::video::IVideoDriver* driver;
+	const uint64_t budget;
+
+	//Every entry on disk, filled on the first Store. Guarded by mutex.
+	epro::mutex mutex;
+	bool indexed;
+	std::unordered_map<epro::path_string, entry> entries;
+	uint64_t used_bytes;
+
+	epro::path_string GetPath(uint32_t code, bool cover, const irr::core::dimension2du& size) const;
+	void Index();
+	//Records the entry at path, returns the entries to delete to fit the budget
+	std::vector<epro::path_string> Insert(const epro::path_string& path, uint64_t size);
+};
+
+}
+
+#endif //SCALED_IMAGE_CACHE_H
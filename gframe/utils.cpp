@@ -388,6 +388,29 @@ namespace ygo {
 #else
 		Stat sb;
 		return stat(path.data(), &sb) != -1 && S_ISREG(sb.st_mode) != 0;
+#endif
+	}
+	bool Utils::GetFileStat(epro::path_stringview path, uint64_t& size, int64_t& mtime) {
+#if EDOPRO_WINDOWS
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if(!GetFileAttributesEx(path.data(), GetFileExInfoStandard, &data) || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			return false;
+		size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+		//100 nanoseconds intervals since 1601
+		const auto time = (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+		mtime = (time - 116444736000000000LL) / 10000000;
+		return true;
+#else
+#if EDOPRO_ANDROID
+		if(porting::pathIsUri(path))
+			return false;
+#endif
+		Stat sb;
+		if(stat(path.data(), &sb) == -1 || !S_ISREG(sb.st_mode))
+			return false;
+		size = static_cast<uint64_t>(sb.st_size);
+		mtime = static_cast<int64_t>(sb.st_mtime);
+		return true;
 #endif
 	}
 	static epro::path_string working_dir;
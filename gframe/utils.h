@@ -69,6 +69,8 @@ namespace ygo {
 		static bool FileCopy(epro::path_stringview source, epro::path_stringview destination);
 		static bool FileMove(epro::path_stringview source, epro::path_stringview destination);
 		static bool FileExists(epro::path_stringview path);
+		//size in bytes and last write time in seconds since the epoch of a regular file
+		static bool GetFileStat(epro::path_stringview path, uint64_t& size, int64_t& mtime);
 		static bool FileDelete(epro::path_stringview source);
 		static bool MakeDirectory(epro::path_stringview path);
 		static bool ClearDirectory(epro::path_stringview path);